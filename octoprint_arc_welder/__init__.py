@@ -47,6 +47,7 @@ from octoprint.events import Events
 from octoprint.plugins.softwareupdate.version_checks import github_release
 import octoprint_arc_welder.log as log
 import octoprint_arc_welder.preprocessor as preprocessor
+import octoprint_arc_welder.live_welder as live_welder
 import octoprint_arc_welder.utilities as utilities
 import  octoprint_arc_welder_setuptools as arc_welder_setuptools
 # stupid python 2/python 3 compatibility imports
@@ -98,6 +99,21 @@ class ArcWelderPlugin(
     SOURCE_FILE_DELETE_MANUAL = "manual-only"
     SOURCE_FILE_DELETE_DISABLED = "disabled"
 
+    # Must match feature_type_name in gcode_comment_processor.h
+    FEATURE_TYPES = [
+        "unknown_feature",
+        "bridge_feature",
+        "outer_perimeter_feature",
+        "unknown_perimeter_feature",
+        "inner_perimeter_feature",
+        "skirt_feature",
+        "gap_fill_feature",
+        "solid_infill_feature",
+        "ooze_shield_feature",
+        "infill_feature",
+        "prime_pillar_feature",
+    ]
+
     def __init__(self):
         super(ArcWelderPlugin, self).__init__()
         self.preprocessing_job_guid = None
@@ -105,11 +121,29 @@ class ArcWelderPlugin(
         self.preprocessing_job_target_file_name = ""
         self.is_cancelled = False
         self._processing_queue = queue.Queue()
+        self._live_welder = live_welder.LiveWelder()
         self.settings_default = dict(
             use_octoprint_settings=True,
             g90_g91_influences_extruder=False,
             resolution_mm=0.05,
             max_radius_mm=1000*1000,  # 1KM, pretty big :)
+            allow_g5_splines=False,
+            allow_3d_arcs=False,
+            feedrate_tolerance_percent=0,
+            # 0 disables arc coalescing
+            max_coalesced_sweep_degrees=0,
+            # 0 disables the segmentation lookahead
+            segmentation_lookahead=0,
+            float_fitting=False,
+            command_rate_limit=0,
+            min_estimated_compression_percent=0,
+            # Per feature type overrides.  None uses resolution_mm/max_radius_mm
+            feature_resolution_mm=dict(
+                (feature_type, None) for feature_type in ArcWelderPlugin.FEATURE_TYPES
+            ),
+            feature_max_radius_mm=dict(
+                (feature_type, None) for feature_type in ArcWelderPlugin.FEATURE_TYPES
+            ),
             overwrite_source_file=False,
             target_prefix="",
             target_postfix=".aw",
@@ -123,6 +157,8 @@ class ArcWelderPlugin(
                 delete_source=ArcWelderPlugin.SOURCE_FILE_DELETE_DISABLED
             ),
             enabled=True,
+            # Weld files that were never preprocessed as they are sent to the printer
+            live_welding_enabled=False,
             logging_configuration=dict(
                 default_log_level=log.ERROR,
                 log_to_console=False,
@@ -146,6 +182,7 @@ class ArcWelderPlugin(
             self.preprocessing_progress,
             self.preprocessing_cancelled,
             self.preprocessing_failed,
+            self.preprocessing_skipped,
             self.preprocessing_success,
             self.preprocessing_completed,
         )
@@ -335,6 +372,13 @@ class ArcWelderPlugin(
             enabled = self.settings_default["enabled"]
         return enabled
 
+    @property
+    def _live_welding_enabled(self):
+        live_welding_enabled = self._settings.get_boolean(["live_welding_enabled"])
+        if live_welding_enabled is None:
+            live_welding_enabled = self.settings_default["live_welding_enabled"]
+        return live_welding_enabled
+
     @property
     def _delete_source_after_manual_processing(self):
         return self._settings.get(["feature_settings", "delete_source"]) in [
@@ -390,6 +434,79 @@ class ArcWelderPlugin(
             max_radius_mm = self.settings_default["max_radius_mm"]
         return max_radius_mm
 
+    @property
+    def _allow_g5_splines(self):
+        allow_g5_splines = self._settings.get_boolean(["allow_g5_splines"])
+        if allow_g5_splines is None:
+            allow_g5_splines = self.settings_default["allow_g5_splines"]
+        return allow_g5_splines
+
+    @property
+    def _allow_3d_arcs(self):
+        allow_3d_arcs = self._settings.get_boolean(["allow_3d_arcs"])
+        if allow_3d_arcs is None:
+            allow_3d_arcs = self.settings_default["allow_3d_arcs"]
+        return allow_3d_arcs
+
+    @property
+    def _feedrate_tolerance_percent(self):
+        feedrate_tolerance_percent = self._settings.get_float(["feedrate_tolerance_percent"])
+        if feedrate_tolerance_percent is None:
+            feedrate_tolerance_percent = self.settings_default["feedrate_tolerance_percent"]
+        return feedrate_tolerance_percent
+
+    @property
+    def _max_coalesced_sweep_degrees(self):
+        max_coalesced_sweep_degrees = self._settings.get_float(["max_coalesced_sweep_degrees"])
+        if max_coalesced_sweep_degrees is None:
+            max_coalesced_sweep_degrees = self.settings_default["max_coalesced_sweep_degrees"]
+        return max_coalesced_sweep_degrees
+
+    @property
+    def _segmentation_lookahead(self):
+        segmentation_lookahead = self._settings.get_int(["segmentation_lookahead"])
+        if segmentation_lookahead is None:
+            segmentation_lookahead = self.settings_default["segmentation_lookahead"]
+        return segmentation_lookahead
+
+    @property
+    def _float_fitting(self):
+        float_fitting = self._settings.get_boolean(["float_fitting"])
+        if float_fitting is None:
+            float_fitting = self.settings_default["float_fitting"]
+        return float_fitting
+
+    def _get_feature_settings(self, setting_name):
+        # Only return the feature types that have been overridden
+        feature_settings = {}
+        for feature_type in ArcWelderPlugin.FEATURE_TYPES:
+            value = self._settings.get_float([setting_name, feature_type])
+            if value is not None and value > 0:
+                feature_settings[feature_type] = value
+        return feature_settings
+
+    @property
+    def _feature_resolution_mm(self):
+        return self._get_feature_settings("feature_resolution_mm")
+
+    @property
+    def _feature_max_radius_mm(self):
+        return self._get_feature_settings("feature_max_radius_mm")
+
+    @property
+    def _command_rate_limit(self):
+        command_rate_limit = self._settings.get_float(["command_rate_limit"])
+        if command_rate_limit is None:
+            command_rate_limit = self.settings_default["command_rate_limit"]
+        return command_rate_limit
+
+    @property
+    def _min_estimated_compression_percent(self):
+        min_estimated_compression_percent = self._settings.get_float(["min_estimated_compression_percent"])
+        if min_estimated_compression_percent is None:
+            min_estimated_compression_percent = self.settings_default["min_estimated_compression_percent"]
+        return min_estimated_compression_percent
+
     @property
     def _overwrite_source_file(self):
         overwrite_source_file = self._settings.get_boolean(["overwrite_source_file"])
@@ -448,9 +565,64 @@ class ArcWelderPlugin(
             "resolution_mm": self._resolution_mm,
             "max_radius_mm": self._max_radius_mm,
             "g90_g91_influences_extruder": self._g90_g91_influences_extruder,
+            "allow_g5_splines": self._allow_g5_splines,
+            "allow_3d_arcs": self._allow_3d_arcs,
+            "feedrate_tolerance_percent": self._feedrate_tolerance_percent,
+            "max_coalesced_sweep_degrees": self._max_coalesced_sweep_degrees,
+            "segmentation_lookahead": self._segmentation_lookahead,
+            "float_fitting": self._float_fitting,
+            "command_rate_limit": self._command_rate_limit,
+            "min_estimated_compression_percent": self._min_estimated_compression_percent,
+            "feature_resolution_mm": self._feature_resolution_mm,
+            "feature_max_radius_mm": self._feature_max_radius_mm,
+            "log_level": self._gcode_conversion_log_level
+        }
+
+    def get_live_welding_arguments(self, path):
+        return {
+            "source_file_path": path,
+            "resolution_mm": self._resolution_mm,
+            "max_radius_mm": self._max_radius_mm,
+            "g90_g91_influences_extruder": self._g90_g91_influences_extruder,
+            "allow_g5_splines": self._allow_g5_splines,
+            "allow_3d_arcs": self._allow_3d_arcs,
+            "feedrate_tolerance_percent": self._feedrate_tolerance_percent,
+            "max_coalesced_sweep_degrees": self._max_coalesced_sweep_degrees,
+            "segmentation_lookahead": self._segmentation_lookahead,
+            "float_fitting": self._float_fitting,
+            "command_rate_limit": self._command_rate_limit,
+            "feature_resolution_mm": self._feature_resolution_mm,
+            "feature_max_radius_mm": self._feature_max_radius_mm,
             "log_level": self._gcode_conversion_log_level
         }
 
+    def get_octoprint_analysis(self, analysis):
+        # Convert the analysis returned by the converter into the format produced by OctoPrint's gcode analysis.
+        # Returns None, which lets OctoPrint analyze the file, if there is nothing to convert.
+        if not analysis or not analysis["has_printing_area"]:
+            return None
+        filament = {}
+        for tool, length in enumerate(analysis["filament_length_mm"]):
+            if length > 0:
+                filament["tool{0}".format(tool)] = {"length": length}
+        return {
+            "estimatedPrintTime": analysis["estimated_print_time_seconds"],
+            "filament": filament,
+            "printingArea": {
+                "minX": analysis["min_x"],
+                "maxX": analysis["max_x"],
+                "minY": analysis["min_y"],
+                "maxY": analysis["max_y"],
+                "minZ": analysis["min_z"],
+                "maxZ": analysis["max_z"],
+            },
+            "dimensions": {
+                "width": analysis["max_x"] - analysis["min_x"],
+                "depth": analysis["max_y"] - analysis["min_y"],
+                "height": analysis["max_z"] - analysis["min_z"],
+            },
+        }
+
     def save_preprocessed_file(self, path, preprocessor_args, results, additional_metadata):
         # get the file name and path
         new_path, new_name = self.get_storage_path_and_name(
@@ -469,11 +641,14 @@ class ArcWelderPlugin(
             new_name, preprocessor_args["target_file_path"], move=True
         )
 
+        # The analysis was gathered while welding, so OctoPrint doesn't need to analyze the new file again.
+        analysis = self.get_octoprint_analysis(results.get("analysis"))
         self._file_manager.add_file(
             FileDestinations.LOCAL,
             new_path,
             new_file_object,
             allow_overwrite=True,
+            analysis=analysis,
             display=new_name,
         )
         self._file_manager.set_additional_metadata(
@@ -486,11 +661,15 @@ class ArcWelderPlugin(
             "source_file_total_count": progress["source_file_total_count"],
             "target_file_total_count": progress["target_file_total_count"],
             "segment_statistics_text": progress["segment_statistics_text"],
+            "command_rate_statistics_text": progress["command_rate_statistics_text"],
+            "source_command_rates": progress["source_command_rates"],
+            "target_command_rates": progress["target_command_rates"],
             "seconds_elapsed": progress["seconds_elapsed"],
             "gcodes_processed": progress["gcodes_processed"],
             "lines_processed": progress["lines_processed"],
             "points_compressed": progress["points_compressed"],
             "arcs_created": progress["arcs_created"],
+            "splines_created": progress["splines_created"],
             "source_file_size": progress["source_file_size"],
             "source_file_position": progress["source_file_position"],
             "target_file_size": progress["target_file_size"],
@@ -498,6 +677,7 @@ class ArcWelderPlugin(
             "compression_percent": progress["compression_percent"],
             "source_filename": results["source_filename"],
             "target_filename": new_name,
+            "layer_count": results["analysis"]["layer_count"] if results.get("analysis") else None,
             "preprocessing_job_guid": self.preprocessing_job_guid
         }
 
@@ -609,10 +789,30 @@ class ArcWelderPlugin(
             "\n\tsource_file_path: %s"
             "\n\tresolution_mm: %.3f"
             "\n\tg90_g91_influences_extruder: %r"
+            "\n\tallow_g5_splines: %r"
+            "\n\tallow_3d_arcs: %r"
+            "\n\tfeedrate_tolerance_percent: %.1f"
+            "\n\tmax_coalesced_sweep_degrees: %.1f"
+            "\n\tsegmentation_lookahead: %d"
+            "\n\tfloat_fitting: %r"
+            "\n\tcommand_rate_limit: %.1f"
+            "\n\tmin_estimated_compression_percent: %.1f"
+            "\n\tfeature_resolution_mm: %r"
+            "\n\tfeature_max_radius_mm: %r"
             "\n\tlog_level: %d",
             preprocessor_args["path"],
             preprocessor_args["resolution_mm"],
             preprocessor_args["g90_g91_influences_extruder"],
+            preprocessor_args["allow_g5_splines"],
+            preprocessor_args["allow_3d_arcs"],
+            preprocessor_args["feedrate_tolerance_percent"],
+            preprocessor_args["max_coalesced_sweep_degrees"],
+            preprocessor_args["segmentation_lookahead"],
+            preprocessor_args["float_fitting"],
+            preprocessor_args["command_rate_limit"],
+            preprocessor_args["min_estimated_compression_percent"],
+            preprocessor_args["feature_resolution_mm"],
+            preprocessor_args["feature_max_radius_mm"],
             preprocessor_args["log_level"]
         )
 
@@ -645,6 +845,7 @@ class ArcWelderPlugin(
                 "lines_processed": progress["lines_processed"],
                 "points_compressed": progress["points_compressed"],
                 "arcs_created": progress["arcs_created"],
+                "splines_created": progress["splines_created"],
                 "source_file_size": progress["source_file_size"],
                 "source_file_position": progress["source_file_position"],
                 "target_file_size": progress["target_file_size"],
@@ -739,6 +940,16 @@ class ArcWelderPlugin(
         }
         self._plugin_manager.send_plugin_message(self._identifier, data)
 
+    def preprocessing_skipped(self, message):
+        data = {
+            "message_type": "preprocessing-skipped",
+            "source_filename": self.preprocessing_job_source_file_path,
+            "target_filename": self.preprocessing_job_target_file_name,
+            "preprocessing_job_guid": self.preprocessing_job_guid,
+            "message": message
+        }
+        self._plugin_manager.send_plugin_message(self._identifier, data)
+
     def on_event(self, event, payload):
 
         # Need to use file added event to catch uploads and other non-upload methods of adding a file.
@@ -768,6 +979,36 @@ class ArcWelderPlugin(
             additional_metadata = self.get_additional_metadata(metadata)
             # Add this file to the processor queue.
             self.add_file_to_preprocessor_queue(path, additional_metadata, False)
+        elif event == Events.PRINT_STARTED:
+            if payload["origin"] == FileDestinations.LOCAL:
+                self.begin_live_welding(payload["path"])
+        elif event == Events.TRANSFER_STARTED:
+            self.begin_live_welding(payload["local"])
+        elif event in [Events.PRINT_DONE, Events.TRANSFER_DONE]:
+            # The held lines were flushed when the last command or M29 was queued.
+            lines = self._live_welder.end()
+            if lines:
+                logger.warning("Discarding %d welded lines that were still held back when the job ended.", len(lines))
+        elif event in [Events.PRINT_FAILED, Events.PRINT_CANCELLED, Events.TRANSFER_FAILED]:
+            self._live_welder.end()
+
+    def begin_live_welding(self, path):
+        if not self._enabled or not self._live_welding_enabled:
+            return
+        if not octoprint.filemanager.valid_file_type(path, type="gcode"):
+            return
+        metadata = self._file_manager.get_metadata(FileDestinations.LOCAL, path)
+        if metadata is not None and "arc_welder" in metadata:
+            # This file was already welded
+            return
+        self._live_welder.begin(
+            path,
+            self.get_live_welding_arguments(path),
+            self._file_manager.path_on_disk(FileDestinations.LOCAL, path)
+        )
+
+    def on_gcode_queuing(self, comm_instance, phase, cmd, cmd_type, gcode, subcode=None, tags=None, *args, **kwargs):
+        return self._live_welder.on_gcode_queuing(cmd, cmd_type, gcode, tags)
 
     def get_additional_metadata(self, metadata):
         # list of supported metadata
@@ -904,7 +1145,8 @@ def __plugin_load__():
     global __plugin_hooks__
     __plugin_hooks__ = {
         "octoprint.plugin.softwareupdate.check_config": __plugin_implementation__.get_update_information,
-        "octoprint.server.http.routes": __plugin_implementation__.register_custom_routes
+        "octoprint.server.http.routes": __plugin_implementation__.register_custom_routes,
+        "octoprint.comm.protocol.gcode.queuing": __plugin_implementation__.on_gcode_queuing
     }
 
 
@@ -0,0 +1,352 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "arc_coalescer.h"
+#include "utilities.h"
+#include <cmath>
+
+void coalescable_arc::clear()
+{
+	is_valid = false;
+	is_clockwise = false;
+	is_xyz_relative = false;
+	is_extruder_relative = false;
+	start_point = point();
+	end_point = point();
+	center = point();
+	relative_x = 0;
+	relative_y = 0;
+	radius = 0;
+	sweep_radians = 0;
+	has_e = false;
+	e_relative = 0;
+	e_absolute = 0;
+	f = 0;
+	has_f = false;
+	deviation_mm = 0;
+}
+
+double coalescable_arc::get_length() const
+{
+	return radius * sweep_radians;
+}
+
+double coalescable_arc::get_sweep_radians_(const point& start_point, const point& end_point, const point& center, bool is_clockwise)
+{
+	const double start_x = start_point.x - center.x;
+	const double start_y = start_point.y - center.y;
+	const double end_x = end_point.x - center.x;
+	const double end_y = end_point.y - center.y;
+	// The counter clockwise angle from the start to the end
+	double sweep = std::atan2(start_x * end_y - start_y * end_x, start_x * end_x + start_y * end_y);
+	if (is_clockwise)
+	{
+		sweep = -sweep;
+	}
+	if (sweep <= 0)
+	{
+		// A full circle when the start and end are the same
+		sweep += 2.0 * PI_DOUBLE;
+	}
+	return sweep;
+}
+
+bool coalescable_arc::is_exact_offset_(double offset)
+{
+	const double thousandths = offset * 1000.0;
+	return std::fabs(thousandths - std::floor(thousandths + 0.5)) < ARC_COALESCE_OFFSET_TOLERANCE_MM * 1000.0;
+}
+
+bool coalescable_arc::try_create(const arc& welded_arc, bool is_xyz_relative, bool is_extruder_relative, double e_relative, double e_absolute, double f, bool has_f, coalescable_arc& target)
+{
+	target.clear();
+	if (!utilities::is_equal(welded_arc.start_point.z, welded_arc.end_point.z) || utilities::is_zero(welded_arc.angle_radians))
+	{
+		return false;
+	}
+	target.is_clockwise = welded_arc.angle_radians < 0;
+	target.is_xyz_relative = is_xyz_relative;
+	target.is_extruder_relative = is_extruder_relative;
+	target.start_point = welded_arc.start_point;
+	target.end_point = welded_arc.end_point;
+	target.center = welded_arc.center;
+	target.relative_x = welded_arc.end_point.x - welded_arc.start_point.x;
+	target.relative_y = welded_arc.end_point.y - welded_arc.start_point.y;
+	target.radius = welded_arc.radius;
+	target.sweep_radians = std::fabs(welded_arc.angle_radians);
+	target.has_e = e_relative != 0;
+	target.e_relative = e_relative;
+	target.e_absolute = e_absolute;
+	target.f = f;
+	target.has_f = has_f;
+	target.is_valid = true;
+	return true;
+}
+
+bool coalescable_arc::try_create(const parsed_command& cmd, const point& start_point, const point& end_point, bool is_xyz_relative, bool is_extruder_relative, double e_relative, double e_absolute, double f, coalescable_arc& target)
+{
+	target.clear();
+	if (cmd.command != "G2" && cmd.command != "G3")
+	{
+		return false;
+	}
+	bool has_i = false, has_j = false;
+	double i = 0, j = 0;
+	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+	{
+		const parsed_command_parameter& param = cmd.parameters[index];
+		if (param.name == "X")
+		{
+			target.relative_x = param.double_value;
+		}
+		else if (param.name == "Y")
+		{
+			target.relative_y = param.double_value;
+		}
+		else if (param.name == "I")
+		{
+			has_i = true;
+			i = param.double_value;
+		}
+		else if (param.name == "J")
+		{
+			has_j = true;
+			j = param.double_value;
+		}
+		else if (param.name == "E")
+		{
+			target.has_e = true;
+		}
+		else if (param.name == "F")
+		{
+			target.has_f = true;
+		}
+		else if (param.name == "R" || param.name == "P")
+		{
+			// Radius form arcs and full circles are left as they are
+			return false;
+		}
+	}
+	if ((!has_i && !has_j) || !utilities::is_equal(start_point.z, end_point.z))
+	{
+		return false;
+	}
+	target.is_clockwise = cmd.command == "G2";
+	target.is_xyz_relative = is_xyz_relative;
+	target.is_extruder_relative = is_extruder_relative;
+	target.start_point = start_point;
+	target.end_point = end_point;
+	target.center = point(start_point.x + i, start_point.y + j, start_point.z, 0);
+	if (!is_xyz_relative)
+	{
+		target.relative_x = end_point.x - start_point.x;
+		target.relative_y = end_point.y - start_point.y;
+	}
+	target.radius = utilities::get_cartesian_distance(start_point.x, start_point.y, target.center.x, target.center.y);
+	if (utilities::is_zero(target.radius))
+	{
+		return false;
+	}
+	target.sweep_radians = get_sweep_radians_(start_point, end_point, target.center, target.is_clockwise);
+	target.e_relative = e_relative;
+	target.e_absolute = e_absolute;
+	target.f = f;
+	target.is_valid = true;
+	return true;
+}
+
+arc_coalescer::arc_coalescer(double resolution_mm, double max_sweep_degrees)
+{
+	resolution_mm_ = resolution_mm;
+	set_max_sweep_degrees(max_sweep_degrees);
+}
+
+arc_coalescer::~arc_coalescer()
+{
+}
+
+void arc_coalescer::set_resolution_mm(double resolution_mm)
+{
+	resolution_mm_ = resolution_mm;
+}
+
+double arc_coalescer::get_resolution_mm() const
+{
+	return resolution_mm_;
+}
+
+void arc_coalescer::set_max_sweep_degrees(double max_sweep_degrees)
+{
+	// An arc can't be more than a full circle
+	if (max_sweep_degrees < 0)
+	{
+		max_sweep_degrees = 0;
+	}
+	else if (max_sweep_degrees > 360)
+	{
+		max_sweep_degrees = 360;
+	}
+	max_sweep_degrees_ = max_sweep_degrees;
+	max_sweep_radians_ = max_sweep_degrees * PI_DOUBLE / 180.0;
+}
+
+double arc_coalescer::get_max_sweep_degrees() const
+{
+	return max_sweep_degrees_;
+}
+
+bool arc_coalescer::is_enabled() const
+{
+	return max_sweep_degrees_ > 0;
+}
+
+bool arc_coalescer::try_merge(const coalescable_arc& pending, const coalescable_arc& next, coalescable_arc& merged) const
+{
+	if (!is_enabled() || !pending.is_valid || !next.is_valid)
+	{
+		return false;
+	}
+	if (
+		pending.is_clockwise != next.is_clockwise ||
+		pending.is_xyz_relative != next.is_xyz_relative ||
+		pending.is_extruder_relative != next.is_extruder_relative ||
+		pending.has_e != next.has_e
+	)
+	{
+		return false;
+	}
+	// The next arc must continue from the end of the pending arc, at the same feedrate
+	if (
+		!utilities::is_equal(pending.end_point.x, next.start_point.x, ARC_COALESCE_POINT_TOLERANCE_MM) ||
+		!utilities::is_equal(pending.end_point.y, next.start_point.y, ARC_COALESCE_POINT_TOLERANCE_MM) ||
+		!utilities::is_equal(pending.end_point.z, next.start_point.z) ||
+		!utilities::is_equal(pending.f, next.f)
+	)
+	{
+		return false;
+	}
+	const double sweep = pending.sweep_radians + next.sweep_radians;
+	if (sweep > max_sweep_radians_)
+	{
+		return false;
+	}
+	if (pending.has_e)
+	{
+		// The extrusion per mm must match, or the joined arc would move filament from one part of the arc to the other
+		const double pending_rate = pending.e_relative / pending.get_length();
+		const double next_rate = next.e_relative / next.get_length();
+		if (std::fabs(pending_rate - next_rate) > std::fabs(pending_rate) * ARC_COALESCE_EXTRUSION_RATE_TOLERANCE)
+		{
+			return false;
+		}
+	}
+
+	// The joined arc's center must be equidistant from its start and end, so it lies on the perpendicular bisector of
+	// the chord.  Use the point on the bisector closest to the average of the two centers.
+	const point& start = pending.start_point;
+	const point& end = next.end_point;
+	const double chord_x = end.x - start.x;
+	const double chord_y = end.y - start.y;
+	const double chord_length = std::sqrt(chord_x * chord_x + chord_y * chord_y);
+	if (chord_length < resolution_mm_)
+	{
+		// The start and end are too close to place the center accurately
+		return false;
+	}
+	const double normal_x = -chord_y / chord_length;
+	const double normal_y = chord_x / chord_length;
+	const double mid_x = (start.x + end.x) / 2.0;
+	const double mid_y = (start.y + end.y) / 2.0;
+	const double distance = ((pending.center.x + next.center.x) / 2.0 - mid_x) * normal_x + ((pending.center.y + next.center.y) / 2.0 - mid_y) * normal_y;
+	const point center(mid_x + distance * normal_x, mid_y + distance * normal_y, start.z, 0);
+	const double radius = utilities::get_cartesian_distance(start.x, start.y, center.x, center.y);
+
+	// Every point on an arc is within the center offset plus the radius difference of the joined circle
+	const double pending_deviation = pending.deviation_mm + utilities::get_cartesian_distance(center.x, center.y, pending.center.x, pending.center.y) + std::fabs(radius - pending.radius);
+	const double next_deviation = next.deviation_mm + utilities::get_cartesian_distance(center.x, center.y, next.center.x, next.center.y) + std::fabs(radius - next.radius);
+	if (pending_deviation > resolution_mm_ || next_deviation > resolution_mm_)
+	{
+		return false;
+	}
+	// The joined arc must go the same way around the circle as the arcs it replaces
+	const double merged_sweep = coalescable_arc::get_sweep_radians_(start, end, center, pending.is_clockwise);
+	if (std::fabs(merged_sweep - sweep) * radius > resolution_mm_)
+	{
+		return false;
+	}
+
+	// In relative mode the joined arc writes the sum of the offsets written for each arc, which must not be truncated
+	const double relative_x = pending.relative_x + next.relative_x;
+	const double relative_y = pending.relative_y + next.relative_y;
+	if (pending.is_xyz_relative && (!coalescable_arc::is_exact_offset_(relative_x) || !coalescable_arc::is_exact_offset_(relative_y)))
+	{
+		return false;
+	}
+
+	merged = pending;
+	merged.end_point = next.end_point;
+	merged.relative_x = relative_x;
+	merged.relative_y = relative_y;
+	merged.center = center;
+	merged.radius = radius;
+	merged.sweep_radians = merged_sweep;
+	merged.e_relative = pending.e_relative + next.e_relative;
+	merged.e_absolute = next.e_absolute;
+	merged.deviation_mm = pending_deviation > next_deviation ? pending_deviation : next_deviation;
+	return true;
+}
+
+std::string arc_coalescer::get_gcode(const coalescable_arc& arc)
+{
+	char buf[20];
+	std::string gcode = arc.is_clockwise ? "G2" : "G3";
+	// In relative mode (G91) the endpoint is an offset from the start point.  I and J are always relative.
+	double x = arc.end_point.x;
+	double y = arc.end_point.y;
+	if (arc.is_xyz_relative)
+	{
+		// The offsets are exact to 3 decimal places, so move them away from 0 by less than that before they are truncated
+		x = arc.relative_x + (arc.relative_x < 0 ? -ARC_COALESCE_OFFSET_TOLERANCE_MM : ARC_COALESCE_OFFSET_TOLERANCE_MM);
+		y = arc.relative_y + (arc.relative_y < 0 ? -ARC_COALESCE_OFFSET_TOLERANCE_MM : ARC_COALESCE_OFFSET_TOLERANCE_MM);
+	}
+	gcode += " X";
+	gcode += utilities::to_string(x, 3, buf);
+	gcode += " Y";
+	gcode += utilities::to_string(y, 3, buf);
+	gcode += " I";
+	gcode += utilities::to_string(arc.center.x - arc.start_point.x, 3, buf);
+	gcode += " J";
+	gcode += utilities::to_string(arc.center.y - arc.start_point.y, 3, buf);
+	if (arc.has_e)
+	{
+		gcode += " E";
+		gcode += utilities::to_string(arc.is_extruder_relative ? arc.e_relative : arc.e_absolute, 5, buf);
+	}
+	if (arc.has_f && utilities::greater_than_or_equal(arc.f, 1))
+	{
+		gcode += " F";
+		gcode += utilities::to_string(arc.f, 0, buf);
+	}
+	return gcode;
+}
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include "segmented_shape.h"
+#include "parsed_command.h"
+
+// Coalescing is disabled unless a max sweep is set
+#define DEFAULT_MAX_COALESCED_SWEEP_DEGREES 0.0
+// Two arcs are only joined if their extrusion per mm differs by less than this fraction
+#define ARC_COALESCE_EXTRUSION_RATE_TOLERANCE 0.01
+// Endpoints closer than this are considered the same point
+#define ARC_COALESCE_POINT_TOLERANCE_MM 0.0005
+// Relative offsets within this of 3 decimal places are written exactly
+#define ARC_COALESCE_OFFSET_TOLERANCE_MM 0.0000001
+
+// A G2/G3 arc in the XY plane, in gcode coordinates, as it is written to the target.
+struct coalescable_arc
+{
+	coalescable_arc() {
+		clear();
+	}
+	void clear();
+	bool is_valid;
+	bool is_clockwise;
+	bool is_xyz_relative;
+	bool is_extruder_relative;
+	// The absolute start, end and center, even when the arc is written in relative mode (G91)
+	point start_point;
+	point end_point;
+	point center;
+	// The X and Y offsets written in relative mode.  These differ from the end less the start by the rounding error
+	// the welder carries from arc to arc, and joined arcs write the sum so the target stays at the same position.
+	double relative_x;
+	double relative_y;
+	double radius;
+	// Always positive
+	double sweep_radians;
+	bool has_e;
+	// The extrusion of the arc, and the absolute E at its end
+	double e_relative;
+	double e_absolute;
+	// The feedrate of the arc, and whether it must be written with the arc
+	double f;
+	bool has_f;
+	// The furthest the arc may be from the arcs it was coalesced from
+	double deviation_mm;
+	double get_length() const;
+	// Creates an arc from one written by the welder.  Helical arcs can't be coalesced.
+	static bool try_create(const arc& welded_arc, bool is_xyz_relative, bool is_extruder_relative, double e_relative, double e_absolute, double f, bool has_f, coalescable_arc& target);
+	// Creates an arc from a G2/G3 in the source.  Only arcs with I and J, without a Z change, R or P, can be coalesced.
+	static bool try_create(const parsed_command& cmd, const point& start_point, const point& end_point, bool is_xyz_relative, bool is_extruder_relative, double e_relative, double e_absolute, double f, coalescable_arc& target);
+private:
+	static double get_sweep_radians_(const point& start_point, const point& end_point, const point& center, bool is_clockwise);
+	// True if the offset can be written to 3 decimal places without changing it
+	static bool is_exact_offset_(double offset);
+	friend class arc_coalescer;
+};
+
+// Joins consecutive arcs that lie on the same circle into a single arc, after the arcs have been fit.
+class arc_coalescer
+{
+public:
+	arc_coalescer(double resolution_mm = DEFAULT_RESOLUTION_MM, double max_sweep_degrees = DEFAULT_MAX_COALESCED_SWEEP_DEGREES);
+	virtual ~arc_coalescer();
+	void set_resolution_mm(double resolution_mm);
+	double get_resolution_mm() const;
+	void set_max_sweep_degrees(double max_sweep_degrees);
+	double get_max_sweep_degrees() const;
+	bool is_enabled() const;
+	// Joins next onto the end of pending if their centers and radii agree within the resolution, they have the same
+	// direction, feedrate and extrusion rate, and the joined arc doesn't sweep more than the max sweep.
+	bool try_merge(const coalescable_arc& pending, const coalescable_arc& next, coalescable_arc& merged) const;
+	static std::string get_gcode(const coalescable_arc& arc);
+private:
+	double resolution_mm_;
+	double max_sweep_degrees_;
+	double max_sweep_radians_;
+};
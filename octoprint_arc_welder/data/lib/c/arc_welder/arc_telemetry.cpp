@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "arc_telemetry.h"
+
+arc_telemetry::arc_telemetry()
+{
+	file_ = NULL;
+	buffer_.resize(ARC_TELEMETRY_BUFFER_RECORDS);
+	buffer_count_ = 0;
+	num_records_ = 0;
+	has_error_ = false;
+}
+
+arc_telemetry::arc_telemetry(const arc_telemetry&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+arc_telemetry::~arc_telemetry()
+{
+	close();
+}
+
+bool arc_telemetry::open(const std::string& file_path)
+{
+	close();
+	file_ = fopen(file_path.c_str(), "wb");
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	buffer_count_ = 0;
+	num_records_ = 0;
+	// The header is the magic, the version and the record size
+	const unsigned int version = ARC_TELEMETRY_VERSION;
+	const unsigned int record_size = sizeof(arc_telemetry_record);
+	has_error_ = fwrite(ARC_TELEMETRY_MAGIC, 1, 4, file_) != 4
+		|| fwrite(&version, sizeof(version), 1, file_) != 1
+		|| fwrite(&record_size, sizeof(record_size), 1, file_) != 1;
+	return !has_error_;
+}
+
+bool arc_telemetry::is_open() const
+{
+	return file_ != NULL;
+}
+
+void arc_telemetry::flush()
+{
+	if (file_ != NULL && !has_error_ && buffer_count_ > 0)
+	{
+		has_error_ = fwrite(&buffer_[0], sizeof(arc_telemetry_record), buffer_count_, file_) != static_cast<size_t>(buffer_count_);
+	}
+	num_records_ += buffer_count_;
+	buffer_count_ = 0;
+}
+
+bool arc_telemetry::close()
+{
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	flush();
+	const bool success = fclose(file_) == 0 && !has_error_;
+	file_ = NULL;
+	return success;
+}
+
+long arc_telemetry::get_num_records() const
+{
+	return num_records_ + buffer_count_;
+}
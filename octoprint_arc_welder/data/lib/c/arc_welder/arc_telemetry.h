@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#define ARC_TELEMETRY_MAGIC "AWTM"
+#define ARC_TELEMETRY_VERSION 1
+// The number of records buffered before they are written to the file
+#define ARC_TELEMETRY_BUFFER_RECORDS 4096
+
+// Why a shape in progress ended, or what it became.  These values are stored in the telemetry file, so only add new
+// values to the end, and keep the names in octoprint_arc_welder/telemetry.py in sync.
+enum arc_telemetry_decision
+{
+	arc_telemetry_arc_emitted,
+	arc_telemetry_spline_emitted,
+	arc_telemetry_too_few_segments,
+	arc_telemetry_not_g0_g1,
+	arc_telemetry_z_changed,
+	arc_telemetry_xyz_mode_changed,
+	arc_telemetry_extrusion_changed,
+	arc_telemetry_extruder_mode_changed,
+	arc_telemetry_feedrate_changed,
+	arc_telemetry_feature_changed,
+	arc_telemetry_offset_changed,
+	arc_telemetry_max_segments,
+	arc_telemetry_no_distance,
+	arc_telemetry_radius_exceeded,
+	arc_telemetry_no_fit,
+	arc_telemetry_unknown
+};
+
+// A fixed size (16 byte) telemetry record
+struct arc_telemetry_record
+{
+	int line_number;
+	int layer;
+	unsigned char decision;
+	unsigned char feature_type;
+	unsigned short num_segments;
+	float radius;
+};
+
+// Writes a stream of arc_telemetry_records to a file.  Records are copied into a fixed buffer and written in large
+// blocks, so adding one costs about as much as a struct copy.
+class arc_telemetry
+{
+public:
+	arc_telemetry();
+	virtual ~arc_telemetry();
+	bool open(const std::string& file_path);
+	bool is_open() const;
+	bool close();
+	void add_record(int line_number, int layer, arc_telemetry_decision decision, int feature_type, int num_segments, double radius)
+	{
+		arc_telemetry_record& record = buffer_[buffer_count_];
+		record.line_number = line_number;
+		record.layer = layer;
+		record.decision = static_cast<unsigned char>(decision);
+		record.feature_type = static_cast<unsigned char>(feature_type);
+		record.num_segments = static_cast<unsigned short>(num_segments > 65535 ? 65535 : num_segments);
+		record.radius = static_cast<float>(radius);
+		if (++buffer_count_ == ARC_TELEMETRY_BUFFER_RECORDS)
+		{
+			flush();
+		}
+	}
+	long get_num_records() const;
+private:
+	arc_telemetry(const arc_telemetry& source);
+	void flush();
+	FILE* file_;
+	std::vector<arc_telemetry_record> buffer_;
+	int buffer_count_;
+	long num_records_;
+	bool has_error_;
+};
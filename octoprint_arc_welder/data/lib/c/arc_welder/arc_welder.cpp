@@ -29,6 +29,7 @@
 #include "arc_welder.h"
 #include <vector>
 #include <sstream>
+#include <algorithm>
 #include "utilities.h"
 #include <iostream>
 #include <fstream>
@@ -36,7 +37,7 @@
 #include <sstream>
 
 
-arc_welder::arc_welder(std::string source_path, std::string target_path, logger * log, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, progress_callback callback) : current_arc_(DEFAULT_MIN_SEGMENTS, buffer_size - 5, resolution_mm, max_radius), segment_statistics_(segment_statistic_lengths, segment_statistic_lengths_count, log)
+arc_welder::arc_welder(std::string source_path, std::string target_path, logger * log, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, bool allow_g5_splines, bool allow_3d_arcs, double feedrate_tolerance_percent, double command_rate_limit, bool dry_run, progress_callback callback) : segment_statistics_(segment_statistic_lengths, segment_statistic_lengths_count, log), source_command_rates_(DEFAULT_COMMAND_RATE_WINDOW_SECONDS, command_rate_limit), target_command_rates_(DEFAULT_COMMAND_RATE_WINDOW_SECONDS, command_rate_limit), current_arc_(DEFAULT_MIN_SEGMENTS, buffer_size - 5, resolution_mm, max_radius, allow_3d_arcs), current_bezier_(DEFAULT_MIN_BEZIER_SEGMENTS, buffer_size - 5, resolution_mm), segmentation_optimizer_(buffer_size - 5, resolution_mm, max_radius, allow_3d_arcs, allow_g5_splines)
 {
 	p_logger_ = log;
 	debug_logging_enabled_ = false;
@@ -49,17 +50,51 @@ arc_welder::arc_welder(std::string source_path, std::string target_path, logger
 	verbose_output_ = false;
 	source_path_ = source_path;
 	target_path_ = target_path;
+	parsed_command_file_path_ = "";
+	line_offset_index_path_ = "";
+	source_line_map_path_ = "";
+	map_source_lines_ = false;
+	telemetry_path_ = "";
+	telemetry_enabled_ = false;
+	p_output_file_ = NULL;
+	p_stream_output_ = NULL;
+	target_compression_threads_ = DEFAULT_COMPRESSION_THREADS;
+	target_meatpack_ = false;
+	has_pending_arc_ = false;
+	pending_arc_merges_ = 0;
+	arcs_coalesced_ = 0;
+	segmentation_lookahead_ = DEFAULT_SEGMENTATION_LOOKAHEAD;
 	resolution_mm_ = resolution_mm;
+	max_radius_mm_ = current_arc_.get_max_radius();
+	// Every feature type uses the default resolution and max radius unless overridden
+	for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+	{
+		feature_resolution_mm_[index] = resolution_mm_;
+		feature_max_radius_mm_[index] = max_radius_mm_;
+	}
 	gcode_position_args_ = get_args_(g90_g91_influences_extruder, buffer_size);
 	notification_period_seconds = 1;
+	source_line_offset_ = -1;
 	lines_processed_ = 0;
 	gcodes_processed_ = 0;
 	file_size_ = 0;
 	last_gcode_line_written_ = 0;
 	points_compressed_ = 0;
 	arcs_created_ = 0;
+	splines_created_ = 0;
+	target_lines_written_ = 0;
+	target_file_size_ = 0;
+	allow_g5_splines_ = allow_g5_splines;
+	allow_3d_arcs_ = allow_3d_arcs;
+	dry_run_ = dry_run;
+	feedrate_tolerance_percent_ = feedrate_tolerance_percent < 0 ? 0 : feedrate_tolerance_percent;
+	arc_min_feedrate_ = 0;
+	arc_max_feedrate_ = 0;
+	arc_fitting_ = false;
+	bezier_fitting_ = false;
 	waiting_for_arc_ = false;
 	previous_feedrate_ = -1;
+	unrestored_feedrate_ = -1;
 	previous_is_extruder_relative_ = false;
 	gcode_position_args_.set_num_extruders(8);
 	for (int index = 0; index < 8; index++)
@@ -111,6 +146,10 @@ gcode_position_args arc_welder::get_args_(bool g90_g91_influences_extruder, int
 arc_welder::~arc_welder()
 {
 	delete p_source_position_;
+	if (p_output_file_ != NULL)
+	{
+		delete p_output_file_;
+	}
 }
 
 void arc_welder::set_logger_type(int logger_type)
@@ -118,27 +157,129 @@ void arc_welder::set_logger_type(int logger_type)
 	logger_type_ = logger_type;
 }
 
+void arc_welder::set_feature_resolution_mm(int feature_type, double resolution_mm)
+{
+	if (feature_type < 0 || feature_type >= NUM_FEATURE_TYPES || resolution_mm <= 0)
+		return;
+	feature_resolution_mm_[feature_type] = resolution_mm;
+}
+
+void arc_welder::set_feature_max_radius_mm(int feature_type, double max_radius_mm)
+{
+	if (feature_type < 0 || feature_type >= NUM_FEATURE_TYPES || max_radius_mm <= 0)
+		return;
+	if (max_radius_mm > DEFAULT_MAX_RADIUS_MM) max_radius_mm = DEFAULT_MAX_RADIUS_MM;
+	feature_max_radius_mm_[feature_type] = max_radius_mm;
+}
+
+void arc_welder::set_parsed_command_file_path(std::string parsed_command_file_path)
+{
+	parsed_command_file_path_ = parsed_command_file_path;
+}
+
+void arc_welder::set_line_offset_index_path(std::string line_offset_index_path)
+{
+	line_offset_index_path_ = line_offset_index_path;
+}
+
+void arc_welder::set_source_line_map_path(std::string source_line_map_path)
+{
+	source_line_map_path_ = source_line_map_path;
+}
+
+void arc_welder::set_telemetry_path(std::string telemetry_path)
+{
+	telemetry_path_ = telemetry_path;
+}
+
+void arc_welder::set_target_compression_threads(int num_threads)
+{
+	target_compression_threads_ = num_threads < 0 ? 0 : num_threads;
+}
+
+void arc_welder::set_target_meatpack(bool target_meatpack)
+{
+	target_meatpack_ = target_meatpack;
+}
+
+void arc_welder::set_max_coalesced_sweep_degrees(double max_sweep_degrees)
+{
+	arc_coalescer_.set_max_sweep_degrees(max_sweep_degrees);
+}
+
+void arc_welder::set_segmentation_lookahead(int num_segments)
+{
+	// The last piece of each window is held back in case it continues, so a window shorter than the longest shape could never finish one
+	if (num_segments > 0 && num_segments < current_arc_.get_max_segments())
+	{
+		num_segments = current_arc_.get_max_segments();
+	}
+	segmentation_lookahead_ = num_segments < 0 ? 0 : num_segments;
+}
+
+void arc_welder::set_float_fitting(bool float_fitting)
+{
+	current_arc_.set_float_fitting(float_fitting);
+	segmentation_optimizer_.set_float_fitting(float_fitting);
+}
+
+void arc_welder::set_shape_tolerances(int feature_type_tag)
+{
+	if (feature_type_tag < 0 || feature_type_tag >= NUM_FEATURE_TYPES)
+	{
+		feature_type_tag = feature_type_unknown_feature;
+	}
+	current_arc_.set_resolution_mm(feature_resolution_mm_[feature_type_tag]);
+	current_arc_.set_max_radius(feature_max_radius_mm_[feature_type_tag]);
+	current_bezier_.set_resolution_mm(feature_resolution_mm_[feature_type_tag]);
+	segmentation_optimizer_.set_resolution_mm(feature_resolution_mm_[feature_type_tag]);
+	segmentation_optimizer_.set_max_radius(feature_max_radius_mm_[feature_type_tag]);
+}
+
 void arc_welder::reset()
 {
 	p_logger_->log(logger_type_, DEBUG, "Resetting all tracking variables.");
+	source_line_offset_ = -1;
 	lines_processed_ = 0;
 	gcodes_processed_ = 0;
 	last_gcode_line_written_ = 0;
 	file_size_ = 0;
 	points_compressed_ = 0;
 	arcs_created_ = 0;
+	splines_created_ = 0;
+	target_lines_written_ = 0;
+	target_file_size_ = 0;
+	source_command_rates_.clear();
+	target_command_rates_.clear();
+	analysis_.clear();
 	waiting_for_arc_ = false;
+	clear_shapes();
+	has_pending_arc_ = false;
+	pending_arc_merges_ = 0;
+	arcs_coalesced_ = 0;
+	lookahead_points_.clear();
+	lookahead_commands_.clear();
+	relative_position_error_ = vector();
+	// Coalesced arcs may span features, so they must be within the finest resolution of any feature
+	double coalesce_resolution_mm = resolution_mm_;
+	for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+	{
+		if (feature_resolution_mm_[index] < coalesce_resolution_mm)
+		{
+			coalesce_resolution_mm = feature_resolution_mm_[index];
+		}
+	}
+	arc_coalescer_.set_resolution_mm(coalesce_resolution_mm);
 }
 
 long arc_welder::get_file_size(const std::string& file_path)
 {
-	// Todo:  Fix this function.  This is a pretty weak implementation :(
-	std::ifstream file(file_path.c_str(), std::ios::in | std::ios::binary);
-	const long l = (long)file.tellg();
-	file.seekg(0, std::ios::end);
-	const long m = (long)file.tellg();
-	file.close();
-	return (m - l);
+	long long file_size, modified_time;
+	if (!utilities::get_file_info(file_path, file_size, modified_time))
+	{
+		return 0;
+	}
+	return static_cast<long>(file_size);
 }
 
 double arc_welder::get_next_update_time() const
@@ -165,7 +306,18 @@ arc_welder_results results;
 	stream << "arc_welder::process - Parameters received: source_file_path: '" <<
 		source_path_ << "', target_file_path:'" << target_path_ << "', resolution_mm:" <<
 		resolution_mm_ << "mm (+-" << current_arc_.get_resolution_mm() << "mm), max_radius_mm:" << current_arc_.get_max_radius()
-		 << "mm, g90_91_influences_extruder: " << (p_source_position_->get_g90_91_influences_extruder() ? "True" : "False");
+		 << "mm, g90_91_influences_extruder: " << (p_source_position_->get_g90_91_influences_extruder() ? "True" : "False")
+		 << ", allow_g5_splines: " << (allow_g5_splines_ ? "True" : "False")
+		 << ", allow_3d_arcs: " << (allow_3d_arcs_ ? "True" : "False")
+		 << ", feedrate_tolerance_percent: " << feedrate_tolerance_percent_
+		 << ", dry_run: " << (dry_run_ ? "True" : "False");
+	for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+	{
+		if (feature_resolution_mm_[index] != resolution_mm_ || feature_max_radius_mm_[index] != max_radius_mm_)
+		{
+			stream << ", " << feature_type_name[index] << ": resolution_mm:" << feature_resolution_mm_[index] << "mm, max_radius_mm:" << feature_max_radius_mm_[index] << "mm";
+		}
+	}
 	p_logger_->log(logger_type_, INFO, stream.str());
 
 
@@ -174,9 +326,6 @@ arc_welder_results results;
 	// local variable to hold the progress update return.  If it's false, we will exit.
 	bool continue_processing = true;
 	
-	p_logger_->log(logger_type_, DEBUG, "Configuring progress updates.");
-	int read_lines_before_clock_check = 5000;
-	double next_update_time = get_next_update_time();
 	const clock_t start_clock = clock();
 	p_logger_->log(logger_type_, DEBUG, "Getting source file size.");
 	file_size_ = get_file_size(source_path_);
@@ -184,111 +333,563 @@ arc_welder_results results;
 	stream.str("");
 	stream << "Source file size: " << file_size_;
 	p_logger_->log(logger_type_, DEBUG, stream.str());
-	// Create the source file read stream and target write stream
-	std::ifstream gcodeFile;
-	p_logger_->log(logger_type_, DEBUG, "Opening the source file for reading.");
-	gcodeFile.open(source_path_.c_str(), std::ifstream::in);
-	if (!gcodeFile.is_open())
+	// If the source was already parsed, read the parsed commands instead of the source.  Otherwise save them while parsing.
+	parsed_command_file_reader parsed_command_reader;
+	parsed_command_file_writer parsed_command_writer;
+	const compression_type source_compression = input_decoder::get_compression_type(source_path_);
+	if (!input_decoder::is_supported(source_compression))
 	{
 		results.success = false;
-		results.message = "Unable to open the source file.";
+		results.message = "The source file is compressed, but this build does not support its compression type.";
 		p_logger_->log_exception(logger_type_, results.message);
 		return results;
 	}
-	p_logger_->log(logger_type_, DEBUG, "Source file opened successfully.");
+	if (parsed_command_file_path_.length() > 0 && source_compression != compression_none)
+	{
+		// The parsed command file only stores decompressed offsets, which can't be used to report progress.
+		p_logger_->log(logger_type_, INFO, "The source file is compressed, the parsed command file will not be used.");
+	}
+	else if (parsed_command_file_path_.length() > 0)
+	{
+		long long source_file_size, source_modified_time;
+		if (!utilities::get_file_info(source_path_, source_file_size, source_modified_time))
+		{
+			p_logger_->log(logger_type_, WARNING, "Unable to get the source file info, the parsed command file will not be used.");
+		}
+		else if (parsed_command_reader.open(parsed_command_file_path_, source_file_size, source_modified_time))
+		{
+			p_logger_->log(logger_type_, INFO, "Reading the source from the parsed command file.");
+		}
+		else if (parsed_command_writer.open(parsed_command_file_path_, source_file_size, source_modified_time))
+		{
+			p_logger_->log(logger_type_, INFO, "The parsed command file is missing or out of date, it will be rebuilt.");
+		}
+		else
+		{
+			p_logger_->log(logger_type_, WARNING, "Unable to open the parsed command file for writing.");
+		}
+	}
+	// Create the source file read stream and target write stream
+	line_reader gcodeFile;
+	if (!parsed_command_reader.is_open())
+	{
+		p_logger_->log(logger_type_, DEBUG, "Opening the source file for reading.");
+		if (!gcodeFile.open(source_path_))
+		{
+			results.success = false;
+			results.message = "Unable to open the source file.";
+			p_logger_->log_exception(logger_type_, results.message);
+			return results;
+		}
+		p_logger_->log(logger_type_, DEBUG, "Source file opened successfully.");
+	}
 
-	p_logger_->log(logger_type_, DEBUG, "Opening the target file for writing.");
-	output_file_.open(target_path_.c_str(), std::ifstream::out);
-	if (!output_file_.is_open())
+	if (dry_run_)
 	{
-		results.success = false;
-		results.message = "Unable to open the target file.";
-		p_logger_->log_exception(logger_type_, results.message);
-		gcodeFile.close();
-		return results;
+		p_logger_->log(logger_type_, DEBUG, "Dry run enabled, the target file will not be written.");
+	}
+	else
+	{
+		p_logger_->log(logger_type_, DEBUG, "Opening the target file for writing.");
+		if (p_output_file_ != NULL)
+		{
+			delete p_output_file_;
+			p_stream_output_ = NULL;
+		}
+		const compression_type target_compression = output_encoder::get_compression_type(target_path_);
+		if (target_compression_threads_ > 0 && target_compression != compression_gzip && target_compression != compression_zstd)
+		{
+			p_logger_->log(logger_type_, WARNING, "Compression threads are only used for .gz and .zst targets, the target will be written on this thread.");
+		}
+		p_output_file_ = output_encoder::create(target_compression, target_compression_threads_, target_meatpack_);
+		if (p_output_file_ != NULL)
+		{
+			p_output_file_->set_source_file_path(source_path_);
+		}
+		if (p_output_file_ == NULL || !p_output_file_->open(target_path_))
+		{
+			results.success = false;
+			if (p_output_file_ != NULL)
+			{
+				results.message = "Unable to open the target file.";
+			}
+			else if (target_meatpack_ && target_compression == compression_bgcode)
+			{
+				results.message = "Binary gcode targets can't be packed with MeatPack.";
+			}
+			else
+			{
+				results.message = "The target file is compressed, but this build does not support its compression type.";
+			}
+			p_logger_->log_exception(logger_type_, results.message);
+			gcodeFile.close();
+			parsed_command_writer.discard();
+			return results;
+		}
+		p_logger_->log(logger_type_, DEBUG, "Target file opened successfully.");
 	}
-	p_logger_->log(logger_type_, DEBUG, "Target file opened successfully.");
-	std::string line;
-	int lines_with_no_commands = 0;
 	//gcodeFile.sync_with_stdio(false);
 	//output_file_.sync_with_stdio(false);
 	
 	add_arcwelder_comment_to_target();
 	
 	parsed_command cmd;
-	// Communicate every second
 	p_logger_->log(logger_type_, DEBUG, "Processing source file.");
-	while (std::getline(gcodeFile, line) && continue_processing)
+	source_line_map_.clear();
+	map_source_lines_ = source_line_map_path_.length() > 0;
+	if (telemetry_path_.length() > 0)
 	{
-		lines_processed_++;
+		telemetry_enabled_ = telemetry_.open(telemetry_path_);
+		if (!telemetry_enabled_)
+		{
+			p_logger_->log(logger_type_, WARNING, "Unable to open the telemetry file.");
+		}
+	}
+	line_offset_index source_line_index;
+	line_offset_index* p_source_line_index = line_offset_index_path_.length() > 0 ? &source_line_index : NULL;
+	// Select the specialization of the main loop once, so that the logging and progress checks are not made for every line.
+	const bool report_progress = progress_callback_ != NULL || info_logging_enabled_;
+	if (debug_logging_enabled_)
+	{
+		continue_processing = report_progress
+			? process_source_<true, true>(gcodeFile, parsed_command_reader, parsed_command_writer, p_source_line_index, cmd, start_clock)
+			: process_source_<true, false>(gcodeFile, parsed_command_reader, parsed_command_writer, p_source_line_index, cmd, start_clock);
+	}
+	else
+	{
+		continue_processing = report_progress
+			? process_source_<false, true>(gcodeFile, parsed_command_reader, parsed_command_writer, p_source_line_index, cmd, start_clock)
+			: process_source_<false, false>(gcodeFile, parsed_command_reader, parsed_command_writer, p_source_line_index, cmd, start_clock);
+	}
 
-		cmd.clear();
-		if (verbose_logging_enabled_)
+	const bool source_file_read = !gcodeFile.has_error();
+	if (!source_file_read)
+	{
+		results.message = "Unable to read the source file to the end, it may be corrupt.";
+		p_logger_->log_exception(logger_type_, results.message);
+	}
+
+	if (has_shape_to_finish_())
+	{
+		p_logger_->log(logger_type_, DEBUG, "The target file opened successfully.");
+		process_gcode(cmd, true, false);
+	}
+	p_logger_->log(logger_type_, DEBUG, "Writing all unwritten gcodes to the target file.");
+	write_unwritten_gcodes_to_file();
+	write_pending_arc_();
+	if (arc_coalescer_.is_enabled())
+	{
+		LOG_LAZY(p_logger_, logger_type_, INFO, "Coalesced " << arcs_coalesced_ << " arcs.");
+	}
+	p_logger_->log(logger_type_, DEBUG, "Calculating the source and target command rates.");
+	source_command_rates_.update_summary();
+	target_command_rates_.update_summary();
+	analysis_.estimated_print_time_seconds = target_command_rates_.get_summary().total_seconds;
+	p_logger_->log(logger_type_, DEBUG, "Fetching the final progress struct.");
+
+	const long source_bytes_read = gcodeFile.is_compressed() ? gcodeFile.get_position() : static_cast<long>(file_size_);
+	arc_welder_progress final_progress = get_progress_(static_cast<long>(file_size_), source_bytes_read, static_cast<double>(start_clock));
+	if (progress_callback_ != NULL || info_logging_enabled_)
+	{
+		// Sending final progress update message
+		p_logger_->log(logger_type_, VERBOSE, "Sending final progress update message.");
+		on_progress_(final_progress);
+	}
+	p_logger_->log(logger_type_, DEBUG, "Processing complete, closing source and target file.");
+	bool target_file_written = true;
+	if (!dry_run_)
+	{
+		if (!p_output_file_->close())
 		{
-			stream.clear();
-			stream.str("");
-			stream << "Parsing: " << line;
-			p_logger_->log(logger_type_, VERBOSE, stream.str());
+			target_file_written = false;
+			results.message = "Unable to write the target file.";
+			p_logger_->log_exception(logger_type_, results.message);
 		}
-		parser_.try_parse_gcode(line.c_str(), cmd, true);
-		bool has_gcode = false;
-		if (cmd.gcode.length() > 0)
+		delete p_output_file_;
+		p_output_file_ = NULL;
+	}
+	gcodeFile.close();
+	parsed_command_reader.close();
+	if (p_source_line_index != NULL && continue_processing && !source_line_index.save(line_offset_index_path_))
+	{
+		p_logger_->log(logger_type_, WARNING, "Unable to save the line offset index.");
+	}
+	if (map_source_lines_)
+	{
+		if (continue_processing && !source_line_map_.save(source_line_map_path_))
 		{
-			has_gcode = true;
-			gcodes_processed_++;
+			p_logger_->log(logger_type_, WARNING, "Unable to save the source line map.");
+		}
+		source_line_map_.clear();
+		map_source_lines_ = false;
+	}
+	if (telemetry_enabled_)
+	{
+		if (!telemetry_.close())
+		{
+			p_logger_->log(logger_type_, WARNING, "Unable to write the telemetry file.");
+		}
+		telemetry_enabled_ = false;
+	}
+	if (parsed_command_writer.is_open())
+	{
+		// Only keep the parsed command file if the whole source was read
+		if (!continue_processing)
+		{
+			parsed_command_writer.discard();
+		}
+		else if (!parsed_command_writer.close())
+		{
+			p_logger_->log(logger_type_, WARNING, "Unable to complete the parsed command file.");
+		}
+	}
+	const clock_t end_clock = clock();
+	
+	results.success = continue_processing && target_file_written && source_file_read;
+	results.analysis = analysis_;
+	results.cancelled = !continue_processing;
+	results.progress = final_progress;
+	p_logger_->log(logger_type_, DEBUG, "Returning processing results.");
+
+	return results;
+}
+
+template <bool log_debug, bool report_progress>
+bool arc_welder::process_source_(line_reader& gcode_file, parsed_command_file_reader& parsed_command_reader, parsed_command_file_writer& parsed_command_writer, line_offset_index* p_source_line_index, parsed_command& cmd, clock_t start_clock)
+{
+	// local variable to hold the progress update return.  If it's false, we will exit.
+	bool continue_processing = true;
+	// Communicate every second
+	const int read_lines_before_clock_check = 5000;
+	double next_update_time = get_next_update_time();
+	const char* line;
+	size_t line_length;
+	long source_position = 0;
+	while (continue_processing)
+	{
+		cmd.clear();
+		source_line_offset_ = source_position;
+		if (parsed_command_reader.is_open())
+		{
+			if (!parsed_command_reader.read_command(cmd))
+				break;
+			source_position = parsed_command_reader.get_position();
 		}
 		else
 		{
-			lines_with_no_commands++;
+			if (!gcode_file.read_line(&line, &line_length))
+				break;
+			if (log_debug)
+			{
+				LOG_LAZY(p_logger_, logger_type_, VERBOSE, "Parsing: " << line);
+			}
+			parser_.try_parse_gcode(line, cmd, true);
+			source_position = gcode_file.get_position();
+			if (parsed_command_writer.is_open() && !parsed_command_writer.write_command(cmd, source_position))
+			{
+				p_logger_->log(logger_type_, WARNING, "Unable to write to the parsed command file, it will be discarded.");
+				parsed_command_writer.discard();
+			}
+		}
+		lines_processed_++;
+
+		const bool has_gcode = cmd.gcode.length() > 0;
+		if (has_gcode)
+		{
+			gcodes_processed_++;
 		}
 
 		// Always process the command through the printer, even if no command is found
 		// This is important so that comments can be analyzed
-		//std::cout << "stabilization::process_file - updating position...";
-		process_gcode(cmd, false, false);
+		process_gcode_<log_debug>(cmd, false, false);
+		if (p_source_line_index != NULL)
+		{
+			p_source_line_index->add_line(source_line_offset_);
+			const position* p_cur_pos = p_source_position_->get_current_position_ptr();
+			if (p_cur_pos->is_layer_change)
+			{
+				p_source_line_index->add_layer_change(lines_processed_, p_cur_pos->layer);
+			}
+		}
 
-		// Only continue to process if we've found a command and either a progress_callback_ is supplied, or debug loggin is enabled.
-		if (has_gcode && (progress_callback_ != NULL || info_logging_enabled_))
+		// Only continue to process if we've found a command and either a progress_callback_ is supplied, or info logging is enabled.
+		if (report_progress && has_gcode)
 		{
 			if ((lines_processed_ % read_lines_before_clock_check) == 0 && next_update_time < clock())
 			{
-				if (verbose_logging_enabled_)
+				if (log_debug && verbose_logging_enabled_)
 				{
 					p_logger_->log(logger_type_, VERBOSE, "Sending progress update.");
 				}
-				continue_processing = on_progress_(get_progress_(static_cast<long>(gcodeFile.tellg()), static_cast<double>(start_clock)));
+				const long source_file_position = parsed_command_reader.is_open() ? source_position : gcode_file.get_source_position();
+				continue_processing = on_progress_(get_progress_(source_file_position, source_position, static_cast<double>(start_clock)));
 				next_update_time = get_next_update_time();
 			}
 		}
 	}
+	return continue_processing;
+}
+
+arc_welder_estimate arc_welder::estimate(int num_samples, long sample_size_bytes)
+{
+	arc_welder_estimate estimate;
+	verbose_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, VERBOSE);
+	debug_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, DEBUG);
+	info_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, INFO);
+	error_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, ERROR);
+
+	reset();
+	const clock_t start_clock = clock();
+	file_size_ = get_file_size(source_path_);
+	estimate.source_file_size = file_size_;
+	if (num_samples < 1)
+	{
+		num_samples = 1;
+	}
+	if (sample_size_bytes < 1)
+	{
+		sample_size_bytes = DEFAULT_ESTIMATE_SAMPLE_SIZE_BYTES;
+	}
+	long sample_stride = file_size_ / num_samples;
+	if (sample_size_bytes >= sample_stride)
+	{
+		// The samples would cover the whole file, so weld all of it in a single sample.
+		num_samples = 1;
+		sample_stride = file_size_;
+		sample_size_bytes = file_size_;
+	}
+
+	std::stringstream stream;
+	stream << "arc_welder::estimate - Estimating '" << source_path_ << "' (" << file_size_ << " bytes) from " << num_samples << " samples of " << sample_size_bytes << " bytes.";
+	p_logger_->log(logger_type_, INFO, stream.str());
+
+	// Open in binary mode so that the sample offsets can be seeked to directly
+	line_reader gcodeFile;
+	if (!gcodeFile.open(source_path_, true))
+	{
+		estimate.message = "Unable to open the source file.";
+		p_logger_->log_exception(logger_type_, estimate.message);
+		return estimate;
+	}
+	if (gcodeFile.is_compressed())
+	{
+		// Samples are read by seeking to evenly spaced offsets, which compressed files can't do.
+		estimate.message = "Compressed source files can't be estimated.";
+		p_logger_->log(logger_type_, INFO, estimate.message);
+		return estimate;
+	}
+
+	// Nothing is written while estimating.
+	const bool dry_run = dry_run_;
+	dry_run_ = true;
+
+	const char* line;
+	size_t line_length;
+	parsed_command cmd;
+	gcode_position_args sample_position_args = gcode_position_args_;
+	for (int sample_index = 0; sample_index < num_samples; sample_index++)
+	{
+		// Each sample starts from a fresh position that is synchronized below, so no coordinates, offsets or extruder
+		// values carry over from the previous sample.
+		delete p_source_position_;
+		p_source_position_ = new gcode_position(sample_position_args);
+		previous_feedrate_ = -1;
+		unrestored_feedrate_ = -1;
+		relative_position_error_ = vector();
+
+		const long sample_start = sample_stride * sample_index;
+		gcodeFile.seek(sample_start);
+		// Samples that start in the middle of the file must skip the (probably partial) first line, and can only be welded
+		// once the position is known again.  Keep updating the position until a G92 or an absolute Z move (layer change) is found,
+		// or the position is relative (G91).
+		bool is_synchronized = sample_start == 0;
+		if (!is_synchronized)
+		{
+			gcodeFile.read_line(&line, &line_length);
+		}
+		long sample_bytes = 0;
+		while (sample_bytes < sample_size_bytes && gcodeFile.read_line(&line, &line_length))
+		{
+			lines_processed_++;
+			cmd.clear();
+			parser_.try_parse_gcode(line, cmd, true);
+			if (cmd.gcode.length() > 0)
+			{
+				gcodes_processed_++;
+			}
+			if (!is_synchronized)
+			{
+				p_source_position_->update(cmd, lines_processed_, gcodes_processed_, -1);
+				is_synchronized = is_estimate_sync_command(cmd, *p_source_position_->get_current_position_ptr());
+				if (is_synchronized && p_source_position_->get_current_position_ptr()->is_relative)
+				{
+					// Relative moves weld the same way from any starting point, so start at the origin
+					parsed_command origin_cmd;
+					parser_.try_parse_gcode("G92 X0 Y0 Z0", origin_cmd, true);
+					p_source_position_->update(origin_cmd, lines_processed_, gcodes_processed_, -1);
+				}
+				continue;
+			}
+			sample_bytes += static_cast<long>(line_length) + 1;
+			process_gcode(cmd, false, false);
+		}
+		// Finish any shape that is in progress so that the samples are independent
+		if (has_shape_to_finish_())
+		{
+			process_gcode(cmd, true, false);
+		}
+		write_unwritten_gcodes_to_file();
+		write_pending_arc_();
+		waiting_for_arc_ = false;
+		clear_shapes();
+		estimate.sampled_source_bytes += sample_bytes;
+		if (sample_index == 0)
+		{
+			// Slicers set the axis modes and units once at the start of the file, so the later samples start with the
+			// modes found in the first one.
+			set_estimate_sample_modes_(*p_source_position_->get_current_position_ptr(), sample_position_args);
+		}
+	}
+	gcodeFile.close();
+	dry_run_ = dry_run;
 
-	if (current_arc_.is_shape() && waiting_for_arc_)
+	estimate.num_samples = num_samples;
+	estimate.sampled_target_bytes = target_file_size_;
+	estimate.sampled_arcs_created = arcs_created_;
+	estimate.sampled_splines_created = splines_created_;
+	estimate.seconds_elapsed = get_time_elapsed(static_cast<double>(start_clock), clock());
+	if (estimate.sampled_source_bytes > 0)
 	{
-		p_logger_->log(logger_type_, DEBUG, "The target file opened successfully.");
-		process_gcode(cmd, true, false);
+		const double scale = static_cast<double>(file_size_) / static_cast<double>(estimate.sampled_source_bytes);
+		estimate.estimated_target_file_size = static_cast<long>(static_cast<double>(estimate.sampled_target_bytes) * scale);
+		estimate.estimated_arcs_created = static_cast<int>(static_cast<double>(estimate.sampled_arcs_created) * scale + 0.5);
+		estimate.estimated_splines_created = static_cast<int>(static_cast<double>(estimate.sampled_splines_created) * scale + 0.5);
+		estimate.estimated_seconds = estimate.seconds_elapsed * scale;
+		if (estimate.sampled_target_bytes > 0)
+		{
+			estimate.compression_ratio = static_cast<double>(estimate.sampled_source_bytes) / static_cast<double>(estimate.sampled_target_bytes);
+		}
+		estimate.compression_percent = (1.0 - static_cast<double>(estimate.sampled_target_bytes) / static_cast<double>(estimate.sampled_source_bytes)) * 100.0;
+		estimate.success = true;
+	}
+	else
+	{
+		estimate.message = "No gcode could be sampled from the source file.";
+	}
+	p_logger_->log(logger_type_, INFO, estimate.str());
+	return estimate;
+}
+
+void arc_welder::begin_stream()
+{
+	verbose_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, VERBOSE);
+	debug_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, DEBUG);
+	info_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, INFO);
+	error_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, ERROR);
+	p_logger_->log(logger_type_, INFO, "Beginning an arc welder stream.");
+	reset();
+	delete p_source_position_;
+	p_source_position_ = new gcode_position(gcode_position_args_);
+	map_source_lines_ = false;
+	telemetry_enabled_ = false;
+	if (p_output_file_ != NULL)
+	{
+		delete p_output_file_;
+	}
+	p_stream_output_ = new string_output_encoder();
+	p_stream_output_->open(target_path_);
+	p_output_file_ = p_stream_output_;
+}
+
+void arc_welder::stream_line(const char* line, std::string& output)
+{
+	stream_command_.clear();
+	parser_.try_parse_gcode(line, stream_command_, true);
+	lines_processed_++;
+	if (stream_command_.gcode.length() > 0)
+	{
+		gcodes_processed_++;
+	}
+	process_gcode(stream_command_, false, false);
+	p_stream_output_->take(output);
+}
+
+void arc_welder::flush_stream(std::string& output)
+{
+	if (waiting_for_arc_)
+	{
+		if (segmentation_lookahead_ > 0 || get_shape_to_write() != NULL)
+		{
+			stream_command_.clear();
+			process_gcode(stream_command_, true, false);
+		}
+		else
+		{
+			// The shape is too short to write, and its commands are written as is below.  It must not be continued by the next line.
+			waiting_for_arc_ = false;
+			clear_shapes();
+		}
 	}
-	p_logger_->log(logger_type_, DEBUG, "Writing all unwritten gcodes to the target file.");
 	write_unwritten_gcodes_to_file();
-	p_logger_->log(logger_type_, DEBUG, "Fetching the final progress struct.");
+	write_pending_arc_();
+	p_stream_output_->take(output);
+}
 
-	arc_welder_progress final_progress = get_progress_(static_cast<long>(file_size_), static_cast<double>(start_clock));
-	if (progress_callback_ != NULL || info_logging_enabled_)
+void arc_welder::end_stream(std::string& output)
+{
+	flush_stream(output);
+	p_stream_output_->close();
+	delete p_output_file_;
+	p_output_file_ = NULL;
+	p_stream_output_ = NULL;
+	std::stringstream stream;
+	stream << "Arc welder stream complete.  Lines: " << lines_processed_ << ", Arcs Created: " << arcs_created_ << ", Splines Created: " << splines_created_ << ", Lines Sent: " << target_lines_written_;
+	p_logger_->log(logger_type_, INFO, stream.str());
+}
+
+bool arc_welder::is_streaming() const
+{
+	return p_stream_output_ != NULL;
+}
+
+void arc_welder::set_estimate_sample_modes_(const position& pos, gcode_position_args& args)
+{
+	if (!pos.is_relative_null)
 	{
-		// Sending final progress update message
-		p_logger_->log(logger_type_, VERBOSE, "Sending final progress update message.");
-		on_progress_(final_progress);
+		args.xyz_axis_default_mode = pos.is_relative ? "relative" : "absolute";
 	}
-	p_logger_->log(logger_type_, DEBUG, "Processing complete, closing source and target file.");
-	output_file_.close();
-	gcodeFile.close();
-	const clock_t end_clock = clock();
-	
-	results.success = continue_processing;
-	results.cancelled = !continue_processing;
-	results.progress = final_progress;
-	p_logger_->log(logger_type_, DEBUG, "Returning processing results.");
+	if (!pos.is_extruder_relative_null)
+	{
+		args.e_axis_default_mode = pos.is_extruder_relative ? "relative" : "absolute";
+	}
+	if (!pos.is_metric_null)
+	{
+		args.units_default = pos.is_metric ? "millimeters" : "inches";
+	}
+}
 
-	return results;
+bool arc_welder::is_estimate_sync_command(const parsed_command& cmd, const position& pos)
+{
+	if (cmd.command == "G92")
+	{
+		return true;
+	}
+	// Relative (G91) moves don't depend on the unknown starting position
+	if (pos.is_relative && !pos.is_relative_null)
+	{
+		return true;
+	}
+	if ((cmd.command == "G0" || cmd.command == "G1") && !pos.is_relative)
+	{
+		for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+		{
+			if (cmd.parameters[index].name == "Z")
+			{
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
 bool arc_welder::on_progress_(const arc_welder_progress& progress)
@@ -305,15 +906,18 @@ bool arc_welder::on_progress_(const arc_welder_progress& progress)
 	return true;
 }
 
-arc_welder_progress arc_welder::get_progress_(long source_file_position, double start_clock)
+arc_welder_progress arc_welder::get_progress_(long source_file_position, long source_bytes_read, double start_clock)
 {
 	arc_welder_progress progress;
 	progress.gcodes_processed = gcodes_processed_;
 	progress.lines_processed = lines_processed_;
 	progress.points_compressed = points_compressed_;
 	progress.arcs_created = arcs_created_;
+	progress.splines_created = splines_created_;
+	progress.source_command_rates = source_command_rates_.get_summary();
+	progress.target_command_rates = target_command_rates_.get_summary();
 	progress.source_file_position = source_file_position;
-	progress.target_file_size = static_cast<long>(output_file_.tellp());
+	progress.target_file_size = target_file_size_;
 	progress.source_file_size = file_size_;
 	long bytesRemaining = file_size_ - static_cast<long>(source_file_position);
 	progress.percent_complete = static_cast<double>(source_file_position) / static_cast<double>(file_size_) * 100.0;
@@ -321,9 +925,9 @@ arc_welder_progress arc_welder::get_progress_(long source_file_position, double
 	double bytesPerSecond = static_cast<double>(source_file_position) / progress.seconds_elapsed;
 	progress.seconds_remaining = bytesRemaining / bytesPerSecond;
 
-	if (source_file_position > 0) {
-		progress.compression_ratio = (static_cast<float>(source_file_position) / static_cast<float>(progress.target_file_size));
-		progress.compression_percent = (1.0 - (static_cast<float>(progress.target_file_size) / static_cast<float>(source_file_position))) * 100.0f;
+	if (source_bytes_read > 0) {
+		progress.compression_ratio = (static_cast<float>(source_bytes_read) / static_cast<float>(progress.target_file_size));
+		progress.compression_percent = (1.0 - (static_cast<float>(progress.target_file_size) / static_cast<float>(source_bytes_read))) * 100.0f;
 	}
 
 	progress.segment_statistics = segment_statistics_;
@@ -331,10 +935,20 @@ arc_welder_progress arc_welder::get_progress_(long source_file_position, double
 	
 }
 
-int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess)
+int arc_welder::process_gcode(const parsed_command& cmd, bool is_end, bool is_reprocess)
+{
+	if (debug_logging_enabled_)
+	{
+		return process_gcode_<true>(cmd, is_end, is_reprocess);
+	}
+	return process_gcode_<false>(cmd, is_end, is_reprocess);
+}
+
+template <bool log_debug>
+int arc_welder::process_gcode_(const parsed_command& cmd, bool is_end, bool is_reprocess)
 {
 	// Update the position for the source gcode file
-	p_source_position_->update(cmd, lines_processed_, gcodes_processed_, -1);
+	p_source_position_->update(cmd, lines_processed_, gcodes_processed_, source_line_offset_);
 	position* p_cur_pos = p_source_position_->get_current_position_ptr();
 	position* p_pre_pos = p_source_position_->get_previous_position_ptr();
 	extruder extruder_current = p_cur_pos->get_current_extruder();
@@ -346,7 +960,6 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 	// see if this point is an extrusion
 	
 	bool arc_added = false;
-	bool clear_shapes = false;
 	
 	// Update the source file statistics
 	if (p_cur_pos->has_xy_position_changed && (extruder_current.is_extruding || extruder_current.is_retracting) && !is_reprocess)
@@ -357,37 +970,36 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 			segment_statistics_.update(movement_length_mm, true);
 		}
 	}
+	const bool is_move = !is_end && !cmd.is_empty && command_rate_statistics::is_move_command(cmd.command);
+	const double move_duration_seconds = is_move ? command_rate_statistics::get_move_duration(*p_pre_pos, *p_cur_pos) : 0;
+	if (is_move && !is_reprocess)
+	{
+		source_command_rates_.add_command(move_duration_seconds, lines_processed_);
+	}
+	if (!is_reprocess)
+	{
+		update_analysis_(*p_pre_pos, *p_cur_pos, is_move);
+		// Only the command that follows a shape can continue at its unrestored feedrate
+		unrestored_feedrate_ = -1;
+	}
 
-	// We need to make sure the printer is using absolute xyz, is extruding, and the extruder axis mode is the same as that of the previous position
-	// TODO: Handle relative XYZ axis.  This is possible, but maybe not so important.
-	if (
-		!is_end && cmd.is_known_command && !cmd.is_empty && (
-			(cmd.command == "G0" || cmd.command == "G1") &&
-			utilities::is_equal(p_cur_pos->z, p_pre_pos->z) &&
-			utilities::is_equal(p_cur_pos->x_offset, p_pre_pos->x_offset) &&
-			utilities::is_equal(p_cur_pos->y_offset, p_pre_pos->y_offset) &&
-			utilities::is_equal(p_cur_pos->z_offset, p_pre_pos->z_offset) &&
-			utilities::is_equal(p_cur_pos->x_firmware_offset, p_pre_pos->x_firmware_offset) &&
-			utilities::is_equal(p_cur_pos->y_firmware_offset, p_pre_pos->y_firmware_offset) &&
-			utilities::is_equal(p_cur_pos->z_firmware_offset, p_pre_pos->z_firmware_offset) &&
-			!p_cur_pos->is_relative &&
-			(
-				!waiting_for_arc_ ||
-				(previous_extruder.is_extruding && extruder_current.is_extruding) ||
-				(previous_extruder.is_retracting && extruder_current.is_retracting)
-			) &&
-			p_cur_pos->is_extruder_relative == p_pre_pos->is_extruder_relative &&
-			(!waiting_for_arc_ || p_pre_pos->f == p_cur_pos->f) &&
-			(!waiting_for_arc_ || p_pre_pos->feature_type_tag == p_cur_pos->feature_type_tag)
-			)
-	) {
+	if (segmentation_lookahead_ > 0)
+	{
+		return process_lookahead_gcode_<log_debug>(cmd, is_end, is_move, move_duration_seconds);
+	}
+
+	if (is_shape_eligible_(cmd, is_end, *p_cur_pos, *p_pre_pos, previous_extruder, extruder_current)) {
 		
 		if (!waiting_for_arc_)
 		{
 			previous_is_extruder_relative_ = p_pre_pos->is_extruder_relative;
-			if (debug_logging_enabled_)
+			current_arc_.set_is_xyz_relative(p_pre_pos->is_relative);
+			current_bezier_.set_is_xyz_relative(p_pre_pos->is_relative);
+			// Arcs can't span feature types, so use the tolerances for the current feature until this arc is written
+			set_shape_tolerances(p_cur_pos->feature_type_tag);
+			if (log_debug)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Starting new arc from Gcode:" + cmd.gcode);
+				LOG_LAZY(p_logger_, logger_type_, DEBUG, "Starting new arc from Gcode:" << cmd.gcode);
 			}
 			write_unwritten_gcodes_to_file();
 			// add the previous point as the starting point for the current arc
@@ -395,148 +1007,262 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 			// Don't add any extrusion, or you will over extrude!
 			//std::cout << "Trying to add first point (" << p.x << "," << p.y << "," << p.z << ")...";
 			current_arc_.try_add_point(previous_p, 0);
+			arc_fitting_ = true;
+			if (allow_g5_splines_)
+			{
+				current_bezier_.try_add_point(previous_p, 0);
+				bezier_fitting_ = true;
+			}
 		}
 		
 		double e_relative = extruder_current.e_relative;
 		int num_points = current_arc_.get_num_segments();
-		arc_added = current_arc_.try_add_point(p, e_relative);
+		bool point_added_to_arc = arc_fitting_ && current_arc_.try_add_point(p, e_relative);
+		bool point_added_to_bezier = bezier_fitting_ && current_bezier_.try_add_point(p, e_relative);
+		arc_added = point_added_to_arc || point_added_to_bezier;
+		if (telemetry_enabled_ && waiting_for_arc_ && !arc_added)
+		{
+			// The move was eligible, but the shape could not be extended to include it
+			arc_telemetry_decision reason = arc_telemetry_no_fit;
+			double radius = current_arc_.get_radius();
+			if (arc_fitting_)
+			{
+				reason = get_telemetry_decision_(current_arc_.get_last_rejection());
+				if (reason == arc_telemetry_radius_exceeded)
+				{
+					radius = current_arc_.get_last_rejection_radius();
+				}
+			}
+			add_telemetry_record_(reason, current_arc_.get_num_segments(), radius);
+		}
+		if (arc_added && arc_fitting_ && bezier_fitting_ && point_added_to_arc != point_added_to_bezier)
+		{
+			// Only one of the shapes could take the point.  The other can never be written once
+			// the path moves past its end, so either write it now, or drop it.
+			if (
+				(point_added_to_bezier && current_arc_.is_shape() && current_arc_.get_num_segments() > current_bezier_.get_num_segments()) ||
+				(point_added_to_arc && current_bezier_.is_shape() && current_bezier_.get_num_segments() > current_arc_.get_num_segments())
+			)
+			{
+				// The shape that took the point had to drop its start point, and the other shape
+				// covers more segments.  Write the other shape instead.
+				arc_added = false;
+			}
+			else if (point_added_to_arc)
+			{
+				bezier_fitting_ = false;
+				current_bezier_.clear();
+			}
+			else
+			{
+				arc_fitting_ = false;
+				current_arc_.clear();
+			}
+		}
 		if (arc_added)
 		{
 			if (!waiting_for_arc_)
 			{
 				waiting_for_arc_ = true;
-				previous_feedrate_ = p_pre_pos->f;
+				previous_feedrate_ = unrestored_feedrate_ > 0 ? unrestored_feedrate_ : p_pre_pos->f;
+				arc_min_feedrate_ = p_cur_pos->f;
+				arc_max_feedrate_ = p_cur_pos->f;
 			}
 			else
 			{
-				if (debug_logging_enabled_)
+				if (p_cur_pos->f < arc_min_feedrate_) arc_min_feedrate_ = p_cur_pos->f;
+				if (p_cur_pos->f > arc_max_feedrate_) arc_max_feedrate_ = p_cur_pos->f;
+				if (log_debug)
 				{
 					if (num_points+1 == current_arc_.get_num_segments())
 					{
-						p_logger_->log(logger_type_, DEBUG, "Adding point to arc from Gcode:" + cmd.gcode);
+						LOG_LAZY(p_logger_, logger_type_, DEBUG, "Adding point to arc from Gcode:" << cmd.gcode);
 					}
+					else
 					{
-						p_logger_->log(logger_type_, DEBUG, "Removed start point from arc and added a new point from Gcode:" + cmd.gcode);
+						LOG_LAZY(p_logger_, logger_type_, DEBUG, "Removed start point from arc and added a new point from Gcode:" << cmd.gcode);
 					}
 				}
 			}
 		}
 	}
-	else if (debug_logging_enabled_ ){
+	else if (log_debug || (telemetry_enabled_ && waiting_for_arc_ && !is_end)){
 		if (is_end)
 		{
 			p_logger_->log(logger_type_, DEBUG, "Procesing final shape, if one exists.");
 		}
-		else if (!cmd.is_empty)
+		else
 		{
-			if (!cmd.is_known_command)
-			{
-				p_logger_->log(logger_type_, DEBUG, "Command '" + cmd.command + "' is Unknown.  Gcode:" + cmd.gcode);
-			}
-			else if (cmd.command != "G0" && cmd.command != "G1")
+			const arc_telemetry_decision reason = get_ineligible_reason_(cmd, *p_cur_pos, *p_pre_pos, previous_extruder, extruder_current);
+			if (telemetry_enabled_ && waiting_for_arc_)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Command '"+ cmd.command + "' is not G0/G1, skipping.  Gcode:" + cmd.gcode);
+				add_telemetry_record_(reason, current_arc_.get_num_segments(), current_arc_.get_radius());
 			}
-			else if (!utilities::is_equal(p_cur_pos->z, p_pre_pos->z))
-			{
-				p_logger_->log(logger_type_, DEBUG, "Z axis position changed, cannot convert:" + cmd.gcode);
-			}
-			else if (p_cur_pos->is_relative)
-			{
-				p_logger_->log(logger_type_, DEBUG, "XYZ Axis is in relative mode, cannot convert:" + cmd.gcode);
-			}
-			else if (
-				waiting_for_arc_ && !( 
-					(previous_extruder.is_extruding && extruder_current.is_extruding) ||
-					(previous_extruder.is_retracting && extruder_current.is_retracting)
-				)
-			)
+			if (log_debug && !cmd.is_empty)
 			{
-				std::string message = "Extruding or retracting state changed, cannot add point to current arc: " + cmd.gcode;
-				if (verbose_logging_enabled_)
+				switch (reason)
 				{
-					
-					message.append(
-						" - Verbose Info\n\tCurrent Position Info - Absolute E:" + utilities::to_string(extruder_current.e) +
-						", Offset E:" + utilities::to_string(extruder_current.get_offset_e()) +
-						", Mode:" + (p_cur_pos->is_extruder_relative_null ? "NULL" : p_cur_pos->is_extruder_relative ? "relative" : "absolute") +
-						", Retraction: " + utilities::to_string(extruder_current.retraction_length) +
-						", Extrusion: " + utilities::to_string(extruder_current.extrusion_length) +
-						", Retracting: " + (extruder_current.is_retracting ? "True" : "False") +
-						", Extruding: " + (extruder_current.is_extruding ? "True" : "False")
-					);
-					message.append(
-						"\n\tPrevious Position Info - Absolute E:" + utilities::to_string(previous_extruder.e) +
-						", Offset E:" + utilities::to_string(previous_extruder.get_offset_e()) +
-						", Mode:" + (p_pre_pos->is_extruder_relative_null ? "NULL" : p_pre_pos->is_extruder_relative ? "relative" : "absolute") +
-						", Retraction: " + utilities::to_string(previous_extruder.retraction_length) +
-						", Extrusion: " + utilities::to_string(previous_extruder.extrusion_length) +
-						", Retracting: " + (previous_extruder.is_retracting ? "True" : "False") +
-						", Extruding: " + (previous_extruder.is_extruding ? "True" : "False")
-					);
-					p_logger_->log(logger_type_, VERBOSE, message);
-				}
-				else
-				{
-					p_logger_->log(logger_type_, DEBUG, message);
-				}
-				
-			}
-			else if (p_cur_pos->is_extruder_relative != p_pre_pos->is_extruder_relative)
-			{
-				p_logger_->log(logger_type_, DEBUG, "Extruder axis mode changed, cannot add point to current arc: " + cmd.gcode);
-			}
-			else if (waiting_for_arc_ && p_pre_pos->f != p_cur_pos->f)
-			{
-				p_logger_->log(logger_type_, DEBUG, "Feedrate changed, cannot add point to current arc: " + cmd.gcode);
-			}
-			else if (waiting_for_arc_ && p_pre_pos->feature_type_tag != p_cur_pos->feature_type_tag)
-			{
-				p_logger_->log(logger_type_, DEBUG, "Feature type changed, cannot add point to current arc: " + cmd.gcode);
-			}
-			else
-			{
-				// Todo:  Add all the relevant values
-				p_logger_->log(logger_type_, DEBUG, "There was an unknown issue preventing the current point from being added to the arc: " + cmd.gcode);
+				case arc_telemetry_not_g0_g1:
+					if (!cmd.is_known_command)
+					{
+						LOG_LAZY(p_logger_, logger_type_, DEBUG, "Command '" << cmd.command << "' is Unknown.  Gcode:" << cmd.gcode);
+					}
+					else
+					{
+						LOG_LAZY(p_logger_, logger_type_, DEBUG, "Command '" << cmd.command << "' is not G0/G1, skipping.  Gcode:" << cmd.gcode);
+					}
+					break;
+				case arc_telemetry_z_changed:
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "Z axis position changed, cannot convert:" << cmd.gcode);
+					break;
+				case arc_telemetry_offset_changed:
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "Axis offset changed, cannot add point to current arc: " << cmd.gcode);
+					break;
+				case arc_telemetry_xyz_mode_changed:
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "XYZ axis mode changed, cannot add point to current arc: " << cmd.gcode);
+					break;
+				case arc_telemetry_extrusion_changed:
+				{
+					std::string message = "Extruding or retracting state changed, cannot add point to current arc: " + cmd.gcode;
+					if (verbose_logging_enabled_)
+					{
+					
+						message.append(
+							" - Verbose Info\n\tCurrent Position Info - Absolute E:" + utilities::to_string(extruder_current.e) +
+							", Offset E:" + utilities::to_string(extruder_current.get_offset_e()) +
+							", Mode:" + (p_cur_pos->is_extruder_relative_null ? "NULL" : p_cur_pos->is_extruder_relative ? "relative" : "absolute") +
+							", Retraction: " + utilities::to_string(extruder_current.retraction_length) +
+							", Extrusion: " + utilities::to_string(extruder_current.extrusion_length) +
+							", Retracting: " + (extruder_current.is_retracting ? "True" : "False") +
+							", Extruding: " + (extruder_current.is_extruding ? "True" : "False")
+						);
+						message.append(
+							"\n\tPrevious Position Info - Absolute E:" + utilities::to_string(previous_extruder.e) +
+							", Offset E:" + utilities::to_string(previous_extruder.get_offset_e()) +
+							", Mode:" + (p_pre_pos->is_extruder_relative_null ? "NULL" : p_pre_pos->is_extruder_relative ? "relative" : "absolute") +
+							", Retraction: " + utilities::to_string(previous_extruder.retraction_length) +
+							", Extrusion: " + utilities::to_string(previous_extruder.extrusion_length) +
+							", Retracting: " + (previous_extruder.is_retracting ? "True" : "False") +
+							", Extruding: " + (previous_extruder.is_extruding ? "True" : "False")
+						);
+						p_logger_->log(logger_type_, VERBOSE, message);
+					}
+					else
+					{
+						p_logger_->log(logger_type_, DEBUG, message);
+					}
+					break;
+				}
+				case arc_telemetry_extruder_mode_changed:
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "Extruder axis mode changed, cannot add point to current arc: " << cmd.gcode);
+					break;
+				case arc_telemetry_feedrate_changed:
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "Feedrate changed, cannot add point to current arc: " << cmd.gcode);
+					break;
+				case arc_telemetry_feature_changed:
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "Feature type changed, cannot add point to current arc: " << cmd.gcode);
+					break;
+				default:
+					// Todo:  Add all the relevant values
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "There was an unknown issue preventing the current point from being added to the arc: " << cmd.gcode);
+					break;
+				}
 			}
 		}
 	}
 	
 	if (!arc_added)
 	{
-		if (current_arc_.get_num_segments() < current_arc_.get_min_segments()) {
-			if (debug_logging_enabled_ && !cmd.is_empty)
+		if (
+			current_arc_.get_num_segments() < current_arc_.get_min_segments() &&
+			current_bezier_.get_num_segments() < current_bezier_.get_min_segments()
+		) {
+			if (telemetry_enabled_ && waiting_for_arc_)
 			{
-				if (current_arc_.get_num_segments() != 0)
+				add_telemetry_record_(arc_telemetry_too_few_segments, current_arc_.get_num_segments(), current_arc_.get_radius());
+			}
+			if (log_debug && !cmd.is_empty)
+			{
+				if (current_arc_.get_num_segments() != 0 || current_bezier_.get_num_segments() != 0)
 				{
-					p_logger_->log(logger_type_, DEBUG, "Not enough segments, resetting. Gcode:" + cmd.gcode);
+					LOG_LAZY(p_logger_, logger_type_, DEBUG, "Not enough segments, resetting. Gcode:" << cmd.gcode);
 				}
 				
 			}
 			waiting_for_arc_ = false;
-			current_arc_.clear();
+			clear_shapes();
 		}
 		else if (waiting_for_arc_)
 		{
-
-			if (current_arc_.is_shape())
+			// Write whichever shape replaces the most segments
+			segmented_shape* p_shape = get_shape_to_write();
+			if (p_shape != NULL)
 			{
+				const bool is_arc = p_shape == &current_arc_;
 				// update our statistics
-				points_compressed_ += current_arc_.get_num_segments()-1;
-				arcs_created_++; // increment the number of generated arcs
+				points_compressed_ += p_shape->get_num_segments()-1;
+				if (is_arc)
+				{
+					arcs_created_++; // increment the number of generated arcs
+				}
+				else
+				{
+					splines_created_++;
+				}
+				if (telemetry_enabled_)
+				{
+					add_telemetry_record_(is_arc ? arc_telemetry_arc_emitted : arc_telemetry_spline_emitted, p_shape->get_num_segments(), is_arc ? current_arc_.get_radius() : 0);
+				}
 
 				//std::cout << "Arc shape found.\n";
 				// Get the comment now, before we remove the previous comments
-				std::string comment = get_comment_for_arc();
+				std::string comment = get_comment_for_arc(p_shape->get_num_segments());
+				// The arc takes as long as the moves it replaces, and replaces their source lines
+				double arc_duration_seconds = 0;
+				const int first_segment_index = unwritten_commands_.count() - (p_shape->get_num_segments() - 1);
+				const long arc_source_start_line = unwritten_commands_[first_segment_index].source_start_line;
+				const long arc_source_end_line = unwritten_commands_[unwritten_commands_.count() - 1].source_end_line;
+				for (int index = first_segment_index; index < unwritten_commands_.count(); index++)
+				{
+					arc_duration_seconds += unwritten_commands_[index].duration_seconds;
+				}
+				// get the feedrate for the previous position (the last command that was turned into an arc)
+				double current_f = p_pre_pos->f;
+				// The feedrate the printer must be left at after the arc
+				double restore_f = current_f;
+				if (arc_min_feedrate_ != arc_max_feedrate_)
+				{
+					// The segments were merged within the feedrate tolerance, use the length weighted average.
+					// This must happen before we remove the segments from the unwritten commands.
+					current_f = get_weighted_feedrate(p_shape->get_num_segments());
+				}
+				arc current_arc;
+				if (is_arc && current_f > 0 && current_arc_.try_get_arc(current_arc))
+				{
+					// Time the arc by its own length rather than by the chords it replaces
+					const double z_change = current_arc.end_point.z - current_arc.start_point.z;
+					arc_duration_seconds = std::sqrt(current_arc.length * current_arc.length + z_change * z_change) / (current_f / 60.0);
+				}
 				// remove the same number of unwritten gcodes as there are arc segments, minus 1 for the start point
 				// Which isn't a movement
 				// note, skip the first point, it is the starting point
-				for (int index = 0; index < current_arc_.get_num_segments() - 1; index++)
+				for (int index = 0; index < p_shape->get_num_segments() - 1; index++)
 				{
 					unwritten_commands_.pop_back();
 				}
-				// get the feedrate for the previous position (the last command that was turned into an arc)
-				double current_f = p_pre_pos->f;
+				// Don't restore the feedrate if it didn't change, or if the next command sets its own feedrate
+				bool restore_feedrate = !is_end && utilities::greater_than_or_equal(restore_f, 1) && current_f != restore_f;
+				if (restore_feedrate && (cmd.command == "G0" || cmd.command == "G1" || cmd.command == "G2" || cmd.command == "G3"))
+				{
+					for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+					{
+						if (cmd.parameters[index].name == "F")
+						{
+							restore_feedrate = false;
+							break;
+						}
+					}
+				}
 				
 				// Undo the current command, since it isn't included in the arc
 				p_source_position_->undo_update();
@@ -545,6 +1271,9 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 				p_cur_pos = p_source_position_->get_current_position_ptr();
 				extruder_current = p_cur_pos->get_current_extruder();
 
+				// The feedrate the arc moves at, whether or not it is written
+				const double arc_f = current_f;
+				unrestored_feedrate_ = !restore_feedrate && arc_f != restore_f ? arc_f : -1;
 				// Set the current feedrate if it is different, else set to 0 to indicate that no feedrate should be included
 				if(previous_feedrate_ > 0 && previous_feedrate_ == current_f){
 					current_f = 0;
@@ -552,20 +1281,21 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 
 				// Craete the arc gcode
 				std::string gcode;
+				const vector error_before = relative_position_error_;
 				if (previous_is_extruder_relative_){
-					gcode = get_arc_gcode_relative(current_f, comment);
+					gcode = get_arc_gcode_relative(*p_shape, current_f, comment);
 				}
 					
 				else { 
-					gcode = get_arc_gcode_absolute(extruder_current.get_offset_e(), current_f, comment);
+					gcode = get_arc_gcode_absolute(*p_shape, extruder_current.get_offset_e(), current_f, comment);
 				}
 				
 
-				if (debug_logging_enabled_)
+				if (log_debug)
 				{
 				  char buffer[20];
-					std::string message = "Arc created with ";
-					sprintf(buffer, "%d", current_arc_.get_num_segments());
+					std::string message = is_arc ? "Arc created with " : "Spline created with ";
+					sprintf(buffer, "%d", p_shape->get_num_segments());
 					message += buffer;
 					message += " segments: ";
 					message += gcode;
@@ -574,11 +1304,38 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 
 				// Get and alter the current position so we can add it to the unwritten commands list
 				parsed_command arc_command = parser_.parse_gcode(gcode.c_str());
-				double arc_extrusion_length = current_arc_.get_shape_length();
+				double arc_extrusion_length = p_shape->get_shape_length();
 				
-				unwritten_commands_.push_back(
-					unwritten_command(arc_command, p_cur_pos->is_extruder_relative, arc_extrusion_length)
-				);
+				unwritten_command arc_unwritten_command(arc_command, p_cur_pos->is_extruder_relative, arc_extrusion_length, true, arc_duration_seconds);
+				arc_unwritten_command.source_start_line = arc_source_start_line;
+				arc_unwritten_command.source_end_line = arc_source_end_line;
+				if (is_arc && arc_coalescer_.is_enabled() && current_arc_.try_get_arc(current_arc))
+				{
+					coalescable_arc::try_create(
+						current_arc,
+						current_arc_.is_xyz_relative(),
+						previous_is_extruder_relative_,
+						p_shape->get_shape_e_relative(),
+						extruder_current.get_offset_e(),
+						arc_f,
+						current_f >= 1,
+						arc_unwritten_command.arc
+					);
+					set_coalescable_offset_(arc_unwritten_command.arc, error_before);
+				}
+				unwritten_commands_.push_back(arc_unwritten_command);
+				if (restore_feedrate)
+				{
+					// The arc was written with an averaged feedrate, so set the feedrate back to that of the last segment
+					char buf[20];
+					std::string feedrate_gcode = "G1 F";
+					feedrate_gcode += utilities::to_string(restore_f, 0, buf);
+					parsed_command feedrate_command = parser_.parse_gcode(feedrate_gcode.c_str());
+					unwritten_command feedrate_unwritten_command(feedrate_command, p_cur_pos->is_extruder_relative, 0);
+					feedrate_unwritten_command.source_start_line = arc_source_start_line;
+					feedrate_unwritten_command.source_end_line = arc_source_end_line;
+					unwritten_commands_.push_back(feedrate_unwritten_command);
+				}
 				
 				// write all unwritten commands (if we don't do this we'll mess up absolute e by adding an offset to the arc)
 				// including the most recent arc command BEFORE updating the absolute e offset
@@ -586,17 +1343,17 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 				
 				// Now clear the arc and flag the processor as not waiting for an arc
 				waiting_for_arc_ = false;
-				current_arc_.clear();
+				clear_shapes();
 				
 
 				// Reprocess this line
 				if (!is_end)
 				{
-					return process_gcode(cmd, false, true);
+					return process_gcode_<log_debug>(cmd, false, true);
 				}
 				else
 				{
-					if (debug_logging_enabled_)
+					if (log_debug)
 					{
 						p_logger_->log(logger_type_, DEBUG, "Final arc created, exiting.");
 					}
@@ -606,17 +1363,17 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 			}
 			else
 			{
-				if (debug_logging_enabled_)
+				if (log_debug)
 				{
 					p_logger_->log(logger_type_, DEBUG, "The current arc is not a valid arc, resetting.");
 				}
-				current_arc_.clear();
+				clear_shapes();
 				waiting_for_arc_ = false;
 			}
 		}
-		else if (debug_logging_enabled_)
+		else if (log_debug)
 		{
-			p_logger_->log(logger_type_, DEBUG, "Could not add point to arc from gcode:" + cmd.gcode);
+			LOG_LAZY(p_logger_, logger_type_, DEBUG, "Could not add point to arc from gcode:" << cmd.gcode);
 		}
 
 	}
@@ -624,31 +1381,511 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 
 	if (waiting_for_arc_ || !arc_added)
 	{
-		position* cur_pos = p_source_position_->get_current_position_ptr();
-		extruder& cur_extruder = cur_pos->get_current_extruder();
+		push_unwritten_command_(unwritten_commands_, cmd, is_move, move_duration_seconds);
+	}
+	if (!waiting_for_arc_)
+	{
+		write_unwritten_gcodes_to_file();
+	}
+	return lines_written;
+}
 
-		double length = 0;
-		if (p_cur_pos->has_xy_position_changed && (cur_extruder.is_extruding || cur_extruder.is_retracting))
+template <bool log_debug>
+int arc_welder::process_lookahead_gcode_(const parsed_command& cmd, bool is_end, bool is_move, double move_duration_seconds)
+{
+	position* p_cur_pos = p_source_position_->get_current_position_ptr();
+	position* p_pre_pos = p_source_position_->get_previous_position_ptr();
+	const extruder& extruder_current = p_cur_pos->get_current_extruder();
+	const extruder& previous_extruder = p_pre_pos->get_current_extruder();
+	if (is_shape_eligible_(cmd, is_end, *p_cur_pos, *p_pre_pos, previous_extruder, extruder_current))
+	{
+		if (!waiting_for_arc_)
 		{
-			position* prev_pos = p_source_position_->get_previous_position_ptr();
-			length = utilities::get_cartesian_distance(cur_pos->x, cur_pos->y, prev_pos->x, prev_pos->y);
+			if (log_debug)
+			{
+				LOG_LAZY(p_logger_, logger_type_, DEBUG, "Starting new path from Gcode:" << cmd.gcode);
+			}
+			write_unwritten_gcodes_to_file();
+			previous_is_extruder_relative_ = p_pre_pos->is_extruder_relative;
+			previous_feedrate_ = unrestored_feedrate_ > 0 ? unrestored_feedrate_ : p_pre_pos->f;
+			segmentation_optimizer_.set_is_xyz_relative(p_pre_pos->is_relative);
+			current_arc_.set_is_xyz_relative(p_pre_pos->is_relative);
+			set_shape_tolerances(p_cur_pos->feature_type_tag);
+			arc_min_feedrate_ = p_cur_pos->f;
+			arc_max_feedrate_ = p_cur_pos->f;
+			lookahead_points_.clear();
+			lookahead_commands_.clear();
+			// The previous point starts the path, and doesn't add any extrusion
+			lookahead_points_.push_back(point(p_pre_pos->get_gcode_x(), p_pre_pos->get_gcode_y(), p_pre_pos->get_gcode_z(), 0));
+			waiting_for_arc_ = true;
 		}
-		
-		unwritten_commands_.push_back(unwritten_command(cur_pos, length));
-		
+		else
+		{
+			if (p_cur_pos->f < arc_min_feedrate_) arc_min_feedrate_ = p_cur_pos->f;
+			if (p_cur_pos->f > arc_max_feedrate_) arc_max_feedrate_ = p_cur_pos->f;
+		}
+		lookahead_points_.push_back(point(p_cur_pos->get_gcode_x(), p_cur_pos->get_gcode_y(), p_cur_pos->get_gcode_z(), extruder_current.e_relative));
+		push_unwritten_command_(lookahead_commands_, cmd, is_move, move_duration_seconds);
+		if (lookahead_commands_.count() >= segmentation_lookahead_)
+		{
+			write_lookahead_path_(NULL, false);
+		}
+		return 0;
 	}
-	if (!waiting_for_arc_)
+
+	if (waiting_for_arc_)
 	{
+		if (log_debug && !cmd.is_empty)
+		{
+			LOG_LAZY(p_logger_, logger_type_, DEBUG, "Path ended, writing " << lookahead_commands_.count() << " held back segments.  Gcode:" << cmd.gcode);
+		}
+		write_lookahead_path_(is_end ? NULL : &cmd, true);
+		waiting_for_arc_ = false;
+		if (!is_end)
+		{
+			// The command may still start a new path
+			return process_lookahead_gcode_<log_debug>(cmd, is_end, is_move, move_duration_seconds);
+		}
+	}
+	if (!is_end)
+	{
+		push_unwritten_command_(unwritten_commands_, cmd, is_move, move_duration_seconds);
 		write_unwritten_gcodes_to_file();
 	}
-	return lines_written;
+	return 0;
+}
+
+bool arc_welder::has_shape_to_finish_()
+{
+	// When looking ahead, the held back path is written even if it contains no shapes
+	return waiting_for_arc_ && (segmentation_lookahead_ > 0 || get_shape_to_write() != NULL);
+}
+
+void arc_welder::write_lookahead_path_(const parsed_command* p_next_cmd, bool is_final)
+{
+	segmentation_optimizer_.optimize(lookahead_points_, lookahead_pieces_);
+	if (lookahead_pieces_.empty())
+	{
+		return;
+	}
+	int num_pieces = static_cast<int>(lookahead_pieces_.size());
+	if (!is_final && num_pieces > 1)
+	{
+		// The last piece may be continued by the points that follow, so keep it
+		num_pieces--;
+	}
+	for (int index = 0; index < num_pieces; index++)
+	{
+		const segmentation_piece& piece = lookahead_pieces_[index];
+		if (piece.type == segmentation_piece_segment)
+		{
+			unwritten_commands_.push_back(lookahead_commands_[piece.start_index]);
+			unrestored_feedrate_ = -1;
+		}
+		else
+		{
+			add_lookahead_shape_(piece, p_next_cmd);
+		}
+	}
+	write_unwritten_gcodes_to_file();
+
+	// Remove what was written.  The end of the last piece written starts the rest of the path.
+	const int end_index = lookahead_pieces_[num_pieces - 1].end_index;
+	previous_feedrate_ = unrestored_feedrate_ > 0 ? unrestored_feedrate_ : lookahead_commands_[end_index - 1].f;
+	for (int index = 0; index < end_index; index++)
+	{
+		lookahead_points_.pop_front();
+		lookahead_commands_.pop_front();
+	}
+	if (lookahead_commands_.count() > 0)
+	{
+		// Only the feedrates that are still held back limit the rest of the path
+		arc_min_feedrate_ = lookahead_commands_[0].f;
+		arc_max_feedrate_ = lookahead_commands_[0].f;
+		for (int index = 1; index < lookahead_commands_.count(); index++)
+		{
+			const double f = lookahead_commands_[index].f;
+			if (f < arc_min_feedrate_) arc_min_feedrate_ = f;
+			if (f > arc_max_feedrate_) arc_max_feedrate_ = f;
+		}
+	}
+}
+
+void arc_welder::add_lookahead_shape_(const segmentation_piece& piece, const parsed_command* p_next_cmd)
+{
+	segmented_shape* p_shape = segmentation_optimizer_.get_shape(lookahead_points_, piece);
+	if (p_shape == NULL)
+	{
+		// The piece was fit with the same points, so this should never happen.  Write the segments as they are.
+		for (int index = piece.start_index; index < piece.end_index; index++)
+		{
+			unwritten_commands_.push_back(lookahead_commands_[index]);
+		}
+		return;
+	}
+	const bool is_arc = piece.type == segmentation_piece_arc;
+	const int num_segments = p_shape->get_num_segments();
+	points_compressed_ += num_segments - 1;
+	if (is_arc)
+	{
+		arcs_created_++;
+	}
+	else
+	{
+		splines_created_++;
+	}
+	arc arc_shape;
+	const bool has_arc = is_arc && static_cast<segmented_arc*>(p_shape)->try_get_arc(arc_shape);
+	if (telemetry_enabled_)
+	{
+		add_telemetry_record_(is_arc ? arc_telemetry_arc_emitted : arc_telemetry_spline_emitted, num_segments, has_arc ? arc_shape.radius : 0);
+	}
+
+	// Add the commands the shape replaces, so that the comment and feedrate are found the same way as for other shapes
+	double min_f = lookahead_commands_[piece.start_index].f;
+	double max_f = min_f;
+	double duration_seconds = 0;
+	for (int index = piece.start_index; index < piece.end_index; index++)
+	{
+		const unwritten_command& command = lookahead_commands_[index];
+		if (command.f < min_f) min_f = command.f;
+		if (command.f > max_f) max_f = command.f;
+		duration_seconds += command.duration_seconds;
+		unwritten_commands_.push_back(command);
+	}
+	std::string comment = get_comment_for_arc(num_segments);
+	const unwritten_command& last_command = lookahead_commands_[piece.end_index - 1];
+	const double restore_f = last_command.f;
+	double current_f = restore_f;
+	if (min_f != max_f)
+	{
+		current_f = get_weighted_feedrate(num_segments);
+	}
+	for (int index = piece.start_index; index < piece.end_index; index++)
+	{
+		unwritten_commands_.pop_back();
+	}
+	if (has_arc && current_f > 0)
+	{
+		const double z_change = arc_shape.end_point.z - arc_shape.start_point.z;
+		duration_seconds = std::sqrt(arc_shape.length * arc_shape.length + z_change * z_change) / (current_f / 60.0);
+	}
+
+	// Don't restore the feedrate if it didn't change, or if the next command sets its own feedrate.  Always restore it
+	// if the next command isn't known yet.
+	const parsed_command* p_following_cmd = piece.end_index < lookahead_commands_.count() ? &lookahead_commands_[piece.end_index].command : p_next_cmd;
+	bool restore_feedrate = utilities::greater_than_or_equal(restore_f, 1) && current_f != restore_f;
+	if (restore_feedrate && p_following_cmd != NULL && (p_following_cmd->command == "G0" || p_following_cmd->command == "G1" || p_following_cmd->command == "G2" || p_following_cmd->command == "G3"))
+	{
+		for (unsigned int index = 0; index < p_following_cmd->parameters.size(); index++)
+		{
+			if (p_following_cmd->parameters[index].name == "F")
+			{
+				restore_feedrate = false;
+				break;
+			}
+		}
+	}
+
+	// Only write the feedrate if it differs from the feedrate before the shape
+	const double arc_f = current_f;
+	double previous_f = piece.start_index == 0 ? previous_feedrate_ : lookahead_commands_[piece.start_index - 1].f;
+	if (unrestored_feedrate_ > 0)
+	{
+		// The shape before this one was left at its own feedrate
+		previous_f = unrestored_feedrate_;
+	}
+	unrestored_feedrate_ = !restore_feedrate && arc_f != restore_f ? arc_f : -1;
+	if (previous_f > 0 && previous_f == current_f)
+	{
+		current_f = 0;
+	}
+	std::string gcode;
+	const vector error_before = relative_position_error_;
+	if (previous_is_extruder_relative_)
+	{
+		gcode = get_arc_gcode_relative(*p_shape, current_f, comment);
+	}
+	else
+	{
+		gcode = get_arc_gcode_absolute(*p_shape, last_command.offset_e, current_f, comment);
+	}
+
+	unwritten_command shape_command(parser_.parse_gcode(gcode.c_str()), previous_is_extruder_relative_, p_shape->get_shape_length(), true, duration_seconds);
+	shape_command.source_start_line = lookahead_commands_[piece.start_index].source_start_line;
+	shape_command.source_end_line = last_command.source_end_line;
+	if (has_arc && arc_coalescer_.is_enabled())
+	{
+		coalescable_arc::try_create(
+			arc_shape,
+			p_shape->is_xyz_relative(),
+			previous_is_extruder_relative_,
+			p_shape->get_shape_e_relative(),
+			last_command.offset_e,
+			arc_f,
+			current_f >= 1,
+			shape_command.arc
+		);
+		set_coalescable_offset_(shape_command.arc, error_before);
+	}
+	unwritten_commands_.push_back(shape_command);
+	if (restore_feedrate)
+	{
+		// The shape was written with an averaged feedrate, so set the feedrate back to that of the last segment
+		char buf[20];
+		std::string feedrate_gcode = "G1 F";
+		feedrate_gcode += utilities::to_string(restore_f, 0, buf);
+		unwritten_command feedrate_command(parser_.parse_gcode(feedrate_gcode.c_str()), previous_is_extruder_relative_, 0);
+		feedrate_command.source_start_line = shape_command.source_start_line;
+		feedrate_command.source_end_line = shape_command.source_end_line;
+		unwritten_commands_.push_back(feedrate_command);
+	}
+}
+
+bool arc_welder::is_shape_eligible_(const parsed_command& cmd, bool is_end, const position& cur_pos, const position& pre_pos, const extruder& previous_extruder, const extruder& current_extruder) const
+{
+	// We need to make sure the printer is extruding, and that the xyz and extruder axis modes are the same as those of the previous position.
+	// Shapes are always fit using the absolute positions, and are written relative to their start point if the xyz axis mode is relative.
+	return (
+		!is_end && cmd.is_known_command && !cmd.is_empty && (
+			(cmd.command == "G0" || cmd.command == "G1") &&
+			(allow_3d_arcs_ || utilities::is_equal(cur_pos.z, pre_pos.z)) &&
+			utilities::is_equal(cur_pos.x_offset, pre_pos.x_offset) &&
+			utilities::is_equal(cur_pos.y_offset, pre_pos.y_offset) &&
+			utilities::is_equal(cur_pos.z_offset, pre_pos.z_offset) &&
+			utilities::is_equal(cur_pos.x_firmware_offset, pre_pos.x_firmware_offset) &&
+			utilities::is_equal(cur_pos.y_firmware_offset, pre_pos.y_firmware_offset) &&
+			utilities::is_equal(cur_pos.z_firmware_offset, pre_pos.z_firmware_offset) &&
+			cur_pos.is_relative == pre_pos.is_relative &&
+			(
+				!waiting_for_arc_ ||
+				(previous_extruder.is_extruding && current_extruder.is_extruding) ||
+				(previous_extruder.is_retracting && current_extruder.is_retracting)
+			) &&
+			cur_pos.is_extruder_relative == pre_pos.is_extruder_relative &&
+			(!waiting_for_arc_ || is_feedrate_within_tolerance(cur_pos.f)) &&
+			(!waiting_for_arc_ || pre_pos.feature_type_tag == cur_pos.feature_type_tag)
+			)
+	);
+}
+
+void arc_welder::push_unwritten_command_(array_list<unwritten_command>& commands, const parsed_command& cmd, bool is_move, double move_duration_seconds)
+{
+	position* cur_pos = p_source_position_->get_current_position_ptr();
+	extruder& cur_extruder = cur_pos->get_current_extruder();
+
+	double length = 0;
+	if (cur_pos->has_xy_position_changed && (cur_extruder.is_extruding || cur_extruder.is_retracting))
+	{
+		position* prev_pos = p_source_position_->get_previous_position_ptr();
+		length = utilities::get_cartesian_distance(cur_pos->x, cur_pos->y, prev_pos->x, prev_pos->y);
+	}
+	
+	commands.push_back(unwritten_command(cur_pos, length, is_move, move_duration_seconds));
+	// Absolute moves, homing and setting the position put the target back at the source position for each axis they set
+	const bool is_absolute_move = !cur_pos->is_relative && (cmd.command == "G0" || cmd.command == "G1" || cmd.command == "G2" || cmd.command == "G3");
+	if (is_absolute_move || cmd.command == "G28" || cmd.command == "G92")
+	{
+		bool has_axis = false;
+		for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+		{
+			const std::string& name = cmd.parameters[index].name;
+			if (name == "X")
+			{
+				relative_position_error_.x = 0;
+				has_axis = true;
+			}
+			else if (name == "Y")
+			{
+				relative_position_error_.y = 0;
+				has_axis = true;
+			}
+			else if (name == "Z")
+			{
+				relative_position_error_.z = 0;
+				has_axis = true;
+			}
+		}
+		if ((cmd.command == "G28" && !has_axis) || (cmd.command == "G92" && cmd.parameters.size() == 0))
+		{
+			// G28 without any axes homes all of them, and G92 without parameters sets all of them to 0
+			relative_position_error_ = vector();
+		}
+	}
+	if (arc_coalescer_.is_enabled() && (cmd.command == "G2" || cmd.command == "G3"))
+	{
+		// Arcs in the source can be joined with each other, and with the arcs we create, if their start is known
+		position* prev_pos = p_source_position_->get_previous_position_ptr();
+		if (!prev_pos->x_null && !prev_pos->y_null && !prev_pos->z_null)
+		{
+			coalescable_arc::try_create(
+				cmd,
+				point(prev_pos->get_gcode_x(), prev_pos->get_gcode_y(), prev_pos->get_gcode_z(), 0),
+				point(cur_pos->get_gcode_x(), cur_pos->get_gcode_y(), cur_pos->get_gcode_z(), 0),
+				cur_pos->is_relative,
+				cur_pos->is_extruder_relative,
+				cur_extruder.e_relative,
+				cur_extruder.get_offset_e(),
+				cur_pos->f,
+				commands[commands.count() - 1].arc
+			);
+		}
+	}
+}
+
+void arc_welder::set_coalescable_offset_(coalescable_arc& arc, const vector& error_before) const
+{
+	if (!arc.is_valid || !arc.is_xyz_relative)
+	{
+		return;
+	}
+	// The offset written is the offset between the points plus the error carried into the arc, less the error left after it
+	arc.relative_x = arc.end_point.x - arc.start_point.x + error_before.x - relative_position_error_.x;
+	arc.relative_y = arc.end_point.y - arc.start_point.y + error_before.y - relative_position_error_.y;
+}
+
+void arc_welder::update_analysis_(const position& pre_pos, const position& cur_pos, bool is_move)
+{
+	const extruder& cur_extruder = cur_pos.get_current_extruder();
+	if (!utilities::is_zero(cur_extruder.e_relative))
+	{
+		analysis_.add_filament(cur_pos.current_tool, cur_extruder.e_relative);
+	}
+	if (is_move && cur_extruder.is_extruding && cur_pos.has_xy_position_changed)
+	{
+		analysis_.add_printing_point(pre_pos.x, pre_pos.y, pre_pos.z);
+		analysis_.add_printing_point(cur_pos.x, cur_pos.y, cur_pos.z);
+		analysis_.add_extruding_move(pre_pos.z, cur_pos.z);
+	}
+	if (cur_pos.command.comment.length() > 0)
+	{
+		analysis_.add_comment(cur_pos.command.comment);
+	}
+}
+
+arc_telemetry_decision arc_welder::get_ineligible_reason_(const parsed_command& cmd, const position& cur_pos, const position& pre_pos, const extruder& previous_extruder, const extruder& current_extruder) const
+{
+	// Check in the same order as the eligibility test in process_gcode_
+	if (cmd.is_empty || !cmd.is_known_command || (cmd.command != "G0" && cmd.command != "G1"))
+		return arc_telemetry_not_g0_g1;
+	if (!allow_3d_arcs_ && !utilities::is_equal(cur_pos.z, pre_pos.z))
+		return arc_telemetry_z_changed;
+	if (
+		!utilities::is_equal(cur_pos.x_offset, pre_pos.x_offset) ||
+		!utilities::is_equal(cur_pos.y_offset, pre_pos.y_offset) ||
+		!utilities::is_equal(cur_pos.z_offset, pre_pos.z_offset) ||
+		!utilities::is_equal(cur_pos.x_firmware_offset, pre_pos.x_firmware_offset) ||
+		!utilities::is_equal(cur_pos.y_firmware_offset, pre_pos.y_firmware_offset) ||
+		!utilities::is_equal(cur_pos.z_firmware_offset, pre_pos.z_firmware_offset)
+	)
+		return arc_telemetry_offset_changed;
+	if (cur_pos.is_relative != pre_pos.is_relative)
+		return arc_telemetry_xyz_mode_changed;
+	if (
+		waiting_for_arc_ && !(
+			(previous_extruder.is_extruding && current_extruder.is_extruding) ||
+			(previous_extruder.is_retracting && current_extruder.is_retracting)
+		)
+	)
+		return arc_telemetry_extrusion_changed;
+	if (cur_pos.is_extruder_relative != pre_pos.is_extruder_relative)
+		return arc_telemetry_extruder_mode_changed;
+	if (waiting_for_arc_ && !is_feedrate_within_tolerance(cur_pos.f))
+		return arc_telemetry_feedrate_changed;
+	if (waiting_for_arc_ && pre_pos.feature_type_tag != cur_pos.feature_type_tag)
+		return arc_telemetry_feature_changed;
+	return arc_telemetry_unknown;
+}
+
+arc_telemetry_decision arc_welder::get_telemetry_decision_(arc_rejection_reason reason)
+{
+	switch (reason)
+	{
+	case arc_rejection_max_segments:
+		return arc_telemetry_max_segments;
+	case arc_rejection_z_changed:
+		return arc_telemetry_z_changed;
+	case arc_rejection_no_distance:
+		return arc_telemetry_no_distance;
+	case arc_rejection_radius_exceeded:
+		return arc_telemetry_radius_exceeded;
+	case arc_rejection_no_fit:
+		return arc_telemetry_no_fit;
+	default:
+		return arc_telemetry_unknown;
+	}
+}
+
+void arc_welder::add_telemetry_record_(arc_telemetry_decision decision, int num_segments, double radius)
+{
+	const position* p_cur_pos = p_source_position_->get_current_position_ptr();
+	telemetry_.add_record(lines_processed_, p_cur_pos->layer, decision, p_cur_pos->feature_type_tag, num_segments, radius);
+}
+
+segmented_shape* arc_welder::get_shape_to_write()
+{
+	// Prefer arcs, unless the spline replaces more segments
+	segmented_shape* p_shape = NULL;
+	if (arc_fitting_ && current_arc_.is_shape())
+	{
+		p_shape = &current_arc_;
+	}
+	if (
+		bezier_fitting_ && current_bezier_.is_shape() &&
+		(p_shape == NULL || current_bezier_.get_num_segments() > p_shape->get_num_segments())
+	)
+	{
+		p_shape = &current_bezier_;
+	}
+	return p_shape;
+}
+
+bool arc_welder::is_feedrate_within_tolerance(double f) const
+{
+	// Compare against the slowest and fastest segments of the current arc, so that many small
+	// changes can't add up to more than the tolerance.  A tolerance of 0 requires an exact match.
+	double min_f = f < arc_min_feedrate_ ? f : arc_min_feedrate_;
+	double max_f = f > arc_max_feedrate_ ? f : arc_max_feedrate_;
+	if (feedrate_tolerance_percent_ <= 0)
+	{
+		return min_f == max_f;
+	}
+	return max_f - min_f <= min_f * feedrate_tolerance_percent_ / 100.0;
+}
+
+double arc_welder::get_weighted_feedrate(int num_segments)
+{
+	// Average the feedrates of the unwritten commands that make up the arc, weighted by their length.
+	// Skip the first point, it is the starting point.
+	double total_length = 0;
+	double total_weighted_f = 0;
+	for (int index = unwritten_commands_.count() - (num_segments - 1); index < unwritten_commands_.count(); index++)
+	{
+		const unwritten_command& command = unwritten_commands_[index];
+		total_length += command.extrusion_length;
+		total_weighted_f += command.f * command.extrusion_length;
+	}
+	if (total_length <= 0)
+	{
+		return arc_max_feedrate_;
+	}
+	// Round to the precision used when writing F
+	return std::floor(total_weighted_f / total_length + 0.5);
+}
+
+void arc_welder::clear_shapes()
+{
+	current_arc_.clear();
+	current_bezier_.clear();
+	arc_fitting_ = false;
+	bezier_fitting_ = false;
 }
 
-std::string arc_welder::get_comment_for_arc()
+std::string arc_welder::get_comment_for_arc(int num_segments)
 {
 	// build a comment string from the commands making up the arc
 				// We need to start with the first command entered.
-	int comment_index = unwritten_commands_.count() - (current_arc_.get_num_segments() - 1);
+	int comment_index = unwritten_commands_.count() - (num_segments - 1);
 	std::string comment;
 	for (; comment_index < unwritten_commands_.count(); comment_index++)
 	{
@@ -673,9 +1910,15 @@ std::string arc_welder::create_g92_e(double absolute_e)
 	return stream.str();
 }
 
-int arc_welder::write_gcode_to_file(std::string gcode)
+int arc_welder::write_gcode_to_file(const std::string& gcode)
 {
-	output_file_ << gcode << "\n";
+	if (!dry_run_)
+	{
+		p_output_file_->write(gcode);
+		p_output_file_->write("\n", 1);
+	}
+	target_file_size_ += static_cast<long>(gcode.length()) + 1;
+	target_lines_written_++;
 	return 1;
 }
 
@@ -687,24 +1930,80 @@ int arc_welder::write_unwritten_gcodes_to_file()
 	
 	for (int index = 0; index < size; index++)
 	{
-		// The the current unwritten position and remove it from the list
-		unwritten_command p = unwritten_commands_.pop_front();
-		if (p.extrusion_length > 0)
+		// Write the commands in place, and remove them all once they are written
+		unwritten_command& p = unwritten_commands_[index];
+		if (p.arc.is_valid)
 		{
-			segment_statistics_.update(p.extrusion_length, false);
+			coalescable_arc merged;
+			if (has_pending_arc_ && arc_coalescer_.try_merge(pending_arc_.arc, p.arc, merged))
+			{
+				pending_arc_.arc = merged;
+				pending_arc_.extrusion_length += p.extrusion_length;
+				pending_arc_.duration_seconds += p.duration_seconds;
+				pending_arc_.source_end_line = p.source_end_line;
+				pending_arc_merges_++;
+				arcs_coalesced_++;
+				continue;
+			}
+			// Hold this arc back, since the next arc may continue it
+			write_pending_arc_();
+			pending_arc_ = p;
+			has_pending_arc_ = true;
+			pending_arc_merges_ = 0;
+			continue;
 		}
-		write_gcode_to_file(p.command.to_string());
+		write_pending_arc_();
+		write_unwritten_command_(p);
 	}
+	unwritten_commands_.clear();
 	
 	return size;
 }
 
-std::string arc_welder::get_arc_gcode_relative(double f, const std::string comment)
+void arc_welder::write_pending_arc_()
+{
+	if (!has_pending_arc_)
+	{
+		return;
+	}
+	has_pending_arc_ = false;
+	if (pending_arc_merges_ > 0)
+	{
+		// Only rewrite arcs that were joined, so that everything else is written exactly as it was created
+		std::string gcode = arc_coalescer::get_gcode(pending_arc_.arc);
+		if (pending_arc_.command.comment.size() > 0)
+		{
+			gcode += ";";
+			gcode += pending_arc_.command.comment;
+		}
+		pending_arc_.command = parser_.parse_gcode(gcode.c_str());
+	}
+	write_unwritten_command_(pending_arc_);
+}
+
+void arc_welder::write_unwritten_command_(unwritten_command& command)
+{
+	if (command.extrusion_length > 0)
+	{
+		segment_statistics_.update(command.extrusion_length, false);
+	}
+	write_gcode_to_file(command.command.to_string());
+	if (map_source_lines_)
+	{
+		source_line_map_.add_target_line(target_lines_written_, command.source_start_line, command.source_end_line);
+	}
+	if (command.is_move)
+	{
+		target_command_rates_.add_command(command.duration_seconds, target_lines_written_);
+	}
+}
+
+std::string arc_welder::get_arc_gcode_relative(segmented_shape& shape, double f, const std::string& comment)
 {
 	// Write gcode to file
 	std::string gcode;
 
-	gcode = current_arc_.get_shape_gcode_relative(f);
+	gcode = shape.get_shape_gcode_relative(f, relative_position_error_);
 	
 	if (comment.length() > 0)
 	{
@@ -714,12 +2013,12 @@ std::string arc_welder::get_arc_gcode_relative(double f, const std::string comme
 	
 }
 
-std::string arc_welder::get_arc_gcode_absolute(double e, double f, const std::string comment)
+std::string arc_welder::get_arc_gcode_absolute(segmented_shape& shape, double e, double f, const std::string& comment)
 {
 	// Write gcode to file
 	std::string gcode;
 
-	gcode = current_arc_.get_shape_gcode_absolute(e, f);
+	gcode = shape.get_shape_gcode_absolute(e, f, relative_position_error_);
 
 	if (comment.length() > 0)
 	{
@@ -737,9 +2036,37 @@ void arc_welder::add_arcwelder_comment_to_target()
 	stream <<	"; Postprocessed by [ArcWelder](https://github.com/FormerLurker/ArcWelderLib)\n";
 	stream << "; Copyright(C) 2020 - Brad Hochgesang\n";
 	stream << "; arc_welder_resolution_mm = " << resolution_mm_ << "\n";
-	stream << "; arc_welder_g90_influences_extruder = " << (gcode_position_args_.g90_influences_extruder ? "True" : "False") << "\n\n";
+	stream << "; arc_welder_g90_influences_extruder = " << (gcode_position_args_.g90_influences_extruder ? "True" : "False") << "\n";
+	stream << "; arc_welder_allow_g5_splines = " << (allow_g5_splines_ ? "True" : "False") << "\n";
+	stream << "; arc_welder_allow_3d_arcs = " << (allow_3d_arcs_ ? "True" : "False") << "\n";
+	for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+	{
+		if (feature_resolution_mm_[index] != resolution_mm_)
+		{
+			stream << "; arc_welder_resolution_mm." << feature_type_name[index] << " = " << feature_resolution_mm_[index] << "\n";
+		}
+	}
+	if (arc_coalescer_.is_enabled())
+	{
+		stream << "; arc_welder_max_coalesced_sweep_degrees = " << arc_coalescer_.get_max_sweep_degrees() << "\n";
+	}
+	if (segmentation_lookahead_ > 0)
+	{
+		stream << "; arc_welder_segmentation_lookahead = " << segmentation_lookahead_ << "\n";
+	}
+	if (current_arc_.get_float_fitting())
+	{
+		stream << "; arc_welder_float_fitting = True\n";
+	}
+	stream << "\n";
 	
-	output_file_ << stream.str();
+	std::string comment = stream.str();
+	target_lines_written_ += static_cast<int>(std::count(comment.begin(), comment.end(), '\n'));
+	target_file_size_ += static_cast<long>(comment.length());
+	if (!dry_run_)
+	{
+		p_output_file_->write(comment);
+	}
 }
 
 
@@ -30,11 +30,21 @@
 #include "gcode_position.h"
 #include "position.h"
 #include "gcode_parser.h"
+#include "line_reader.h"
+#include "compressed_stream.h"
+#include "parsed_command_file.h"
+#include "line_offset_index.h"
 #include "segmented_arc.h"
+#include "segmented_bezier.h"
+#include "source_line_map.h"
+#include "arc_telemetry.h"
+#include "arc_coalescer.h"
+#include "segmentation_optimizer.h"
 #include <iostream>
 #include <fstream>
 #include "array_list.h"
 #include "unwritten_command.h"
+#include "command_rate_statistics.h"
 #include "logger.h"
 #include <cmath>
 
@@ -44,6 +54,13 @@
 
 
 #define DEFAULT_G90_G91_INFLUENCES_EXTREUDER false
+#define DEFAULT_ALLOW_G5_SPLINES false
+#define DEFAULT_FEEDRATE_TOLERANCE_PERCENT 0.0
+#define DEFAULT_DRY_RUN false
+#define DEFAULT_ESTIMATE_NUM_SAMPLES 10
+#define DEFAULT_ESTIMATE_SAMPLE_SIZE_BYTES 65536
+// The most lines held back while a shape is fit when welding a stream.  The buffer size is 5 more than this.
+#define DEFAULT_STREAM_MAX_SEGMENTS 45
 
 static const int segment_statistic_lengths_count = 12;
 const double segment_statistic_lengths[] = { 0.002f, 0.005f, 0.01f, 0.05f, 0.1f, 0.5f, 1.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f };
@@ -319,6 +336,7 @@ struct arc_welder_progress {
 		lines_processed = 0;
 		points_compressed = 0;
 		arcs_created = 0;
+		splines_created = 0;
 		source_file_size = 0;
 		source_file_position = 0;
 		target_file_size = 0;
@@ -333,12 +351,16 @@ struct arc_welder_progress {
 	int lines_processed;
 	int points_compressed;
 	int arcs_created;
+	int splines_created;
 	double compression_ratio;
 	double compression_percent;
 	long source_file_position;
 	long source_file_size;
 	long target_file_size;
 	source_target_segment_statistics segment_statistics;
+	// Only calculated once processing is complete
+	command_rate_summary source_command_rates;
+	command_rate_summary target_command_rates;
 
 	std::string str() const {
 		std::stringstream stream;
@@ -349,6 +371,7 @@ struct arc_welder_progress {
 		stream << ", Current Line: " << lines_processed;
 		stream << ", Points Compressed: " << points_compressed;
 		stream << ", ArcsCreated: " << arcs_created;
+		stream << ", SplinesCreated: " << splines_created;
 		stream << ", Compression Ratio: " << compression_ratio;
 		stream << ", Size Reduction: " << compression_percent << "% ";
 		return stream.str();
@@ -356,6 +379,8 @@ struct arc_welder_progress {
 	std::string detail_str() const {
 		std::stringstream stream;
 		stream << "\n" << "Extrusion/Retraction Counts" << "\n" << segment_statistics.str() << "\n";
+		stream << "\n" << "Source Command Rate" << "\n" << source_command_rates.str() << "\n";
+		stream << "\n" << "Target Command Rate" << "\n" << target_command_rates.str() << "\n";
 		return stream.str();
 	}
 };
@@ -363,6 +388,117 @@ struct arc_welder_progress {
 // define the progress callback type 
 typedef bool(*progress_callback)(arc_welder_progress, logger* p_logger, int logger_type);
 
+// The dimensions, filament use and print time of the gcode, gathered while welding so that the target doesn't need to be
+// analyzed again.  Only filled in by process().
+struct arc_welder_analysis {
+	arc_welder_analysis()
+	{
+		clear();
+	}
+	void clear()
+	{
+		has_printing_area = false;
+		min_x = 0;
+		max_x = 0;
+		min_y = 0;
+		max_y = 0;
+		min_z = 0;
+		max_z = 0;
+		filament_length_mm.clear();
+		layer_count = 0;
+		layer_comment_count = 0;
+		extruding_layer_count = 0;
+		last_layer_z = 0;
+		estimated_print_time_seconds = 0;
+	}
+	// Add a point to the printing area (the extents of all extruding moves)
+	void add_printing_point(double x, double y, double z)
+	{
+		if (!has_printing_area)
+		{
+			min_x = max_x = x;
+			min_y = max_y = y;
+			min_z = max_z = z;
+			has_printing_area = true;
+			return;
+		}
+		if (x < min_x) min_x = x;
+		else if (x > max_x) max_x = x;
+		if (y < min_y) min_y = y;
+		else if (y > max_y) max_y = y;
+		if (z < min_z) min_z = z;
+		else if (z > max_z) max_z = z;
+	}
+	// Counts the layer change comments written by Cura and ideaMaker (LAYER:<n>), PrusaSlicer and its forks (LAYER_CHANGE)
+	// and Simplify3D (layer <n>, Z = <z>).
+	void add_comment(const std::string& comment)
+	{
+		const size_t start = comment.find_first_not_of(' ');
+		if (start == std::string::npos)
+		{
+			return;
+		}
+		if (
+			comment.compare(start, 6, "LAYER:") == 0 ||
+			comment.compare(start, std::string::npos, "LAYER_CHANGE") == 0 ||
+			(comment.compare(start, 6, "layer ") == 0 && start + 6 < comment.length() && comment[start + 6] >= '0' && comment[start + 6] <= '9')
+		)
+		{
+			layer_comment_count++;
+			update_layer_count();
+		}
+	}
+	// Counts a layer when an extruding move stays at a height above every previous layer.  Moves that change Z while
+	// extruding (spiral vase, 3D arcs) don't start a layer, since there is no way to tell where one ends without comments.
+	void add_extruding_move(double previous_z, double z)
+	{
+		if (!utilities::is_equal(previous_z, z))
+		{
+			return;
+		}
+		if (extruding_layer_count > 0 && !utilities::greater_than(z, last_layer_z))
+		{
+			return;
+		}
+		extruding_layer_count++;
+		last_layer_z = z;
+		update_layer_count();
+	}
+	void add_filament(int tool, double e_relative)
+	{
+		if (tool < 0)
+		{
+			return;
+		}
+		if (static_cast<int>(filament_length_mm.size()) <= tool)
+		{
+			filament_length_mm.resize(tool + 1, 0);
+		}
+		filament_length_mm[tool] += e_relative;
+	}
+	bool has_printing_area;
+	double min_x;
+	double max_x;
+	double min_y;
+	double max_y;
+	double min_z;
+	double max_z;
+	// The net length of filament extruded by each tool, retractions are subtracted
+	std::vector<double> filament_length_mm;
+	// The number of slicer layer change comments, or the number of extruding layers when the slicer doesn't write them
+	int layer_count;
+	int layer_comment_count;
+	int extruding_layer_count;
+	double last_layer_z;
+	// The duration of every move in the target at its feedrate, with arcs timed by their arc length.  Acceleration is ignored.
+	double estimated_print_time_seconds;
+private:
+	void update_layer_count()
+	{
+		layer_count = layer_comment_count > 0 ? layer_comment_count : extruding_layer_count;
+	}
+};
+
 struct arc_welder_results {
 	arc_welder_results() : progress()
 	{
@@ -374,55 +510,226 @@ struct arc_welder_results {
 	bool cancelled;
 	std::string message;
 	arc_welder_progress progress;
+	arc_welder_analysis analysis;
+};
+
+// Struct to hold the results of a sampled estimate.  The estimated values are extrapolated from the samples to the full source file.
+struct arc_welder_estimate {
+	arc_welder_estimate()
+	{
+		success = false;
+		message = "";
+		num_samples = 0;
+		source_file_size = 0;
+		sampled_source_bytes = 0;
+		sampled_target_bytes = 0;
+		sampled_arcs_created = 0;
+		sampled_splines_created = 0;
+		seconds_elapsed = 0;
+		estimated_target_file_size = 0;
+		estimated_arcs_created = 0;
+		estimated_splines_created = 0;
+		estimated_seconds = 0;
+		compression_ratio = 0;
+		compression_percent = 0;
+	}
+	bool success;
+	std::string message;
+	int num_samples;
+	long source_file_size;
+	long sampled_source_bytes;
+	long sampled_target_bytes;
+	int sampled_arcs_created;
+	int sampled_splines_created;
+	double seconds_elapsed;
+	long estimated_target_file_size;
+	int estimated_arcs_created;
+	int estimated_splines_created;
+	double estimated_seconds;
+	double compression_ratio;
+	double compression_percent;
+
+	std::string str() const {
+		std::stringstream stream;
+		stream << std::fixed << std::setprecision(2);
+		stream << "Estimated from " << num_samples << " samples (" << sampled_source_bytes << " of " << source_file_size << " bytes) in " << seconds_elapsed << " seconds.";
+		stream << " Estimated Arcs Created: " << estimated_arcs_created;
+		stream << ", Estimated Splines Created: " << estimated_splines_created;
+		stream << ", Estimated Processing Time: " << estimated_seconds << " seconds";
+		stream << ", Estimated Compression Ratio: " << compression_ratio;
+		stream << ", Estimated Size Reduction: " << compression_percent << "% ";
+		return stream.str();
+	}
 };
 
 class arc_welder
 {
 public:
-	arc_welder(std::string source_path, std::string target_path, logger* log, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, progress_callback callback = NULL);
+	arc_welder(std::string source_path, std::string target_path, logger* log, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, bool allow_g5_splines = DEFAULT_ALLOW_G5_SPLINES, bool allow_3d_arcs = DEFAULT_ALLOW_3D_ARCS, double feedrate_tolerance_percent = DEFAULT_FEEDRATE_TOLERANCE_PERCENT, double command_rate_limit = DEFAULT_COMMAND_RATE_LIMIT, bool dry_run = DEFAULT_DRY_RUN, progress_callback callback = NULL);
 	void set_logger_type(int logger_type);
+	// Override the resolution and max radius for a feature type (see gcode_comment_processor.h)
+	void set_feature_resolution_mm(int feature_type, double resolution_mm);
+	void set_feature_max_radius_mm(int feature_type, double max_radius_mm);
+	// When set, the parsed source is read from this file if it is up to date, and written to it otherwise.
+	void set_parsed_command_file_path(std::string parsed_command_file_path);
+	// When set, an index of the source line offsets and layer starts is saved to this file after processing.
+	void set_line_offset_index_path(std::string line_offset_index_path);
+	// When set, a map from each target line to the source lines it was created from is saved to this file after processing.
+	void set_source_line_map_path(std::string source_line_map_path);
+	// When set, a binary record of why each shape ended, and of every arc and spline written, is saved to this file.
+	void set_telemetry_path(std::string telemetry_path);
+	// The number of threads used to compress a .zst target.  gzip targets are always compressed on the calling thread.
+	void set_target_compression_threads(int num_threads);
+	// When true, the target is packed with MeatPack so it can be streamed to the printer without packing each line while printing.
+	void set_target_meatpack(bool target_meatpack);
+	// When greater than 0, consecutive arcs on the same circle are joined into arcs of up to this many degrees.
+	void set_max_coalesced_sweep_degrees(double max_sweep_degrees);
+	// When greater than 0, up to this many segments are held back and split into the fewest shapes and segments,
+	// instead of extending each shape as far as it will go.  The window is at least as long as the longest shape.
+	void set_segmentation_lookahead(int num_segments);
+	// When true, arcs are fit in float precision relative to their first point.  See segmented_arc::set_float_fitting.
+	void set_float_fitting(bool float_fitting);
 	virtual ~arc_welder();
 	arc_welder_results process();
+	// Welds num_samples evenly spaced regions of the source without writing the target, and extrapolates the results
+	arc_welder_estimate estimate(int num_samples = DEFAULT_ESTIMATE_NUM_SAMPLES, long sample_size_bytes = DEFAULT_ESTIMATE_SAMPLE_SIZE_BYTES);
+	// Welds gcode one line at a time as it is streamed to the printer, instead of reading the source and writing the target.
+	// At most max_segments lines (the buffer size - 5) are held back while a shape is being fit.
+	void begin_stream();
+	// Welds a line, and appends the lines that are ready to be sent, if any, to output.  Each output line ends with a line ending.
+	void stream_line(const char* line, std::string& output);
+	// Appends the shape being fit and all the lines still held back to output.  The stream continues from the same position.
+	void flush_stream(std::string& output);
+	// Flushes the stream and ends it.
+	void end_stream(std::string& output);
+	bool is_streaming() const;
 	double notification_period_seconds;
 protected:
 	virtual bool on_progress_(const arc_welder_progress& progress);
 private:
-	arc_welder_progress get_progress_(long source_file_position, double start_clock);
+	// source_bytes_read is the decompressed size of the source read so far.  It only differs from source_file_position for compressed sources.
+	arc_welder_progress get_progress_(long source_file_position, long source_bytes_read, double start_clock);
 	void add_arcwelder_comment_to_target();
 	void reset();
 	static gcode_position_args get_args_(bool g90_g91_influences_extruder, int buffer_size);
 	progress_callback progress_callback_;
-	int process_gcode(parsed_command cmd, bool is_end, bool is_reprocess);
-	int write_gcode_to_file(std::string gcode);
-	std::string get_arc_gcode_relative(double f, const std::string comment);
-	std::string get_arc_gcode_absolute(double e, double f, const std::string comment);
-	std::string get_comment_for_arc();
+	int process_gcode(const parsed_command& cmd, bool is_end, bool is_reprocess);
+	// The main loop and the per command processing are specialized at compile time on whether debug logging is enabled
+	// and whether progress is reported, so that disabled logging and progress checks cost nothing per line.
+	template <bool log_debug, bool report_progress>
+	bool process_source_(line_reader& gcode_file, parsed_command_file_reader& parsed_command_reader, parsed_command_file_writer& parsed_command_writer, line_offset_index* p_source_line_index, parsed_command& cmd, clock_t start_clock);
+	template <bool log_debug>
+	int process_gcode_(const parsed_command& cmd, bool is_end, bool is_reprocess);
+	template <bool log_debug>
+	int process_lookahead_gcode_(const parsed_command& cmd, bool is_end, bool is_move, double move_duration_seconds);
+	// True if the move can be part of the shape being fit, or can start a new one
+	bool is_shape_eligible_(const parsed_command& cmd, bool is_end, const position& cur_pos, const position& pre_pos, const extruder& previous_extruder, const extruder& current_extruder) const;
+	// True if there are held back commands that must be written when the source ends
+	bool has_shape_to_finish_();
+	void push_unwritten_command_(array_list<unwritten_command>& commands, const parsed_command& cmd, bool is_move, double move_duration_seconds);
+	// Sets the offsets written for a coalescable arc in relative mode, given the relative position error before it was written
+	void set_coalescable_offset_(coalescable_arc& arc, const vector& error_before) const;
+	// Writes the held back path, keeping the last piece unless is_final is true.  p_next_cmd is the command after the path, if known.
+	void write_lookahead_path_(const parsed_command* p_next_cmd, bool is_final);
+	void add_lookahead_shape_(const segmentation_piece& piece, const parsed_command* p_next_cmd);
+	// Copies the known axis modes and units of the position to the defaults used to start the next estimate sample
+	static void set_estimate_sample_modes_(const position& pos, gcode_position_args& args);
+	static bool is_estimate_sync_command(const parsed_command& cmd, const position& pos);
+	int write_gcode_to_file(const std::string& gcode);
+	std::string get_arc_gcode_relative(segmented_shape& shape, double f, const std::string& comment);
+	std::string get_arc_gcode_absolute(segmented_shape& shape, double e, double f, const std::string& comment);
+	std::string get_comment_for_arc(int num_segments);
+	segmented_shape* get_shape_to_write();
+	arc_telemetry_decision get_ineligible_reason_(const parsed_command& cmd, const position& cur_pos, const position& pre_pos, const extruder& previous_extruder, const extruder& current_extruder) const;
+	static arc_telemetry_decision get_telemetry_decision_(arc_rejection_reason reason);
+	void add_telemetry_record_(arc_telemetry_decision decision, int num_segments, double radius);
+	void update_analysis_(const position& pre_pos, const position& cur_pos, bool is_move);
+	bool is_feedrate_within_tolerance(double f) const;
+	double get_weighted_feedrate(int num_segments);
+	void clear_shapes();
+	void set_shape_tolerances(int feature_type_tag);
 	int write_unwritten_gcodes_to_file();
+	void write_unwritten_command_(unwritten_command& command);
+	// Writes the arc held back for coalescing, if there is one
+	void write_pending_arc_();
 	std::string create_g92_e(double absolute_e);
 	std::string source_path_;
 	std::string target_path_;
+	std::string parsed_command_file_path_;
+	std::string line_offset_index_path_;
+	std::string source_line_map_path_;
+	source_line_map source_line_map_;
+	bool map_source_lines_;
+	std::string telemetry_path_;
+	arc_telemetry telemetry_;
+	bool telemetry_enabled_;
+	arc_welder_analysis analysis_;
 	double resolution_mm_;
+	double max_radius_mm_;
+	double feature_resolution_mm_[NUM_FEATURE_TYPES];
+	double feature_max_radius_mm_[NUM_FEATURE_TYPES];
 	double max_segments_;
 	gcode_position_args gcode_position_args_;
 	long file_size_;
+	// The offset of the start of the source line being processed, or -1 if it is unknown
+	long source_line_offset_;
 	int lines_processed_;
 	int gcodes_processed_;
 	int last_gcode_line_written_;
 	int points_compressed_;
 	int arcs_created_;
+	int splines_created_;
 	source_target_segment_statistics segment_statistics_;
+	command_rate_statistics source_command_rates_;
+	command_rate_statistics target_command_rates_;
+	int target_lines_written_;
+	// The number of bytes written (or that would have been written in a dry run) to the target
+	long target_file_size_;
 	long get_file_size(const std::string& file_path);
 	double get_time_elapsed(double start_clock, double end_clock);
 	double get_next_update_time() const;
 	bool waiting_for_arc_;
 	array_list<unwritten_command> unwritten_commands_;
 	segmented_arc current_arc_;
-	std::ofstream output_file_;
+	segmented_bezier current_bezier_;
+	bool allow_g5_splines_;
+	bool allow_3d_arcs_;
+	// When true, the source is fully processed but nothing is written to the target file
+	bool dry_run_;
+	double feedrate_tolerance_percent_;
+	double arc_min_feedrate_;
+	double arc_max_feedrate_;
+	bool arc_fitting_;
+	bool bezier_fitting_;
+	// Writes the target, compressing it if the target path ends with .gz or .zst
+	output_encoder* p_output_file_;
+	// The target while streaming, which is owned by p_output_file_
+	string_output_encoder* p_stream_output_;
+	parsed_command stream_command_;
+	int target_compression_threads_;
+	bool target_meatpack_;
+	// The last arc written is held back until the next command is known, so that it can be joined with the next arc
+	arc_coalescer arc_coalescer_;
+	unwritten_command pending_arc_;
+	bool has_pending_arc_;
+	int pending_arc_merges_;
+	int arcs_coalesced_;
+	// The path held back while looking ahead, and the commands that move to each point after the first
+	int segmentation_lookahead_;
+	segmentation_optimizer segmentation_optimizer_;
+	array_list<point> lookahead_points_;
+	array_list<unwritten_command> lookahead_commands_;
+	std::vector<segmentation_piece> lookahead_pieces_;
 
 	// We don't care about the printer settings, except for g91 influences extruder.
 	gcode_position* p_source_position_;
 	double previous_feedrate_;
+	// The feedrate of the last shape when the feedrate wasn't restored after it because the next command sets its own,
+	// else -1.  The printer stays at this feedrate if the next command starts another shape.
+	double unrestored_feedrate_;
 	bool previous_is_extruder_relative_;
+	// The source position minus the target position in relative mode (G91), from truncating the offsets of the shapes written
+	vector relative_position_error_;
 	gcode_parser parser_;
 	bool verbose_output_;
 	int logger_type_;
@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "command_rate_statistics.h"
+#include "utilities.h"
+#include "segmented_shape.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+command_rate_statistics::command_rate_statistics(double window_seconds, double rate_limit)
+{
+	window_seconds_ = window_seconds > 0 ? window_seconds : DEFAULT_COMMAND_RATE_WINDOW_SECONDS;
+	bucket_seconds_ = window_seconds_ / COMMAND_RATE_WINDOW_STEPS;
+	rate_limit_ = rate_limit > 0 ? rate_limit : 0;
+	clear();
+}
+
+void command_rate_statistics::clear()
+{
+	current_seconds_ = 0;
+	total_commands_ = 0;
+	bucket_counts_.clear();
+	bucket_first_lines_.clear();
+	bucket_last_lines_.clear();
+	summary_ = command_rate_summary();
+	summary_.window_seconds = window_seconds_;
+	summary_.rate_limit = rate_limit_;
+}
+
+void command_rate_statistics::add_command(double duration_seconds, int line_number)
+{
+	// The command is counted in the bucket where it starts
+	unsigned int bucket_index = static_cast<unsigned int>(current_seconds_ / bucket_seconds_);
+	while (bucket_counts_.size() <= bucket_index)
+	{
+		bucket_counts_.push_back(0);
+		bucket_first_lines_.push_back(line_number);
+		bucket_last_lines_.push_back(line_number);
+	}
+	if (bucket_counts_[bucket_index] == 0)
+	{
+		bucket_first_lines_[bucket_index] = line_number;
+	}
+	bucket_counts_[bucket_index]++;
+	bucket_last_lines_[bucket_index] = line_number;
+	total_commands_++;
+	if (duration_seconds > 0)
+	{
+		current_seconds_ += duration_seconds;
+	}
+}
+
+void command_rate_statistics::update_summary()
+{
+	summary_ = command_rate_summary();
+	summary_.window_seconds = window_seconds_;
+	summary_.rate_limit = rate_limit_;
+	summary_.total_seconds = current_seconds_;
+	summary_.total_commands = total_commands_;
+	if (bucket_counts_.size() == 0)
+	{
+		return;
+	}
+
+	// Slide the window one bucket at a time.  If the whole file fits in a single window, use a single partial window.
+	int num_buckets = static_cast<int>(bucket_counts_.size());
+	int num_windows = num_buckets - COMMAND_RATE_WINDOW_STEPS + 1;
+	int buckets_per_window = COMMAND_RATE_WINDOW_STEPS;
+	if (num_windows < 1)
+	{
+		num_windows = 1;
+		buckets_per_window = num_buckets;
+	}
+	std::vector<double> rates(num_windows);
+	int window_count = 0;
+	for (int index = 0; index < buckets_per_window; index++)
+	{
+		window_count += bucket_counts_[index];
+	}
+	command_rate_region current_region;
+	bool in_region = false;
+	for (int window_index = 0; window_index < num_windows; window_index++)
+	{
+		if (window_index > 0)
+		{
+			window_count += bucket_counts_[window_index + buckets_per_window - 1] - bucket_counts_[window_index - 1];
+		}
+		double rate = window_count / window_seconds_;
+		rates[window_index] = rate;
+
+		if (rate_limit_ > 0 && rate > rate_limit_)
+		{
+			int last_bucket = window_index + buckets_per_window - 1;
+			if (!in_region)
+			{
+				in_region = true;
+				current_region = command_rate_region();
+				current_region.start_seconds = window_index * bucket_seconds_;
+				current_region.start_line = bucket_first_lines_[window_index];
+			}
+			current_region.end_seconds = (last_bucket + 1) * bucket_seconds_;
+			current_region.end_line = bucket_last_lines_[last_bucket];
+			if (rate > current_region.max_rate)
+			{
+				current_region.max_rate = rate;
+			}
+		}
+		else if (in_region)
+		{
+			in_region = false;
+			summary_.num_regions_over_limit++;
+			if (summary_.regions_over_limit.size() < MAX_COMMAND_RATE_REGIONS)
+			{
+				summary_.regions_over_limit.push_back(current_region);
+			}
+		}
+	}
+	if (in_region)
+	{
+		summary_.num_regions_over_limit++;
+		if (summary_.regions_over_limit.size() < MAX_COMMAND_RATE_REGIONS)
+		{
+			summary_.regions_over_limit.push_back(current_region);
+		}
+	}
+
+	// Get the percentiles.  nth_element is enough, we don't need a full sort.
+	int p50_index = static_cast<int>((num_windows - 1) * 0.50);
+	int p99_index = static_cast<int>((num_windows - 1) * 0.99);
+	std::nth_element(rates.begin(), rates.begin() + p99_index, rates.end());
+	summary_.percentile_99 = rates[p99_index];
+	summary_.max_rate = *std::max_element(rates.begin() + p99_index, rates.end());
+	std::nth_element(rates.begin(), rates.begin() + p50_index, rates.begin() + p99_index);
+	summary_.percentile_50 = p50_index == p99_index ? summary_.percentile_99 : rates[p50_index];
+}
+
+const command_rate_summary& command_rate_statistics::get_summary() const
+{
+	return summary_;
+}
+
+double command_rate_statistics::get_move_duration(const position& previous, const position& current)
+{
+	// Feedrates are in mm/min.  G2/G3 with I/J are timed by their arc length, others by their chord.
+	if (current.f_null || current.f <= 0)
+	{
+		return 0;
+	}
+	double distance = get_arc_length(previous, current);
+	if (distance < 0)
+	{
+		distance = utilities::get_cartesian_distance(previous.x, previous.y, previous.z, current.x, current.y, current.z);
+	}
+	if (utilities::is_zero(distance))
+	{
+		// Extruder only moves, like retractions, are timed by the extruder distance
+		distance = std::abs(current.get_current_extruder().e_relative);
+	}
+	return distance / (current.f / 60.0);
+}
+
+double command_rate_statistics::get_arc_length(const position& previous, const position& current)
+{
+	const bool is_clockwise = current.command.command == "G2";
+	if (!is_clockwise && current.command.command != "G3")
+	{
+		return -1;
+	}
+	double i = 0, j = 0;
+	bool has_offset = false;
+	for (unsigned int index = 0; index < current.command.parameters.size(); index++)
+	{
+		const parsed_command_parameter& param = current.command.parameters[index];
+		if (param.name == "I")
+		{
+			i = param.double_value;
+			has_offset = true;
+		}
+		else if (param.name == "J")
+		{
+			j = param.double_value;
+			has_offset = true;
+		}
+	}
+	if (!has_offset)
+	{
+		// R form arcs are timed by their chord
+		return -1;
+	}
+	// The vectors from the center to the start and end points
+	const double start_x = -i;
+	const double start_y = -j;
+	const double end_x = current.x - (previous.x + i);
+	const double end_y = current.y - (previous.y + j);
+	const double radius = std::sqrt(start_x * start_x + start_y * start_y);
+	// The counter-clockwise angle from the start to the end vector
+	double angle = std::atan2(start_x * end_y - start_y * end_x, start_x * end_x + start_y * end_y);
+	if (is_clockwise)
+	{
+		angle = -angle;
+	}
+	// A matching start and end point is a full circle
+	if (angle <= 0)
+	{
+		angle += 2.0 * PI_DOUBLE;
+	}
+	const double planar_length = radius * angle;
+	const double z_change = current.z - previous.z;
+	return std::sqrt(planar_length * planar_length + z_change * z_change);
+}
+
+bool command_rate_statistics::is_move_command(const std::string& command)
+{
+	return command == "G0" || command == "G1" || command == "G2" || command == "G3" || command == "G5";
+}
+
+std::string command_rate_summary::str() const
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(1);
+	stream << "Commands: " << total_commands << ", Estimated Move Time: " << utilities::to_string(total_seconds) << "s";
+	stream << ", Commands Per Second (" << window_seconds << "s window) - p50: " << percentile_50 << ", p99: " << percentile_99 << ", max: " << max_rate;
+	if (rate_limit > 0)
+	{
+		stream << ", Regions over " << rate_limit << "/s: " << num_regions_over_limit;
+		for (unsigned int index = 0; index < regions_over_limit.size(); index++)
+		{
+			const command_rate_region& region = regions_over_limit[index];
+			stream << "\n\tLines " << region.start_line << "-" << region.end_line << " (" << region.start_seconds << "s-" << region.end_seconds << "s), max " << region.max_rate << "/s";
+		}
+		if (num_regions_over_limit > static_cast<int>(regions_over_limit.size()))
+		{
+			stream << "\n\t" << num_regions_over_limit - regions_over_limit.size() << " more regions not shown.";
+		}
+	}
+	return stream.str();
+}
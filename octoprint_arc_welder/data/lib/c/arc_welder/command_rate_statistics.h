@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <vector>
+#include "position.h"
+
+// The width of the sliding window used to calculate commands per second
+#define DEFAULT_COMMAND_RATE_WINDOW_SECONDS 1.0
+// The number of steps the window slides through per window width
+#define COMMAND_RATE_WINDOW_STEPS 4
+// A limit of 0 disables flagging of regions that exceed the limit
+#define DEFAULT_COMMAND_RATE_LIMIT 0.0
+// The maximum number of flagged regions to keep.  All regions are counted.
+#define MAX_COMMAND_RATE_REGIONS 100
+
+// A range of the file where the command rate exceeded the limit
+struct command_rate_region {
+	command_rate_region()
+	{
+		start_seconds = 0;
+		end_seconds = 0;
+		start_line = 0;
+		end_line = 0;
+		max_rate = 0;
+	}
+	double start_seconds;
+	double end_seconds;
+	int start_line;
+	int end_line;
+	double max_rate;
+};
+
+// The results of the command rate analysis, small enough to copy with every progress update
+struct command_rate_summary {
+	command_rate_summary()
+	{
+		window_seconds = DEFAULT_COMMAND_RATE_WINDOW_SECONDS;
+		rate_limit = DEFAULT_COMMAND_RATE_LIMIT;
+		total_seconds = 0;
+		total_commands = 0;
+		percentile_50 = 0;
+		percentile_99 = 0;
+		max_rate = 0;
+		num_regions_over_limit = 0;
+	}
+	double window_seconds;
+	double rate_limit;
+	double total_seconds;
+	int total_commands;
+	double percentile_50;
+	double percentile_99;
+	double max_rate;
+	int num_regions_over_limit;
+	std::vector<command_rate_region> regions_over_limit;
+	std::string str() const;
+};
+
+// Estimates the number of movement commands per second the printer must plan by
+// timing each move with its feedrate, and counting the moves within a sliding window.
+// Acceleration is ignored, so the rates are an upper bound.
+class command_rate_statistics
+{
+public:
+	command_rate_statistics(double window_seconds = DEFAULT_COMMAND_RATE_WINDOW_SECONDS, double rate_limit = DEFAULT_COMMAND_RATE_LIMIT);
+	void clear();
+	void add_command(double duration_seconds, int line_number);
+	// Calculate the summary from the commands added so far.  This is expensive, call it once at the end.
+	void update_summary();
+	const command_rate_summary& get_summary() const;
+	static double get_move_duration(const position& previous, const position& current);
+	// The length of a G2/G3 arc with I/J offsets, including any z change.  Returns -1 for other commands.
+	static double get_arc_length(const position& previous, const position& current);
+	static bool is_move_command(const std::string& command);
+private:
+	double window_seconds_;
+	double bucket_seconds_;
+	double rate_limit_;
+	double current_seconds_;
+	int total_commands_;
+	std::vector<int> bucket_counts_;
+	std::vector<int> bucket_first_lines_;
+	std::vector<int> bucket_last_lines_;
+	command_rate_summary summary_;
+};
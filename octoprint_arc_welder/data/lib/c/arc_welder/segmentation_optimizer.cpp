@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "segmentation_optimizer.h"
+#include <climits>
+
+segmentation_optimizer::segmentation_optimizer(int max_segments, double resolution_mm, double max_radius_mm, bool allow_3d_arcs, bool allow_g5_splines) :
+	arc_(DEFAULT_MIN_SEGMENTS, max_segments, resolution_mm, max_radius_mm, allow_3d_arcs),
+	bezier_(DEFAULT_MIN_BEZIER_SEGMENTS, max_segments, resolution_mm)
+{
+	allow_g5_splines_ = allow_g5_splines;
+}
+
+segmentation_optimizer::segmentation_optimizer(const segmentation_optimizer&) : arc_(DEFAULT_MIN_SEGMENTS)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+segmentation_optimizer::~segmentation_optimizer()
+{
+}
+
+void segmentation_optimizer::set_resolution_mm(double resolution_mm)
+{
+	arc_.set_resolution_mm(resolution_mm);
+	bezier_.set_resolution_mm(resolution_mm);
+}
+
+void segmentation_optimizer::set_max_radius(double max_radius_mm)
+{
+	arc_.set_max_radius(max_radius_mm);
+}
+
+void segmentation_optimizer::set_float_fitting(bool float_fitting)
+{
+	arc_.set_float_fitting(float_fitting);
+}
+
+void segmentation_optimizer::set_is_xyz_relative(bool value)
+{
+	arc_.set_is_xyz_relative(value);
+	bezier_.set_is_xyz_relative(value);
+}
+
+void segmentation_optimizer::optimize(const array_list<point>& points, std::vector<segmentation_piece>& pieces)
+{
+	pieces.clear();
+	const int num_points = points.count();
+	if (num_points < 2)
+	{
+		return;
+	}
+	costs_.assign(num_points, INT_MAX);
+	best_pieces_.resize(num_points);
+	costs_[0] = 0;
+	for (int index = 0; index < num_points - 1; index++)
+	{
+		// The cost of every point before this one is final, since pieces only go forward.  The next point can always
+		// be reached by writing the original segment.  Ties go to the piece that starts last, so that the earlier
+		// pieces are as long as possible, like the shapes found without lookahead.
+		if (costs_[index] + 1 <= costs_[index + 1])
+		{
+			costs_[index + 1] = costs_[index] + 1;
+			best_pieces_[index + 1] = segmentation_piece(index, index + 1, segmentation_piece_segment);
+		}
+		try_shapes_from_(points, index, arc_, segmentation_piece_arc);
+		if (allow_g5_splines_)
+		{
+			try_shapes_from_(points, index, bezier_, segmentation_piece_spline);
+		}
+	}
+	// Walk back from the last point to find the pieces
+	int index = num_points - 1;
+	while (index > 0)
+	{
+		pieces.push_back(best_pieces_[index]);
+		index = best_pieces_[index].start_index;
+	}
+	for (unsigned int left = 0, right = static_cast<unsigned int>(pieces.size()) - 1; left < right; left++, right--)
+	{
+		segmentation_piece temp = pieces[left];
+		pieces[left] = pieces[right];
+		pieces[right] = temp;
+	}
+}
+
+void segmentation_optimizer::try_shapes_from_(const array_list<point>& points, int start_index, segmented_shape& shape, segmentation_piece_type type)
+{
+	shape.clear();
+	// Don't add any extrusion for the start point, it belongs to the previous piece
+	shape.try_add_point(points[start_index], 0);
+	const int cost = costs_[start_index] + 1;
+	for (int index = start_index + 1; index < points.count(); index++)
+	{
+		const point& p = points[index];
+		// The shape drops its start point when the first few points don't fit, and can't be used for this piece after that
+		if (!shape.try_add_point(p, p.e_relative) || shape.get_num_segments() != index - start_index + 1)
+		{
+			return;
+		}
+		// Prefer arcs over splines that start at the same point, since arcs are tried first
+		if (
+			shape.is_shape() && shape.get_num_segments() >= shape.get_min_segments() &&
+			(cost < costs_[index] || (cost == costs_[index] && best_pieces_[index].start_index < start_index))
+		)
+		{
+			costs_[index] = cost;
+			best_pieces_[index] = segmentation_piece(start_index, index, type);
+		}
+	}
+}
+
+segmented_shape* segmentation_optimizer::get_shape(const array_list<point>& points, const segmentation_piece& piece)
+{
+	segmented_shape* p_shape = NULL;
+	if (piece.type == segmentation_piece_arc)
+	{
+		p_shape = &arc_;
+	}
+	else if (piece.type == segmentation_piece_spline)
+	{
+		p_shape = &bezier_;
+	}
+	if (p_shape == NULL || !try_fill_shape_(points, piece.start_index, piece.end_index, *p_shape))
+	{
+		return NULL;
+	}
+	return p_shape;
+}
+
+bool segmentation_optimizer::try_fill_shape_(const array_list<point>& points, int start_index, int end_index, segmented_shape& shape)
+{
+	// The points are added in the same order as when the piece was found, so the shape is fit the same way
+	shape.clear();
+	shape.try_add_point(points[start_index], 0);
+	for (int index = start_index + 1; index <= end_index; index++)
+	{
+		const point& p = points[index];
+		if (!shape.try_add_point(p, p.e_relative))
+		{
+			return false;
+		}
+	}
+	return shape.is_shape() && shape.get_num_segments() == end_index - start_index + 1;
+}
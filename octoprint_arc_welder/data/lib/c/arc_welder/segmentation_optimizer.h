@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <vector>
+#include "segmented_arc.h"
+#include "segmented_bezier.h"
+#include "array_list.h"
+
+// Lookahead is disabled unless a window is set
+#define DEFAULT_SEGMENTATION_LOOKAHEAD 0
+
+enum segmentation_piece_type
+{
+	segmentation_piece_segment,
+	segmentation_piece_arc,
+	segmentation_piece_spline
+};
+
+// Part of a path, from start_index to end_index in the list of points, that is written as one command (a shape),
+// or as the original segment.
+struct segmentation_piece
+{
+	segmentation_piece() {
+		start_index = 0;
+		end_index = 0;
+		type = segmentation_piece_segment;
+	}
+	segmentation_piece(int start, int end, segmentation_piece_type piece_type) {
+		start_index = start;
+		end_index = end;
+		type = piece_type;
+	}
+	int start_index;
+	int end_index;
+	segmentation_piece_type type;
+};
+
+// Splits a path into the fewest commands, instead of greedily extending each shape as far as it will go.  Every
+// shape that can start at each point is tried, and the cheapest way to reach each point is found with dynamic programming.
+class segmentation_optimizer
+{
+public:
+	segmentation_optimizer(int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM, double max_radius_mm = DEFAULT_MAX_RADIUS_MM, bool allow_3d_arcs = DEFAULT_ALLOW_3D_ARCS, bool allow_g5_splines = false);
+	virtual ~segmentation_optimizer();
+	void set_resolution_mm(double resolution_mm);
+	void set_max_radius(double max_radius_mm);
+	void set_is_xyz_relative(bool value);
+	void set_float_fitting(bool float_fitting);
+	// Fills pieces, in order, with the commands that replace the segments between the points
+	void optimize(const array_list<point>& points, std::vector<segmentation_piece>& pieces);
+	// Fits the shape for a piece found by optimize.  Returns NULL for segments.
+	segmented_shape* get_shape(const array_list<point>& points, const segmentation_piece& piece);
+private:
+	segmentation_optimizer(const segmentation_optimizer& source);
+	// Adds the points after start_index until the shape can't be extended, updating the cost of each point it reaches
+	void try_shapes_from_(const array_list<point>& points, int start_index, segmented_shape& shape, segmentation_piece_type type);
+	bool try_fill_shape_(const array_list<point>& points, int start_index, int end_index, segmented_shape& shape);
+	segmented_arc arc_;
+	segmented_bezier bezier_;
+	bool allow_g5_splines_;
+	// The fewest commands needed to reach each point, and the piece that reaches it
+	std::vector<int> costs_;
+	std::vector<segmentation_piece> best_pieces_;
+};
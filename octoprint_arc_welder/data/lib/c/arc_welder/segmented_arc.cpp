@@ -30,16 +30,29 @@
 #include <iomanip>
 #include <stdio.h>
 #include <cmath>
+#include <limits>
 
 segmented_arc::segmented_arc() : segmented_shape(DEFAULT_MIN_SEGMENTS, DEFAULT_MAX_SEGMENTS, DEFAULT_RESOLUTION_MM)
 {
 	max_radius_mm_ = DEFAULT_MAX_RADIUS_MM;
+	allow_3d_arcs_ = DEFAULT_ALLOW_3D_ARCS;
+	float_fitting_ = DEFAULT_FLOAT_FITTING;
+	relative_origin_x_ = 0;
+	relative_origin_y_ = 0;
+	last_rejection_ = arc_rejection_none;
+	last_rejection_radius_ = 0;
 }
 
-segmented_arc::segmented_arc(int min_segments, int max_segments, double resolution_mm, double max_radius_mm) : segmented_shape(min_segments, max_segments, resolution_mm)
+segmented_arc::segmented_arc(int min_segments, int max_segments, double resolution_mm, double max_radius_mm, bool allow_3d_arcs) : segmented_shape(min_segments, max_segments, resolution_mm)
 {
 	if (max_radius_mm > DEFAULT_MAX_RADIUS_MM) max_radius_mm_ = DEFAULT_MAX_RADIUS_MM;
 	else max_radius_mm_ = max_radius_mm;
+	allow_3d_arcs_ = allow_3d_arcs;
+	float_fitting_ = DEFAULT_FLOAT_FITTING;
+	relative_origin_x_ = 0;
+	relative_origin_y_ = 0;
+	last_rejection_ = arc_rejection_none;
+	last_rejection_radius_ = 0;
 }
 
 segmented_arc::~segmented_arc()
@@ -68,6 +81,37 @@ double segmented_arc::get_max_radius() const
 {
 	return max_radius_mm_;
 }
+void segmented_arc::set_max_radius(double max_radius_mm)
+{
+	if (max_radius_mm > DEFAULT_MAX_RADIUS_MM) max_radius_mm_ = DEFAULT_MAX_RADIUS_MM;
+	else max_radius_mm_ = max_radius_mm;
+}
+bool segmented_arc::get_allow_3d_arcs() const
+{
+	return allow_3d_arcs_;
+}
+bool segmented_arc::get_float_fitting() const
+{
+	return float_fitting_;
+}
+void segmented_arc::set_float_fitting(bool float_fitting)
+{
+	float_fitting_ = float_fitting;
+	relative_x_.clear();
+	relative_y_.clear();
+}
+double segmented_arc::get_radius() const
+{
+	return arc_circle_.radius;
+}
+arc_rejection_reason segmented_arc::get_last_rejection() const
+{
+	return last_rejection_;
+}
+double segmented_arc::get_last_rejection_radius() const
+{
+	return last_rejection_radius_;
+}
 bool segmented_arc::is_shape() const
 {
 /*
@@ -87,6 +131,7 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	if (points_.count() > get_max_segments() - 1)
 	{
 		// Too many points, we can't add more
+		last_rejection_ = arc_rejection_max_segments;
 		return false;
 	}
 	double distance = 0;
@@ -94,11 +139,11 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	{
 		point p1 = points_[points_.count() - 1];
 		distance = utilities::get_cartesian_distance(p1.x, p1.y, p.x, p.y);
-		if (!utilities::is_equal(p1.z, p.z))
+		if (!allow_3d_arcs_ && !utilities::is_equal(p1.z, p.z))
 		{
-			// Arcs require that z is equal for all points
+			// Arcs require that z is equal for all points, unless we are creating helical arcs
 			//std::cout << " failed - z change.\n";
-
+			last_rejection_ = arc_rejection_z_changed;
 			return false;
 		}
 
@@ -107,6 +152,7 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 			// there must be some distance between the points
 			// to make an arc.
 			//std::cout << " failed - no distance change.\n";
+			last_rejection_ = arc_rejection_no_distance;
 			return false;
 		}
 		
@@ -120,8 +166,9 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 		if (points_.count() == get_min_segments())
 		{
 			arc a;
-			if (!arc::try_create_arc(arc_circle_, points_, original_shape_length_, resolution_mm_, a))
+			if (!arc::try_create_arc(arc_circle_, points_, original_shape_length_, resolution_mm_, a) || !does_z_fit_points_())
 			{
+				last_rejection_ = arc_rejection_no_fit;
 				point_added = false;
 				points_.pop_back();
 				original_shape_length_ -= distance;
@@ -137,7 +184,7 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	}
 	if (point_added)
 	{
-		
+		last_rejection_ = arc_rejection_none;
 		if (points_.count() > 1)
 		{
 			// Only add the relative distance to the second point on up.
@@ -173,7 +220,7 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 	bool circle_created;
 	// Find a point in the middle of our list for p2
 	int mid_point_index = ((points_.count() - 2) / 2)+1;
-	circle_created = circle::try_create_circle(points_[0], points_[mid_point_index], p, max_radius_mm_, test_circle);
+	circle_created = try_create_circle_(points_[mid_point_index], p, max_radius_mm_, test_circle);
 	
 	if (circle_created)
 	{
@@ -186,13 +233,22 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 		double previous_shape_length = original_shape_length_;
 		original_shape_length_ += pd;
 		
-		circle_fits_points = does_circle_fit_points_(test_circle);
+		if (float_fitting_ && test_circle.radius <= resolution_mm_ * FLOAT_FITTING_MAX_RADIUS_RESOLUTION_RATIO)
+		{
+			update_relative_points_();
+			circle_fits_points = does_circle_fit_relative_points_(test_circle);
+		}
+		else
+		{
+			circle_fits_points = does_circle_fit_points_(test_circle);
+		}
 		if (circle_fits_points)
 		{
 			arc_circle_ = test_circle;
 		}
 		else
 		{
+			last_rejection_ = arc_rejection_no_fit;
 			points_.pop_back();
 			original_shape_length_ = previous_shape_length;
 		}
@@ -205,27 +261,50 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 	}
 	
 	//std::cout << " failed - could not create a circle from the points.\n";
+	// The points are either colinear, or the circle is too large.  Only find out which when the circle fails.
+	if (try_create_circle_(points_[mid_point_index], p, std::numeric_limits<double>::max(), test_circle))
+	{
+		last_rejection_ = arc_rejection_radius_exceeded;
+		last_rejection_radius_ = test_circle.radius;
+	}
+	else
+	{
+		last_rejection_ = arc_rejection_no_fit;
+	}
 	return false;
 	
 }
 
+bool segmented_arc::try_create_circle_(const point& mid_point, const point& end_point, double max_radius, circle& c) const
+{
+	// Float fitting checks the points relative to the first point, so create the circle the same way.
+	if (float_fitting_)
+		return circle::try_create_circle_relative(points_[0], mid_point, end_point, max_radius, c);
+	return circle::try_create_circle(points_[0], mid_point, end_point, max_radius, c);
+}
+
 bool segmented_arc::does_circle_fit_points_(circle& c) const
 {
 	// We know point 1 must fit (we used it to create the circle).  Check the other points
 	// Note:  We have not added the current point, but that's fine since it is guaranteed to fit too.
 	// If this works, it will be added.
 
-	double distance_from_center;
-	double difference_from_radius;
+	// A point fits when its distance from the center is within the resolution of the radius.  Compare the squared
+	// distances against the squared bounds so no square root is needed for each point.
+	double max_distance_from_center = c.radius + resolution_mm_ + CIRCLE_FIT_TOLERANCE_MM;
+	double min_distance_from_center = c.radius - resolution_mm_ - CIRCLE_FIT_TOLERANCE_MM;
+	double max_distance_sq = max_distance_from_center * max_distance_from_center;
+	// Every point is far enough from the center when the resolution is larger than the radius.
+	double min_distance_sq = min_distance_from_center > 0 ? min_distance_from_center * min_distance_from_center : -1.0;
+	double distance_sq;
 	
 	// Check the endpoints to make sure they fit the current circle
 	for (int index = 1; index < points_.count(); index++)
 	{
 		// Make sure the length from the center of our circle to the test point is 
 		// at or below our max distance.
-		distance_from_center = utilities::get_cartesian_distance(points_[index].x, points_[index].y, c.center.x, c.center.y);
-		double difference_from_radius = std::abs(distance_from_center - c.radius);
-		if (utilities::greater_than(difference_from_radius, resolution_mm_))
+		distance_sq = utilities::get_cartesian_distance_sq(points_[index].x, points_[index].y, c.center.x, c.center.y);
+		if (distance_sq >= max_distance_sq || distance_sq <= min_distance_sq)
 		{
 			//std::cout << " failed - end points do not lie on circle.\n";
 			return false;
@@ -238,10 +317,8 @@ bool segmented_arc::does_circle_fit_points_(circle& c) const
 		point point_to_test;
 		if (segment::get_closest_perpendicular_point(points_[index], points_[index + 1], c.center, point_to_test))
 		{
-			distance_from_center = utilities::get_cartesian_distance(point_to_test.x, point_to_test.y, c.center.x, c.center.y);
-			difference_from_radius = std::abs(distance_from_center - c.radius);
-			// Test allowing more play for the midpoints.
-			if (utilities::greater_than(difference_from_radius, resolution_mm_))
+			distance_sq = utilities::get_cartesian_distance_sq(point_to_test.x, point_to_test.y, c.center.x, c.center.y);
+			if (distance_sq >= max_distance_sq || distance_sq <= min_distance_sq)
 			{
 				return false;
 			}
@@ -249,12 +326,156 @@ bool segmented_arc::does_circle_fit_points_(circle& c) const
 		
 	}
 	
+	// Make sure any z change is linear along the path, else this is not a helix
+	if (!does_z_fit_points_())
+	{
+		return false;
+	}
+
 	// get the current arc and compare the total length to the original length
 	arc a;
 	return arc::try_create_arc(c, points_, original_shape_length_, resolution_mm_, a);
 	
 }
 
+void segmented_arc::update_relative_points_()
+{
+	int count = points_.count();
+	if (count == 0)
+	{
+		relative_x_.clear();
+		relative_y_.clear();
+		return;
+	}
+	// The relative points are only valid while the first point is the same
+	if (relative_x_.empty() || points_[0].x != relative_origin_x_ || points_[0].y != relative_origin_y_)
+	{
+		relative_x_.clear();
+		relative_y_.clear();
+		relative_origin_x_ = points_[0].x;
+		relative_origin_y_ = points_[0].y;
+	}
+	// Points may have been removed from the end, and others added in their place, since the last update.
+	if (static_cast<int>(relative_x_.size()) > count)
+	{
+		relative_x_.resize(count);
+		relative_y_.resize(count);
+	}
+	while (!relative_x_.empty())
+	{
+		int last_index = static_cast<int>(relative_x_.size()) - 1;
+		if (relative_x_[last_index] == static_cast<float>(points_[last_index].x - relative_origin_x_)
+			&& relative_y_[last_index] == static_cast<float>(points_[last_index].y - relative_origin_y_))
+		{
+			break;
+		}
+		relative_x_.pop_back();
+		relative_y_.pop_back();
+	}
+	for (int index = static_cast<int>(relative_x_.size()); index < count; index++)
+	{
+		relative_x_.push_back(static_cast<float>(points_[index].x - relative_origin_x_));
+		relative_y_.push_back(static_cast<float>(points_[index].y - relative_origin_y_));
+	}
+}
+
+bool segmented_arc::does_circle_fit_relative_points_(const circle& c) const
+{
+	// The same checks as does_circle_fit_points_, but in float precision relative to the first point.
+	// The loops don't branch so the compiler can vectorize them.
+	int count = static_cast<int>(relative_x_.size());
+	const float* x = &relative_x_[0];
+	const float* y = &relative_y_[0];
+	float center_x = static_cast<float>(c.center.x - relative_origin_x_);
+	float center_y = static_cast<float>(c.center.y - relative_origin_y_);
+	double max_distance_from_center = c.radius + resolution_mm_ + CIRCLE_FIT_TOLERANCE_MM;
+	double min_distance_from_center = c.radius - resolution_mm_ - CIRCLE_FIT_TOLERANCE_MM;
+	float max_distance_sq = static_cast<float>(max_distance_from_center * max_distance_from_center);
+	float min_distance_sq = min_distance_from_center > 0 ? static_cast<float>(min_distance_from_center * min_distance_from_center) : -1.0f;
+	const float min_t = static_cast<float>(CIRCLE_GENERATION_A_ZERO_TOLERANCE);
+	const float max_t = 1.0f - min_t;
+
+	// Check the endpoints to make sure they fit the current circle
+	bool points_fit = true;
+	for (int index = 1; index < count; index++)
+	{
+		float x_difference = x[index] - center_x;
+		float y_difference = y[index] - center_y;
+		float distance_sq = x_difference * x_difference + y_difference * y_difference;
+		points_fit &= distance_sq < max_distance_sq && distance_sq > min_distance_sq;
+	}
+	if (!points_fit)
+	{
+		return false;
+	}
+
+	// Check the point perpendicular from the segment to the circle's center, if any such point exists
+	for (int index = 0; index < count - 1; index++)
+	{
+		float segment_x = x[index + 1] - x[index];
+		float segment_y = y[index + 1] - y[index];
+		float t = ((center_x - x[index]) * segment_x + (center_y - y[index]) * segment_y) / (segment_x * segment_x + segment_y * segment_y);
+		float x_difference = x[index] + t * segment_x - center_x;
+		float y_difference = y[index] + t * segment_y - center_y;
+		float distance_sq = x_difference * x_difference + y_difference * y_difference;
+		bool has_perpendicular_point = t >= min_t && t <= max_t;
+		points_fit &= !has_perpendicular_point || (distance_sq < max_distance_sq && distance_sq > min_distance_sq);
+	}
+	if (!points_fit)
+	{
+		return false;
+	}
+
+	// Make sure any z change is linear along the path, else this is not a helix
+	if (!does_z_fit_points_())
+	{
+		return false;
+	}
+
+	// get the current arc and compare the total length to the original length
+	arc a;
+	return arc::try_create_arc(c, points_, original_shape_length_, resolution_mm_, a);
+}
+
+bool segmented_arc::does_z_fit_points_() const
+{
+	// Without 3d arcs every point has the same z, which we check while adding points.
+	if (!allow_3d_arcs_ || points_.count() < 2)
+	{
+		return true;
+	}
+	// A helical arc moves z at a constant rate along the length of the arc, so each
+	// point's z must match the z interpolated by the xy distance traveled so far.
+	double start_z = points_[0].z;
+	double z_change = points_[points_.count() - 1].z - start_z;
+	if (utilities::is_zero(z_change))
+	{
+		for (int index = 1; index < points_.count(); index++)
+		{
+			if (!utilities::is_equal(points_[index].z, start_z))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	if (utilities::is_zero(original_shape_length_))
+	{
+		return false;
+	}
+	double distance = 0;
+	for (int index = 1; index < points_.count(); index++)
+	{
+		distance += utilities::get_cartesian_distance(points_[index - 1].x, points_[index - 1].y, points_[index].x, points_[index].y);
+		double interpolated_z = start_z + z_change * (distance / original_shape_length_);
+		if (utilities::greater_than(std::abs(points_[index].z - interpolated_z), resolution_mm_))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 bool segmented_arc::try_get_arc(arc & target_arc)																								 
 {
 	//int mid_point_index = ((points_.count() - 2) / 2) + 1;
@@ -269,18 +490,18 @@ bool segmented_arc::try_get_arc_(const circle& c, arc &target_arc)
 	return arc::try_create_arc(c, points_, original_shape_length_, resolution_mm_, target_arc);
 }
 
-std::string segmented_arc::get_shape_gcode_absolute(double e, double f)
+std::string segmented_arc::get_shape_gcode_absolute(double e, double f, vector& relative_position_error)
 {
 	bool has_e = e_relative_ != 0;
-	return get_shape_gcode_(has_e, e, f);
+	return get_shape_gcode_(has_e, e, f, relative_position_error);
 }
-std::string segmented_arc::get_shape_gcode_relative(double f)
+std::string segmented_arc::get_shape_gcode_relative(double f, vector& relative_position_error)
 {
 	bool has_e = e_relative_ != 0;
-	return get_shape_gcode_(has_e, e_relative_, f);
+	return get_shape_gcode_(has_e, e_relative_, f, relative_position_error);
 }
 
-std::string segmented_arc::get_shape_gcode_(bool has_e, double e, double f) const
+std::string segmented_arc::get_shape_gcode_(bool has_e, double e, double f, vector& relative_position_error) const
 {
 	
 	char buf[20];
@@ -303,12 +524,42 @@ std::string segmented_arc::get_shape_gcode_(bool has_e, double e, double f) cons
 		gcode = "G3";
 	
 	}
+	// In relative mode (G91) the endpoint is an offset from the start point.  I and J are always relative.
+	const bool has_z = allow_3d_arcs_ && !utilities::is_equal(c.start_point.z, c.end_point.z);
 	// Add X, Y, I and J
 	gcode += " X";
-	gcode += utilities::to_string(c.end_point.x, 3, buf);
+	if (is_xyz_relative_)
+	{
+		append_relative_offset_(gcode, c.end_point.x - c.start_point.x, relative_position_error.x, buf);
+	}
+	else
+	{
+		gcode += utilities::to_string(c.end_point.x, 3, buf);
+	}
 
 	gcode += " Y";
-	gcode += utilities::to_string(c.end_point.y, 3, buf);
+	if (is_xyz_relative_)
+	{
+		append_relative_offset_(gcode, c.end_point.y - c.start_point.y, relative_position_error.y, buf);
+	}
+	else
+	{
+		gcode += utilities::to_string(c.end_point.y, 3, buf);
+	}
+
+	// Add Z for helical arcs
+	if (has_z)
+	{
+		gcode += " Z";
+		if (is_xyz_relative_)
+		{
+			append_relative_offset_(gcode, c.end_point.z - c.start_point.z, relative_position_error.z, buf);
+		}
+		else
+		{
+			gcode += utilities::to_string(c.end_point.z, 3, buf);
+		}
+	}
 
 	gcode += " I";
 	gcode += utilities::to_string(i, 3, buf);
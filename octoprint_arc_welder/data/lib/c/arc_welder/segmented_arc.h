@@ -27,33 +27,73 @@
 #include "segmented_shape.h"
 #include <iomanip>
 #include <sstream>
+#include <vector>
 
 #define GCODE_CHAR_BUFFER_SIZE 100
 #define DEFAULT_MAX_RADIUS_MM 1000000.0 // 1km
+#define DEFAULT_ALLOW_3D_ARCS false
+#define DEFAULT_FLOAT_FITTING false
+// Float fitting is only used when the radius is at most this many times the resolution.  Past that, the squared
+// distances are too large for float precision to resolve the resolution, so the points are checked with doubles.
+#define FLOAT_FITTING_MAX_RADIUS_RESOLUTION_RATIO 10000.0
+// The reason the last point could not be added to the arc
+enum arc_rejection_reason
+{
+	arc_rejection_none,
+	arc_rejection_max_segments,
+	arc_rejection_z_changed,
+	arc_rejection_no_distance,
+	arc_rejection_radius_exceeded,
+	arc_rejection_no_fit
+};
+
 class segmented_arc :
 	public segmented_shape
 {
 public:
 	segmented_arc();
-	segmented_arc(int min_segments = DEFAULT_MIN_SEGMENTS, int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM, double max_radius_mm = DEFAULT_MAX_RADIUS_MM);
+	segmented_arc(int min_segments = DEFAULT_MIN_SEGMENTS, int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM, double max_radius_mm = DEFAULT_MAX_RADIUS_MM, bool allow_3d_arcs = DEFAULT_ALLOW_3D_ARCS);
 	virtual ~segmented_arc();
 	virtual bool try_add_point(point p, double e_relative);
-	std::string get_shape_gcode_absolute(double e, double f);
-	std::string get_shape_gcode_relative(double f);
+	virtual std::string get_shape_gcode_absolute(double e, double f, vector& relative_position_error);
+	virtual std::string get_shape_gcode_relative(double f, vector& relative_position_error);
 	
 	virtual bool is_shape() const;
 	point pop_front(double e_relative);
 	point pop_back(double e_relative);
 	bool try_get_arc(arc & target_arc);
 	double get_max_radius() const;
+	void set_max_radius(double max_radius_mm);
+	bool get_allow_3d_arcs() const;
+	// When true, points are checked against the circle in float precision relative to the first point of the arc.
+	// The circle itself and the emitted I and J are still calculated with doubles.
+	bool get_float_fitting() const;
+	void set_float_fitting(bool float_fitting);
+	double get_radius() const;
+	arc_rejection_reason get_last_rejection() const;
+	// The radius of the rejected circle when the last rejection was arc_rejection_radius_exceeded
+	double get_last_rejection_radius() const;
 	// static gcode buffer
 
 private:
 	bool try_add_point_internal_(point p, double pd);
+	bool try_create_circle_(const point& mid_point, const point& end_point, double max_radius, circle& c) const;
 	bool does_circle_fit_points_(circle& c) const;
+	bool does_circle_fit_relative_points_(const circle& c) const;
+	void update_relative_points_();
+	bool does_z_fit_points_() const;
 	bool try_get_arc_(const circle& c, arc& target_arc);
-	std::string get_shape_gcode_(bool has_e, double e, double f) const;
+	std::string get_shape_gcode_(bool has_e, double e, double f, vector& relative_position_error) const;
 	circle arc_circle_;
 	double max_radius_mm_;
+	bool allow_3d_arcs_;
+	bool float_fitting_;
+	// The points relative to the first point, in separate arrays so the fitting loops can be vectorized
+	std::vector<float> relative_x_;
+	std::vector<float> relative_y_;
+	double relative_origin_x_;
+	double relative_origin_y_;
+	arc_rejection_reason last_rejection_;
+	double last_rejection_radius_;
 };
 
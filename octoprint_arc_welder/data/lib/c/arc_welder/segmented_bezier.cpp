@@ -0,0 +1,347 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "segmented_bezier.h"
+#include "utilities.h"
+#include "segmented_shape.h"
+#include <iostream>
+#include <iomanip>
+#include <stdio.h>
+#include <cmath>
+
+// The number of least squares fits (each followed by a newton reparameterization) to try before giving up
+#define BEZIER_FIT_ITERATIONS 3
+#define BEZIER_FIT_DETERMINANT_TOLERANCE 0.000000001
+
+#pragma region Bezier Functions
+point bezier::get_point(double t) const
+{
+	double mt = 1.0 - t;
+	double b0 = mt * mt * mt;
+	double b1 = 3.0 * mt * mt * t;
+	double b2 = 3.0 * mt * t * t;
+	double b3 = t * t * t;
+	return point(
+		b0 * p0.x + b1 * p1.x + b2 * p2.x + b3 * p3.x,
+		b0 * p0.y + b1 * p1.y + b2 * p2.y + b3 * p3.y,
+		b0 * p0.z + b1 * p1.z + b2 * p2.z + b3 * p3.z,
+		0
+	);
+}
+
+vector bezier::get_derivative(double t) const
+{
+	double mt = 1.0 - t;
+	double d0 = 3.0 * mt * mt;
+	double d1 = 6.0 * mt * t;
+	double d2 = 3.0 * t * t;
+	return vector(
+		d0 * (p1.x - p0.x) + d1 * (p2.x - p1.x) + d2 * (p3.x - p2.x),
+		d0 * (p1.y - p0.y) + d1 * (p2.y - p1.y) + d2 * (p3.y - p2.y),
+		d0 * (p1.z - p0.z) + d1 * (p2.z - p1.z) + d2 * (p3.z - p2.z)
+	);
+}
+
+vector bezier::get_second_derivative(double t) const
+{
+	double mt = 1.0 - t;
+	return vector(
+		6.0 * mt * (p2.x - 2.0 * p1.x + p0.x) + 6.0 * t * (p3.x - 2.0 * p2.x + p1.x),
+		6.0 * mt * (p2.y - 2.0 * p1.y + p0.y) + 6.0 * t * (p3.y - 2.0 * p2.y + p1.y),
+		6.0 * mt * (p2.z - 2.0 * p1.z + p0.z) + 6.0 * t * (p3.z - 2.0 * p2.z + p1.z)
+	);
+}
+#pragma endregion Bezier Functions
+
+segmented_bezier::segmented_bezier(int min_segments, int max_segments, double resolution_mm) : segmented_shape(min_segments < DEFAULT_MIN_BEZIER_SEGMENTS ? DEFAULT_MIN_BEZIER_SEGMENTS : min_segments, max_segments, resolution_mm), t_values_(max_segments)
+{
+}
+
+segmented_bezier::~segmented_bezier()
+{
+}
+
+void segmented_bezier::clear()
+{
+	segmented_shape::clear();
+	curve_ = bezier();
+}
+
+bool segmented_bezier::try_get_bezier(bezier& target_bezier) const
+{
+	if (!is_shape_)
+		return false;
+	target_bezier = curve_;
+	return true;
+}
+
+bool segmented_bezier::try_add_point(point p, double e_relative)
+{
+	if (points_.count() > get_max_segments() - 1)
+	{
+		// Too many points, we can't add more
+		return false;
+	}
+	double distance = 0;
+	if (points_.count() > 0)
+	{
+		point p1 = points_[points_.count() - 1];
+		distance = utilities::get_cartesian_distance(p1.x, p1.y, p.x, p.y);
+		if (!utilities::is_equal(p1.z, p.z))
+		{
+			// G5 is planar, so z must be equal for all points
+			return false;
+		}
+
+		if (utilities::is_zero(distance))
+		{
+			// there must be some distance between the points
+			return false;
+		}
+	}
+
+	points_.push_back(p);
+	original_shape_length_ += distance;
+
+	if (points_.count() < get_min_segments())
+	{
+		// We need at least min_segments points before both control points can be fit, just add
+		if (points_.count() > 1)
+		{
+			e_relative_ += e_relative;
+		}
+		return true;
+	}
+
+	bezier test_bezier;
+	if (try_fit_points_(test_bezier, &t_values_[0]))
+	{
+		curve_ = test_bezier;
+		e_relative_ += e_relative;
+		set_is_shape(true);
+		return true;
+	}
+
+	points_.pop_back();
+	original_shape_length_ -= distance;
+
+	if (!is_shape() && points_.count() > 1)
+	{
+		// We could not fit a curve to the initial points.  Pull off the initial point
+		// and try again, the same way segmented_arc does.
+		point old_initial_point = points_.pop_front();
+		point new_initial_point = points_[0];
+		original_shape_length_ -= utilities::get_cartesian_distance(old_initial_point.x, old_initial_point.y, new_initial_point.x, new_initial_point.y);
+		e_relative_ -= new_initial_point.e_relative;
+		return try_add_point(p, e_relative);
+	}
+	return false;
+}
+
+bool segmented_bezier::try_fit_points_(bezier& target_bezier, double* t_values) const
+{
+	const int count = points_.count();
+	if (count < DEFAULT_MIN_BEZIER_SEGMENTS)
+		return false;
+
+	// Use chord length parameterization for the initial guess
+	t_values[0] = 0;
+	for (int index = 1; index < count; index++)
+	{
+		t_values[index] = t_values[index - 1] + utilities::get_cartesian_distance(points_[index - 1].x, points_[index - 1].y, points_[index].x, points_[index].y);
+	}
+	const double total_length = t_values[count - 1];
+	if (utilities::is_zero(total_length))
+		return false;
+	for (int index = 1; index < count; index++)
+	{
+		t_values[index] /= total_length;
+	}
+
+	target_bezier.p0 = points_[0];
+	target_bezier.p3 = points_[count - 1];
+	const point& p0 = target_bezier.p0;
+	const point& p3 = target_bezier.p3;
+
+	for (int iteration = 0; iteration < BEZIER_FIT_ITERATIONS; iteration++)
+	{
+		// The end points are fixed, so solve the 2x2 least squares system for the two control points.
+		double c11 = 0, c12 = 0, c22 = 0;
+		double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+		for (int index = 1; index < count - 1; index++)
+		{
+			double t = t_values[index];
+			double mt = 1.0 - t;
+			double b0 = mt * mt * mt;
+			double b1 = 3.0 * mt * mt * t;
+			double b2 = 3.0 * mt * t * t;
+			double b3 = t * t * t;
+			double rx = points_[index].x - b0 * p0.x - b3 * p3.x;
+			double ry = points_[index].y - b0 * p0.y - b3 * p3.y;
+			c11 += b1 * b1;
+			c12 += b1 * b2;
+			c22 += b2 * b2;
+			x1 += b1 * rx;
+			x2 += b2 * rx;
+			y1 += b1 * ry;
+			y2 += b2 * ry;
+		}
+		double determinant = c11 * c22 - c12 * c12;
+		if (utilities::is_zero(determinant, BEZIER_FIT_DETERMINANT_TOLERANCE))
+			return false;
+
+		target_bezier.p1 = point((x1 * c22 - x2 * c12) / determinant, (y1 * c22 - y2 * c12) / determinant, p0.z, 0);
+		target_bezier.p2 = point((c11 * x2 - c12 * x1) / determinant, (c11 * y2 - c12 * y1) / determinant, p0.z, 0);
+
+		if (does_bezier_fit_points_(target_bezier, t_values))
+		{
+			return true;
+		}
+
+		if (iteration + 1 == BEZIER_FIT_ITERATIONS)
+			break;
+
+		// Improve the parameterization with a single newton-raphson step per point
+		for (int index = 1; index < count - 1; index++)
+		{
+			double t = t_values[index];
+			point q = target_bezier.get_point(t);
+			vector d1 = target_bezier.get_derivative(t);
+			vector d2 = target_bezier.get_second_derivative(t);
+			double dx = q.x - points_[index].x;
+			double dy = q.y - points_[index].y;
+			double numerator = dx * d1.x + dy * d1.y;
+			double denominator = d1.x * d1.x + d1.y * d1.y + dx * d2.x + dy * d2.y;
+			if (utilities::is_zero(denominator))
+				continue;
+			t -= numerator / denominator;
+			if (t < 0) t = 0;
+			else if (t > 1) t = 1;
+			t_values[index] = t;
+		}
+	}
+	return false;
+}
+
+bool segmented_bezier::does_bezier_fit_points_(const bezier& curve, const double* t_values) const
+{
+	const int count = points_.count();
+	double curve_length = 0;
+	point previous_point = curve.p0;
+	for (int index = 1; index < count; index++)
+	{
+		// The parameters must be increasing, else the curve doubles back on itself.
+		if (t_values[index] <= t_values[index - 1])
+			return false;
+		// Make sure the point lies within the resolution of the curve.  The distance to the point
+		// on the curve at the point's parameter is always >= the true distance, so this is conservative.
+		point point_on_curve = curve.get_point(t_values[index]);
+		if (utilities::greater_than(utilities::get_cartesian_distance(point_on_curve.x, point_on_curve.y, points_[index].x, points_[index].y), resolution_mm_))
+			return false;
+		// Make sure the curve does not bulge away from the segment between the two points.
+		point mid_point_on_curve = curve.get_point((t_values[index - 1] + t_values[index]) / 2.0);
+		if (utilities::greater_than(distance_from_segment(segment(points_[index - 1], points_[index]), mid_point_on_curve), resolution_mm_))
+			return false;
+		curve_length += utilities::get_cartesian_distance(previous_point.x, previous_point.y, mid_point_on_curve.x, mid_point_on_curve.y);
+		curve_length += utilities::get_cartesian_distance(mid_point_on_curve.x, mid_point_on_curve.y, point_on_curve.x, point_on_curve.y);
+		previous_point = point_on_curve;
+	}
+	// Like arcs, the length of the curve must match the length of the original segments
+	return utilities::is_equal(curve_length, original_shape_length_, resolution_mm_);
+}
+
+std::string segmented_bezier::get_shape_gcode_absolute(double e, double f, vector& relative_position_error)
+{
+	bool has_e = e_relative_ != 0;
+	return get_shape_gcode_(has_e, e, f, relative_position_error);
+}
+
+std::string segmented_bezier::get_shape_gcode_relative(double f, vector& relative_position_error)
+{
+	bool has_e = e_relative_ != 0;
+	return get_shape_gcode_(has_e, e_relative_, f, relative_position_error);
+}
+
+std::string segmented_bezier::get_shape_gcode_(bool has_e, double e, double f, vector& relative_position_error) const
+{
+	char buf[20];
+	std::string gcode;
+	// I and J are relative to the start point, P and Q are relative to the end point
+	double i = curve_.p1.x - curve_.p0.x;
+	double j = curve_.p1.y - curve_.p0.y;
+	double p = curve_.p2.x - curve_.p3.x;
+	double q = curve_.p2.y - curve_.p3.y;
+
+	gcode = "G5";
+
+	// In relative mode (G91) the endpoint is an offset from the start point
+	gcode += " X";
+	if (is_xyz_relative_)
+	{
+		append_relative_offset_(gcode, curve_.p3.x - curve_.p0.x, relative_position_error.x, buf);
+	}
+	else
+	{
+		gcode += utilities::to_string(curve_.p3.x, 3, buf);
+	}
+
+	gcode += " Y";
+	if (is_xyz_relative_)
+	{
+		append_relative_offset_(gcode, curve_.p3.y - curve_.p0.y, relative_position_error.y, buf);
+	}
+	else
+	{
+		gcode += utilities::to_string(curve_.p3.y, 3, buf);
+	}
+
+	gcode += " I";
+	gcode += utilities::to_string(i, 3, buf);
+
+	gcode += " J";
+	gcode += utilities::to_string(j, 3, buf);
+
+	gcode += " P";
+	gcode += utilities::to_string(p, 3, buf);
+
+	gcode += " Q";
+	gcode += utilities::to_string(q, 3, buf);
+
+	// Add E if it appears
+	if (has_e)
+	{
+		gcode += " E";
+		gcode += utilities::to_string(e, 5, buf);
+	}
+
+	// Add F if it appears
+	if (utilities::greater_than_or_equal(f, 1))
+	{
+		gcode += " F";
+		gcode += utilities::to_string(f, 0, buf);
+	}
+
+	return gcode;
+}
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "segmented_shape.h"
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+// A cubic bezier needs at least 4 points (3 segments) before both control points can be fit.
+#define DEFAULT_MIN_BEZIER_SEGMENTS 4
+
+struct bezier
+{
+	bezier() {
+		length = 0;
+	}
+	point p0;
+	point p1;
+	point p2;
+	point p3;
+	double length;
+	point get_point(double t) const;
+	vector get_derivative(double t) const;
+	vector get_second_derivative(double t) const;
+};
+
+class segmented_bezier :
+	public segmented_shape
+{
+public:
+	segmented_bezier(int min_segments = DEFAULT_MIN_BEZIER_SEGMENTS, int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM);
+	virtual ~segmented_bezier();
+	virtual bool try_add_point(point p, double e_relative);
+	virtual std::string get_shape_gcode_absolute(double e, double f, vector& relative_position_error);
+	virtual std::string get_shape_gcode_relative(double f, vector& relative_position_error);
+	virtual void clear();
+	bool try_get_bezier(bezier& target_bezier) const;
+
+private:
+	bool try_fit_points_(bezier& target_bezier, double* t_values) const;
+	bool does_bezier_fit_points_(const bezier& curve, const double* t_values) const;
+	std::string get_shape_gcode_(bool has_e, double e, double f, vector& relative_position_error) const;
+	bezier curve_;
+	// Parameter (t) buffer, reused so that we don't allocate while fitting.
+	std::vector<double> t_values_;
+};
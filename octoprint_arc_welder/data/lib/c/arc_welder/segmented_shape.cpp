@@ -25,6 +25,7 @@
 
 #include "segmented_shape.h"
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #pragma region Operators for Vector and Point
 point operator +(point lhs, const vector rhs) {
@@ -198,6 +199,20 @@ bool circle::try_create_circle(point p1, point p2, point p3, double max_radius,
 	new_circle.radius = radius;
 	return true;
 }
+
+bool circle::try_create_circle_relative(point p1, point p2, point p3, double max_radius, circle& new_circle)
+{
+	// Work relative to the first point.  Squaring large absolute coordinates loses precision to cancellation.
+	point origin(0, 0, p1.z, 0);
+	point relative_p2(p2.x - p1.x, p2.y - p1.y, p2.z, 0);
+	point relative_p3(p3.x - p1.x, p3.y - p1.y, p3.z, 0);
+	if (!try_create_circle(origin, relative_p2, relative_p3, max_radius, new_circle))
+		return false;
+	new_circle.center.x += p1.x;
+	new_circle.center.y += p1.y;
+	return true;
+}
+
 double circle::get_radians(const point& p1, const point& p2) const
 {
 	double distance_sq = pow(utilities::get_cartesian_distance(p1.x, p1.y, p2.x, p2.y), 2.0);
@@ -227,57 +242,57 @@ point circle::get_closest_point(const point& p) const
 #pragma region Arc Functions
 bool arc::try_create_arc(const circle& c, const point& start_point, const point& mid_point, const point& end_point, double approximate_length, double resolution, arc& target_arc)
 {
-	//point p1 = c.get_closest_point(start_point);
-	//point p2 = c.get_closest_point(mid_point);
-	//point p3 = c.get_closest_point(end_point);
-	/*// Get the radians between p1 and p2 (short angle)
-	double p1_p2_rad = c.get_radians(p1, p2);
-	double p2_p3_rad = c.get_radians(p2, p3);
-	double p3_p1_rad = c.get_radians(p3, p1);
-	*/
-
-	double polar_start_theta = c.get_polar_radians(start_point);
-	double polar_mid_theta = c.get_polar_radians(mid_point);
-	double polar_end_theta = c.get_polar_radians(end_point);
-	
-	// variable to hold radians
-	double angle_radians = 0;
-	int direction = 0;  // 1 = counter clockwise, 2 = clockwise, 3 = unknown.
-	// Determine the direction of the arc
-	if (polar_end_theta > polar_start_theta)
+	// Work with the vectors from the center so the direction comes from the signs of the cross products
+	// and the sweep from a single atan2, rather than from the polar angle of all three points.
+	double start_x = start_point.x - c.center.x;
+	double start_y = start_point.y - c.center.y;
+	double mid_x = mid_point.x - c.center.x;
+	double mid_y = mid_point.y - c.center.y;
+	double end_x = end_point.x - c.center.x;
+	double end_y = end_point.y - c.center.y;
+
+	double start_mid_cross = start_x * mid_y - start_y * mid_x;
+	double mid_end_cross = mid_x * end_y - mid_y * end_x;
+	double start_end_cross = start_x * end_y - start_y * end_x;
+	double start_end_dot = start_x * end_x + start_y * end_y;
+
+	int direction = 0;  // 1 = counter clockwise, 2 = clockwise, 0 = unknown.
+	// Determine the direction of the arc by finding which way around the circle passes through the mid point
+	if (start_end_cross > 0)
 	{
-		if (polar_start_theta < polar_mid_theta && polar_mid_theta < polar_end_theta) {
-			direction = 1;		
-			angle_radians = polar_end_theta - polar_start_theta;
-		}
-		else if (
-			(0.0 <= polar_mid_theta && polar_mid_theta < polar_start_theta) ||
-			(polar_end_theta < polar_mid_theta && polar_mid_theta < (2.0 * PI_DOUBLE))
-		)
-		{
+		// The counter clockwise arc from the start to the end is less than 180 degrees
+		if (start_mid_cross > 0 && mid_end_cross > 0)
+			direction = 1;
+		else if (start_mid_cross < 0 || mid_end_cross < 0)
 			direction = 2;
-			angle_radians = polar_start_theta + ((2.0 * PI_DOUBLE) - polar_end_theta);
-		}
 	}
-	else if (polar_start_theta > polar_end_theta)
+	else if (start_end_cross < 0)
 	{
-		if (
-			(polar_start_theta < polar_mid_theta && polar_mid_theta < (2.0 * PI_DOUBLE)) ||
-			(0.0 < polar_mid_theta && polar_mid_theta < polar_end_theta)
-		)
-		{
+		// The clockwise arc from the start to the end is less than 180 degrees
+		if (start_mid_cross < 0 && mid_end_cross < 0)
+			direction = 2;
+		else if (start_mid_cross > 0 || mid_end_cross > 0)
+			direction = 1;
+	}
+	else if (start_end_dot < 0)
+	{
+		// The start and end are on opposite sides of the circle
+		if (start_mid_cross > 0)
 			direction = 1;
-			angle_radians = polar_end_theta + ((2.0 * PI_DOUBLE) - polar_start_theta);
-		}
-		else if (polar_end_theta < polar_mid_theta && polar_mid_theta < polar_start_theta)
-		{
+		else if (start_mid_cross < 0)
 			direction = 2;
-			angle_radians = polar_start_theta - polar_end_theta;
-		}
 	}
-	
+	// Else the start and end are at the same angle, which can't be an arc
+
 	if (direction == 0) return false;
-	
+
+	// The counter clockwise sweep from the start to the end, between 0 and 2 PI
+	double angle_radians = atan2(start_end_cross, start_end_dot);
+	if (angle_radians < 0)
+		angle_radians += 2.0 * PI_DOUBLE;
+	if (direction == 2)
+		angle_radians = (2.0 * PI_DOUBLE) - angle_radians;
+
 	double arc_length = c.radius * angle_radians;
 	if (!utilities::is_equal(arc_length, approximate_length, resolution))
 		return false;
@@ -293,8 +308,6 @@ bool arc::try_create_arc(const circle& c, const point& start_point, const point&
 	target_arc.end_point = end_point;
 	target_arc.length = arc_length;
 	target_arc.angle_radians = angle_radians;
-	target_arc.polar_start_theta = polar_start_theta;
-	target_arc.polar_end_theta = polar_end_theta;
 	return true;
 	
 }
@@ -319,6 +332,7 @@ segmented_shape::segmented_shape(int min_segments, int max_segments, double reso
 
 	original_shape_length_ = 0;
 	is_extruding_ = true;
+	is_xyz_relative_ = false;
 }
 
 segmented_shape::~segmented_shape()
@@ -330,6 +344,14 @@ bool segmented_shape::is_extruding()
 {
 	return is_extruding_;
 }
+bool segmented_shape::is_xyz_relative() const
+{
+	return is_xyz_relative_;
+}
+void segmented_shape::set_is_xyz_relative(bool value)
+{
+	is_xyz_relative_ = value;
+}
 segmented_shape& segmented_shape::operator=(const segmented_shape& obj)
 {
 	points_.clear();
@@ -344,6 +366,7 @@ segmented_shape& segmented_shape::operator=(const segmented_shape& obj)
 	original_shape_length_ = obj.original_shape_length_;
 	e_relative_ = obj.e_relative_;
 	is_shape_ = obj.is_shape_;
+	is_xyz_relative_ = obj.is_xyz_relative_;
 	max_segments_ = obj.max_segments_;
 	resolution_mm_ = obj.resolution_mm_;
 	return *this;
@@ -396,7 +419,7 @@ double segmented_shape::get_resolution_mm()
 }
 void segmented_shape::set_resolution_mm(double resolution_mm)
 {
-	resolution_mm_ = resolution_mm;
+	resolution_mm_ = resolution_mm / 2.0; // divide by 2 because it is + or - 1/2 of the desired resolution.
 	
 }
 point segmented_shape::pop_front()
@@ -413,12 +436,30 @@ bool segmented_shape::try_add_point(point p, double e_relative)
 	throw std::exception();
 }
 
-std::string segmented_shape::get_shape_gcode_absolute(double e_abs_start)
+std::string segmented_shape::get_shape_gcode_absolute(double, double, vector&)
 {
 	throw std::exception();
 }
 
-std::string segmented_shape::get_shape_gcode_relative()
+std::string segmented_shape::get_shape_gcode_relative(double, vector&)
 {
 	throw std::exception();
+}
+
+void segmented_shape::append_relative_offset_(std::string& gcode, double offset, double& relative_position_error, char* buf)
+{
+	const double target_offset = offset + relative_position_error;
+	// Round to the nearest thousandth so the carried error stays within half of the last decimal place.  The rounded
+	// value is moved away from 0 by less than a thousandth so that it is not truncated to the next lower one.
+	const double rounded_offset = std::floor(target_offset * 1000.0 + 0.5) / 1000.0;
+	if (rounded_offset == 0)
+	{
+		utilities::to_string(0.0, 3, buf);
+	}
+	else
+	{
+		utilities::to_string(rounded_offset + (rounded_offset < 0 ? -RELATIVE_OFFSET_TOLERANCE_MM : RELATIVE_OFFSET_TOLERANCE_MM), 3, buf);
+	}
+	relative_position_error = target_offset - std::strtod(buf, NULL);
+	gcode += buf;
 }
\ No newline at end of file
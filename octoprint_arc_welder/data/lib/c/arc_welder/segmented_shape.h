@@ -35,6 +35,10 @@
 //#define CIRCLE_GENERATION_A_ZERO_TOLERANCE 0.0000005 // fail
 //#define CIRCLE_GENERATION_A_ZERO_TOLERANCE 0.00000075 // fail
 //#define CIRCLE_GENERATION_A_ZERO_TOLERANCE 0.000000875 // fail
+// Points within the resolution plus this tolerance of the radius fit the circle, matching utilities::greater_than
+#define CIRCLE_FIT_TOLERANCE_MM 0.000005
+// Relative (G91) offsets are moved away from 0 by this before they are written, so that truncation doesn't drop a thousandth
+#define RELATIVE_OFFSET_TOLERANCE_MM 0.0000001
 
 
 #include <list> 
@@ -127,6 +131,8 @@ struct circle {
 
 	bool is_point_on_circle(point p, double resolution_mm);
 	static bool try_create_circle(point p1, point p2, point p3, double max_radius, circle& new_circle);
+	// Creates the circle relative to p1, which keeps more precision when the coordinates are large.
+	static bool try_create_circle_relative(point p1, point p2, point p3, double max_radius, circle& new_circle);
 	
 	double get_radians(const point& p1, const point& p2) const;
 
@@ -151,16 +157,12 @@ struct arc : circle
 		end_point.y = 0;
 		end_point.z = 0;
 		is_arc = false;
-		polar_start_theta = 0;
-		polar_end_theta = 0;
 			
 	}
 	
 	bool is_arc;
 	double length;
 	double angle_radians;
-	double polar_start_theta;
-	double polar_end_theta;
 	point start_point;
 	point end_point;
 	static bool try_create_arc(const circle& c, const point& start_point, const point& mid_point, const point& end_point, double approximate_length, double resolution, arc& target_arc);
@@ -191,9 +193,13 @@ public:
 	virtual point pop_front();
 	virtual point pop_back();
 	virtual bool try_add_point(point p, double e_relative);
-	virtual std::string get_shape_gcode_absolute(double e_abs_start);
-	virtual std::string get_shape_gcode_relative();
+	// relative_position_error is the source position minus the position the target is at in relative mode (G91).  It is
+	// added to the shape's offset, and updated with the part of the offset lost to the decimal places written.
+	virtual std::string get_shape_gcode_absolute(double e, double f, vector& relative_position_error);
+	virtual std::string get_shape_gcode_relative(double f, vector& relative_position_error);
 	bool is_extruding();
+	bool is_xyz_relative() const;
+	void set_is_xyz_relative(bool value);
 protected:
 	array_list<point> points_;
 	void set_is_shape(bool value);
@@ -202,6 +208,10 @@ protected:
 	bool is_extruding_;
 	double resolution_mm_;
 	bool is_shape_;
+	// When true, the shape's endpoint is written relative to its start point (G91)
+	bool is_xyz_relative_;
+	// Appends a relative offset rounded to 3 decimals, carrying the part that was rounded off in relative_position_error so it can't build up
+	static void append_relative_offset_(std::string& gcode, double offset, double& relative_position_error, char* buf);
 private:
 	int min_segments_;
 	int max_segments_;
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "source_line_map.h"
+#include <cstdio>
+#include <cstring>
+
+source_line_map::source_line_map()
+{
+}
+
+source_line_map::~source_line_map()
+{
+}
+
+void source_line_map::clear()
+{
+	runs_.clear();
+}
+
+void source_line_map::add_target_line(long target_line, long source_start_line, long source_end_line)
+{
+	if (!runs_.empty())
+	{
+		// Extend the previous run if this line continues it
+		source_line_run& run = runs_.back();
+		if (
+			target_line == run.target_line + run.num_lines
+			&& source_start_line == run.source_start_line + run.num_lines
+			&& source_end_line == run.source_end_line + run.num_lines
+		)
+		{
+			run.num_lines++;
+			return;
+		}
+	}
+	source_line_run run;
+	run.target_line = target_line;
+	run.source_start_line = source_start_line;
+	run.source_end_line = source_end_line;
+	run.num_lines = 1;
+	runs_.push_back(run);
+}
+
+bool source_line_map::get_source_lines(long target_line, long& source_start_line, long& source_end_line) const
+{
+	// Find the last run starting at or before the target line
+	int low = 0;
+	int high = static_cast<int>(runs_.size()) - 1;
+	int found = -1;
+	while (low <= high)
+	{
+		const int mid = low + (high - low) / 2;
+		if (runs_[mid].target_line <= target_line)
+		{
+			found = mid;
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+	if (found < 0 || target_line >= runs_[found].target_line + runs_[found].num_lines)
+	{
+		return false;
+	}
+	const source_line_run& run = runs_[found];
+	const long offset = target_line - static_cast<long>(run.target_line);
+	source_start_line = static_cast<long>(run.source_start_line) + offset;
+	source_end_line = static_cast<long>(run.source_end_line) + offset;
+	return true;
+}
+
+int source_line_map::get_num_runs() const
+{
+	return static_cast<int>(runs_.size());
+}
+
+// The file is the magic and version, followed by the number of runs and the runs themselves.
+bool source_line_map::save(const std::string& file_path) const
+{
+	FILE* file = fopen(file_path.c_str(), "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	const unsigned int version = SOURCE_LINE_MAP_VERSION;
+	const long long num_runs = static_cast<long long>(runs_.size());
+	bool success = fwrite(SOURCE_LINE_MAP_MAGIC, 1, 4, file) == 4
+		&& fwrite(&version, sizeof(version), 1, file) == 1
+		&& fwrite(&num_runs, sizeof(num_runs), 1, file) == 1;
+	for (unsigned int index = 0; success && index < runs_.size(); index++)
+	{
+		const source_line_run& run = runs_[index];
+		success = fwrite(&run.target_line, sizeof(run.target_line), 1, file) == 1
+			&& fwrite(&run.source_start_line, sizeof(run.source_start_line), 1, file) == 1
+			&& fwrite(&run.source_end_line, sizeof(run.source_end_line), 1, file) == 1
+			&& fwrite(&run.num_lines, sizeof(run.num_lines), 1, file) == 1;
+	}
+	success = fclose(file) == 0 && success;
+	if (!success)
+	{
+		remove(file_path.c_str());
+	}
+	return success;
+}
+
+bool source_line_map::load(const std::string& file_path)
+{
+	clear();
+	FILE* file = fopen(file_path.c_str(), "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	char magic[4];
+	unsigned int version;
+	long long num_runs;
+	bool success = fread(magic, 1, 4, file) == 4
+		&& memcmp(magic, SOURCE_LINE_MAP_MAGIC, 4) == 0
+		&& fread(&version, sizeof(version), 1, file) == 1
+		&& version == SOURCE_LINE_MAP_VERSION
+		&& fread(&num_runs, sizeof(num_runs), 1, file) == 1
+		&& num_runs >= 0;
+	for (long long index = 0; success && index < num_runs; index++)
+	{
+		source_line_run run;
+		success = fread(&run.target_line, sizeof(run.target_line), 1, file) == 1
+			&& fread(&run.source_start_line, sizeof(run.source_start_line), 1, file) == 1
+			&& fread(&run.source_end_line, sizeof(run.source_end_line), 1, file) == 1
+			&& fread(&run.num_lines, sizeof(run.num_lines), 1, file) == 1;
+		if (success)
+		{
+			runs_.push_back(run);
+		}
+	}
+	fclose(file);
+	if (!success)
+	{
+		clear();
+	}
+	return success;
+}
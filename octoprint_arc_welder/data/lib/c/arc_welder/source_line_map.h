@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <vector>
+
+#define SOURCE_LINE_MAP_MAGIC "AWLM"
+#define SOURCE_LINE_MAP_VERSION 1
+
+// A run of target lines.  Target line target_line + n maps to source lines source_start_line + n through source_end_line + n.
+// Lines copied from the source form one long run, while an arc gets a run of its own covering every segment it replaced.
+struct source_line_run
+{
+	source_line_run()
+	{
+		target_line = 0;
+		source_start_line = 0;
+		source_end_line = 0;
+		num_lines = 0;
+	}
+	long long target_line;
+	long long source_start_line;
+	long long source_end_line;
+	long long num_lines;
+};
+
+// Maps each line of the target file to the range of source lines it was created from.
+class source_line_map
+{
+public:
+	source_line_map();
+	virtual ~source_line_map();
+	void clear();
+	// Target lines must be added in order.  Lines that were not created from the source (the ArcWelder header) are skipped.
+	void add_target_line(long target_line, long source_start_line, long source_end_line);
+	// Gets the source lines for a target line in O(log n).  Returns false if the target line has no source.
+	bool get_source_lines(long target_line, long& source_start_line, long& source_end_line) const;
+	int get_num_runs() const;
+	bool save(const std::string& file_path) const;
+	bool load(const std::string& file_path);
+private:
+	std::vector<source_line_run> runs_;
+};
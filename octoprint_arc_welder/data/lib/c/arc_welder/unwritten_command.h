@@ -25,6 +25,7 @@
 #pragma once
 #include "parsed_command.h"
 #include "position.h"
+#include "arc_coalescer.h"
 struct unwritten_command
 {
 	unwritten_command() {
@@ -32,25 +33,51 @@ struct unwritten_command
 		e_relative = 0;
 		offset_e = 0;
 		extrusion_length = 0;
+		f = 0;
+		is_move = false;
+		duration_seconds = 0;
+		source_start_line = 0;
+		source_end_line = 0;
 	}
-	unwritten_command(parsed_command &cmd, bool is_relative, double command_length) {
+	unwritten_command(const parsed_command& cmd, bool is_relative, double command_length, bool is_move_command = false, double move_duration_seconds = 0) {
 		is_extruder_relative = is_relative;
 		command = cmd;
 		extrusion_length = command_length;
+		e_relative = 0;
+		offset_e = 0;
+		f = 0;
+		is_move = is_move_command;
+		duration_seconds = move_duration_seconds;
+		source_start_line = 0;
+		source_end_line = 0;
 	}
-	unwritten_command(position* p, double command_length) {
+	unwritten_command(position* p, double command_length, bool is_move_command = false, double move_duration_seconds = 0) {
 	  
 		e_relative = p->get_current_extruder().e_relative;
 		offset_e = p->get_current_extruder().get_offset_e();
 		is_extruder_relative = p->is_extruder_relative;
 		command = p->command;
 		extrusion_length = command_length;
+		f = p->f;
+		is_move = is_move_command;
+		duration_seconds = move_duration_seconds;
+		source_start_line = p->file_line_number;
+		source_end_line = p->file_line_number;
 	}
 	bool is_extruder_relative;
 	double e_relative;
 	double offset_e;
 	double extrusion_length;
+	double f;
+	// Used to estimate the command rate of the target file
+	bool is_move;
+	double duration_seconds;
+	// The source lines this command was created from
+	long source_start_line;
+	long source_end_line;
 	parsed_command command;
+	// Set for arcs that may be coalesced with the arcs around them
+	coalescable_arc arc;
 
 	std::string to_string(bool rewrite, std::string additional_comment)
 	{
@@ -62,7 +62,7 @@ public:
 		max_size_ = max_size;
 	}
 	
-	void push_front(T object)
+	void push_front(const T& object)
 	{
 		if (count_ == max_size_)
 		{
@@ -79,7 +79,7 @@ public:
 		items_[front_index_] = object;
 	}
 	
-	void push_back(T object)
+	void push_back(const T& object)
 	{
 		if (count_ == max_size_)
 		{
@@ -0,0 +1,688 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "bgcode.h"
+#include <cstring>
+#ifdef ARC_WELDER_ZLIB
+#include <zlib.h>
+#endif
+
+// The size of the file header: magic, version and checksum type
+#define BGCODE_FILE_HEADER_SIZE 10
+#define BGCODE_CHECKSUM_SIZE 4
+// The number of earlier matches checked for each heatshrink backreference
+#define HEATSHRINK_MAX_CHAIN_LENGTH 64
+// Backreferences shorter than this are written as literals
+#define HEATSHRINK_MIN_MATCH_LENGTH 2
+
+static unsigned short get_uint16(const unsigned char* data)
+{
+	return static_cast<unsigned short>(data[0] | (data[1] << 8));
+}
+
+static unsigned int get_uint32(const unsigned char* data)
+{
+	return static_cast<unsigned int>(data[0]) | (static_cast<unsigned int>(data[1]) << 8) |
+		(static_cast<unsigned int>(data[2]) << 16) | (static_cast<unsigned int>(data[3]) << 24);
+}
+
+static void put_uint16(unsigned char* data, unsigned int value)
+{
+	data[0] = static_cast<unsigned char>(value & 0xFF);
+	data[1] = static_cast<unsigned char>((value >> 8) & 0xFF);
+}
+
+static void put_uint32(unsigned char* data, unsigned int value)
+{
+	put_uint16(data, value & 0xFFFF);
+	put_uint16(data + 2, value >> 16);
+}
+
+size_t bgcode_block_header::get_size() const
+{
+	return compression == bgcode_compression_none ? 8 : 12;
+}
+
+size_t bgcode_block_header::get_parameters_size() const
+{
+	// Thumbnails store their format, width and height, every other block stores its encoding
+	return type == bgcode_block_thumbnail ? 6 : 2;
+}
+
+size_t bgcode_block_header::get_data_size() const
+{
+	return compression == bgcode_compression_none ? uncompressed_size : compressed_size;
+}
+
+unsigned int bgcode::update_crc32(unsigned int crc, const unsigned char* data, size_t length)
+{
+	static unsigned int table[256];
+	static bool is_table_initialized = false;
+	if (!is_table_initialized)
+	{
+		for (unsigned int index = 0; index < 256; index++)
+		{
+			unsigned int value = index;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+			}
+			table[index] = value;
+		}
+		is_table_initialized = true;
+	}
+	crc ^= 0xFFFFFFFF;
+	for (size_t index = 0; index < length; index++)
+	{
+		crc = table[(crc ^ data[index]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+void bgcode::heatshrink_compress(const unsigned char* data, size_t length, int window_bits, int lookahead_bits, std::vector<unsigned char>& output)
+{
+	output.clear();
+	output.reserve(length / 2);
+	const size_t window_size = static_cast<size_t>(1) << window_bits;
+	const size_t max_match_length = static_cast<size_t>(1) << lookahead_bits;
+	// Chains of earlier positions that start with the same two bytes
+	std::vector<int> heads(65536, -1);
+	std::vector<int> previous(length, -1);
+	unsigned int bit_buffer = 0;
+	int bit_count = 0;
+	size_t position = 0;
+	while (position < length)
+	{
+		size_t best_length = 0;
+		size_t best_offset = 0;
+		if (position + 1 < length)
+		{
+			int candidate = heads[(data[position] << 8) | data[position + 1]];
+			const size_t max_length = length - position < max_match_length ? length - position : max_match_length;
+			for (int depth = 0; candidate >= 0 && position - candidate <= window_size && depth < HEATSHRINK_MAX_CHAIN_LENGTH; depth++)
+			{
+				size_t match_length = 0;
+				while (match_length < max_length && data[candidate + match_length] == data[position + match_length])
+				{
+					match_length++;
+				}
+				if (match_length > best_length)
+				{
+					best_length = match_length;
+					best_offset = position - candidate;
+					if (match_length == max_length)
+					{
+						break;
+					}
+				}
+				candidate = previous[candidate];
+			}
+		}
+		// Each token is a tag bit followed by a literal byte, or by the backreference offset and length
+		unsigned int token;
+		int token_bits;
+		size_t token_length;
+		if (best_length >= HEATSHRINK_MIN_MATCH_LENGTH)
+		{
+			token = (static_cast<unsigned int>(best_offset - 1) << lookahead_bits) | static_cast<unsigned int>(best_length - 1);
+			token_bits = 1 + window_bits + lookahead_bits;
+			token_length = best_length;
+		}
+		else
+		{
+			token = 0x100 | data[position];
+			token_bits = 9;
+			token_length = 1;
+		}
+		bit_buffer = (bit_buffer << token_bits) | token;
+		bit_count += token_bits;
+		while (bit_count >= 8)
+		{
+			bit_count -= 8;
+			output.push_back(static_cast<unsigned char>((bit_buffer >> bit_count) & 0xFF));
+		}
+		for (size_t index = 0; index < token_length; index++, position++)
+		{
+			if (position + 1 < length)
+			{
+				int& head = heads[(data[position] << 8) | data[position + 1]];
+				previous[position] = head;
+				head = static_cast<int>(position);
+			}
+		}
+	}
+	// Pad the last byte with zeros, which the decoder ignores
+	if (bit_count > 0)
+	{
+		output.push_back(static_cast<unsigned char>((bit_buffer << (8 - bit_count)) & 0xFF));
+	}
+}
+
+bool bgcode::heatshrink_decompress(const unsigned char* data, size_t length, int window_bits, int lookahead_bits, size_t uncompressed_size, std::vector<unsigned char>& output)
+{
+	output.clear();
+	output.reserve(uncompressed_size);
+	const size_t total_bits = length * 8;
+	size_t bit_position = 0;
+	while (output.size() < uncompressed_size)
+	{
+		// A literal needs 9 bits, so anything less is padding
+		if (total_bits - bit_position < 9)
+		{
+			break;
+		}
+		// Read the bits most significant first
+		unsigned int value = 0;
+		const int tag_bits = (data[bit_position >> 3] >> (7 - (bit_position & 7))) & 1 ? 9 : 1 + window_bits + lookahead_bits;
+		if (total_bits - bit_position < static_cast<size_t>(tag_bits))
+		{
+			break;
+		}
+		for (int bit = 0; bit < tag_bits; bit++, bit_position++)
+		{
+			value = (value << 1) | ((data[bit_position >> 3] >> (7 - (bit_position & 7))) & 1);
+		}
+		if (tag_bits == 9)
+		{
+			output.push_back(static_cast<unsigned char>(value & 0xFF));
+			continue;
+		}
+		const size_t offset = ((value >> lookahead_bits) & ((1u << window_bits) - 1)) + 1;
+		const size_t count = (value & ((1u << lookahead_bits) - 1)) + 1;
+		for (size_t index = 0; index < count && output.size() < uncompressed_size; index++)
+		{
+			// The window starts out filled with zeros
+			output.push_back(output.size() >= offset ? output[output.size() - offset] : 0);
+		}
+	}
+	return output.size() == uncompressed_size;
+}
+
+// Reading
+
+bgcode_input_decoder::bgcode_input_decoder()
+{
+	file_ = NULL;
+	checksum_type_ = bgcode_checksum_none;
+	position_ = 0;
+	is_eof_ = false;
+	has_error_ = false;
+	gcode_position_ = 0;
+}
+
+bgcode_input_decoder::bgcode_input_decoder(const bgcode_input_decoder&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+bgcode_input_decoder::~bgcode_input_decoder()
+{
+	close();
+}
+
+bool bgcode_input_decoder::open(const std::string& file_path, bool)
+{
+	close();
+	file_ = fopen(file_path.c_str(), "rb");
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	unsigned char header[BGCODE_FILE_HEADER_SIZE];
+	if (!read_bytes_(header, sizeof(header), NULL) || memcmp(header, BGCODE_MAGIC, 4) != 0 || get_uint32(header + 4) != BGCODE_VERSION)
+	{
+		close();
+		return false;
+	}
+	checksum_type_ = get_uint16(header + 8);
+	if (checksum_type_ != bgcode_checksum_none && checksum_type_ != bgcode_checksum_crc32)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void bgcode_input_decoder::close()
+{
+	if (file_ != NULL)
+	{
+		fclose(file_);
+		file_ = NULL;
+	}
+	position_ = 0;
+	is_eof_ = false;
+	has_error_ = false;
+	gcode_.clear();
+	gcode_position_ = 0;
+}
+
+bool bgcode_input_decoder::is_open() const
+{
+	return file_ != NULL;
+}
+
+long bgcode_input_decoder::get_source_position() const
+{
+	return position_;
+}
+
+bool bgcode_input_decoder::has_error() const
+{
+	return has_error_;
+}
+
+size_t bgcode_input_decoder::read(char* buffer, size_t size)
+{
+	size_t bytes_read = 0;
+	while (bytes_read < size)
+	{
+		if (gcode_position_ == gcode_.length())
+		{
+			if (!read_next_gcode_block_())
+			{
+				break;
+			}
+			continue;
+		}
+		size_t bytes_to_copy = gcode_.length() - gcode_position_;
+		if (bytes_to_copy > size - bytes_read)
+		{
+			bytes_to_copy = size - bytes_read;
+		}
+		memcpy(buffer + bytes_read, gcode_.data() + gcode_position_, bytes_to_copy);
+		gcode_position_ += bytes_to_copy;
+		bytes_read += bytes_to_copy;
+	}
+	return bytes_read;
+}
+
+bool bgcode_input_decoder::read_bytes_(void* data, size_t length, unsigned int* p_crc)
+{
+	if (length == 0)
+	{
+		return true;
+	}
+	if (fread(data, 1, length, file_) != length)
+	{
+		return false;
+	}
+	position_ += static_cast<long>(length);
+	if (p_crc != NULL)
+	{
+		*p_crc = bgcode::update_crc32(*p_crc, static_cast<unsigned char*>(data), length);
+	}
+	return true;
+}
+
+bool bgcode_input_decoder::read_next_gcode_block_()
+{
+	gcode_.clear();
+	gcode_position_ = 0;
+	while (!is_eof_ && !has_error_)
+	{
+		unsigned int crc = 0;
+		unsigned char header_data[12];
+		bgcode_block_header header;
+		if (fread(header_data, 1, 1, file_) != 1)
+		{
+			// The file ends between blocks
+			is_eof_ = true;
+			return false;
+		}
+		position_++;
+		crc = bgcode::update_crc32(crc, header_data, 1);
+		if (!read_bytes_(header_data + 1, 7, &crc))
+		{
+			has_error_ = true;
+			return false;
+		}
+		header.type = get_uint16(header_data);
+		header.compression = get_uint16(header_data + 2);
+		header.uncompressed_size = get_uint32(header_data + 4);
+		if (header.compression != bgcode_compression_none)
+		{
+			if (!read_bytes_(header_data + 8, 4, &crc))
+			{
+				has_error_ = true;
+				return false;
+			}
+			header.compressed_size = get_uint32(header_data + 8);
+		}
+		const size_t checksum_size = checksum_type_ == bgcode_checksum_crc32 ? BGCODE_CHECKSUM_SIZE : 0;
+		if (header.type != bgcode_block_gcode)
+		{
+			// Skip metadata and thumbnails
+			const long skip_size = static_cast<long>(header.get_parameters_size() + header.get_data_size() + checksum_size);
+			if (fseek(file_, skip_size, SEEK_CUR) != 0)
+			{
+				has_error_ = true;
+				return false;
+			}
+			position_ += skip_size;
+			continue;
+		}
+		unsigned char parameters[2];
+		block_data_.resize(header.get_data_size());
+		if (!read_bytes_(parameters, sizeof(parameters), &crc) || !read_bytes_(block_data_.empty() ? NULL : &block_data_[0], block_data_.size(), &crc))
+		{
+			has_error_ = true;
+			return false;
+		}
+		if (checksum_size > 0)
+		{
+			unsigned char checksum[BGCODE_CHECKSUM_SIZE];
+			if (!read_bytes_(checksum, sizeof(checksum), NULL) || get_uint32(checksum) != crc)
+			{
+				has_error_ = true;
+				return false;
+			}
+		}
+		if (header.uncompressed_size == 0)
+		{
+			continue;
+		}
+		const std::vector<unsigned char>* p_data = &block_data_;
+		switch (header.compression)
+		{
+		case bgcode_compression_none:
+			break;
+#ifdef ARC_WELDER_ZLIB
+		case bgcode_compression_deflate:
+		{
+			decompressed_data_.resize(header.uncompressed_size);
+			uLongf decompressed_size = header.uncompressed_size;
+			if (uncompress(&decompressed_data_[0], &decompressed_size, &block_data_[0], static_cast<uLong>(block_data_.size())) != Z_OK || decompressed_size != header.uncompressed_size)
+			{
+				has_error_ = true;
+				return false;
+			}
+			p_data = &decompressed_data_;
+			break;
+		}
+#endif
+		case bgcode_compression_heatshrink_11_4:
+		case bgcode_compression_heatshrink_12_4:
+		{
+			const int window_bits = header.compression == bgcode_compression_heatshrink_11_4 ? 11 : 12;
+			if (!bgcode::heatshrink_decompress(&block_data_[0], block_data_.size(), window_bits, 4, header.uncompressed_size, decompressed_data_))
+			{
+				has_error_ = true;
+				return false;
+			}
+			p_data = &decompressed_data_;
+			break;
+		}
+		default:
+			// Not supported by this build
+			has_error_ = true;
+			return false;
+		}
+		const char* p_gcode = reinterpret_cast<const char*>(&(*p_data)[0]);
+		switch (get_uint16(parameters))
+		{
+		case bgcode_encoding_none:
+			gcode_.assign(p_gcode, p_data->size());
+			break;
+		case bgcode_encoding_meatpack:
+		case bgcode_encoding_meatpack_comments:
+			// Each block is packed separately
+			meatpack_.reset();
+			meatpack_.decode(p_gcode, p_data->size(), gcode_);
+			break;
+		default:
+			has_error_ = true;
+			return false;
+		}
+		if (!gcode_.empty())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Writing
+
+bgcode_output_encoder::bgcode_output_encoder()
+{
+	file_ = NULL;
+	checksum_type_ = bgcode_checksum_crc32;
+	has_error_ = false;
+}
+
+bgcode_output_encoder::bgcode_output_encoder(const bgcode_output_encoder&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+bgcode_output_encoder::~bgcode_output_encoder()
+{
+	close();
+}
+
+void bgcode_output_encoder::set_source_file_path(const std::string& source_file_path)
+{
+	source_file_path_ = source_file_path;
+}
+
+bool bgcode_output_encoder::open(const std::string& file_path)
+{
+	close();
+	file_ = fopen(file_path.c_str(), "wb");
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	gcode_.reserve(BGCODE_MAX_GCODE_BLOCK_SIZE);
+	if (source_file_path_.length() > 0 && input_decoder::get_compression_type(source_file_path_) == compression_bgcode)
+	{
+		if (!copy_source_metadata_())
+		{
+			fclose(file_);
+			file_ = NULL;
+			return false;
+		}
+		return true;
+	}
+	unsigned char header[BGCODE_FILE_HEADER_SIZE];
+	memcpy(header, BGCODE_MAGIC, 4);
+	put_uint32(header + 4, BGCODE_VERSION);
+	checksum_type_ = bgcode_checksum_crc32;
+	put_uint16(header + 8, checksum_type_);
+	std::vector<unsigned short> parameters(1, 0); // INI encoding
+	if (
+		!write_bytes_(header, sizeof(header), NULL) ||
+		!write_block_(bgcode_block_printer_metadata, bgcode_compression_none, parameters, NULL, 0, 0) ||
+		!write_block_(bgcode_block_print_metadata, bgcode_compression_none, parameters, NULL, 0, 0) ||
+		!write_block_(bgcode_block_slicer_metadata, bgcode_compression_none, parameters, NULL, 0, 0)
+	)
+	{
+		fclose(file_);
+		file_ = NULL;
+		return false;
+	}
+	return true;
+}
+
+bool bgcode_output_encoder::copy_source_metadata_()
+{
+	FILE* source = fopen(source_file_path_.c_str(), "rb");
+	if (source == NULL)
+	{
+		return false;
+	}
+	// Copy the file header and every block up to the first gcode block
+	bool success = true;
+	unsigned char header[BGCODE_FILE_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), source) != sizeof(header) || !write_bytes_(header, sizeof(header), NULL))
+	{
+		fclose(source);
+		return false;
+	}
+	checksum_type_ = get_uint16(header + 8);
+	const size_t checksum_size = checksum_type_ == bgcode_checksum_crc32 ? BGCODE_CHECKSUM_SIZE : 0;
+	std::vector<unsigned char> block;
+	while (success)
+	{
+		unsigned char header_data[12];
+		if (fread(header_data, 1, 8, source) != 8)
+		{
+			break;
+		}
+		bgcode_block_header block_header;
+		block_header.type = get_uint16(header_data);
+		block_header.compression = get_uint16(header_data + 2);
+		block_header.uncompressed_size = get_uint32(header_data + 4);
+		if (block_header.type == bgcode_block_gcode)
+		{
+			break;
+		}
+		if (block_header.compression != bgcode_compression_none)
+		{
+			if (fread(header_data + 8, 1, 4, source) != 4)
+			{
+				success = false;
+				break;
+			}
+			block_header.compressed_size = get_uint32(header_data + 8);
+		}
+		block.resize(block_header.get_parameters_size() + block_header.get_data_size() + checksum_size);
+		success = (
+			fread(&block[0], 1, block.size(), source) == block.size() &&
+			write_bytes_(header_data, block_header.get_size(), NULL) &&
+			write_bytes_(&block[0], block.size(), NULL)
+		);
+	}
+	fclose(source);
+	return success;
+}
+
+bool bgcode_output_encoder::close()
+{
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	bool success = write_gcode_block_() && !has_error_;
+	if (fclose(file_) != 0)
+	{
+		success = false;
+	}
+	file_ = NULL;
+	has_error_ = false;
+	gcode_.clear();
+	return success;
+}
+
+bool bgcode_output_encoder::is_open() const
+{
+	return file_ != NULL;
+}
+
+bool bgcode_output_encoder::write(const char* data, size_t length)
+{
+	// Only start a new block at the end of a line
+	if (gcode_.length() + length > BGCODE_MAX_GCODE_BLOCK_SIZE && !gcode_.empty() && gcode_[gcode_.length() - 1] == '\n')
+	{
+		if (!write_gcode_block_())
+		{
+			return false;
+		}
+	}
+	gcode_.append(data, length);
+	return true;
+}
+
+bool bgcode_output_encoder::write_gcode_block_()
+{
+	if (gcode_.empty())
+	{
+		return true;
+	}
+	const unsigned char* p_gcode = reinterpret_cast<const unsigned char*>(gcode_.data());
+	bgcode::heatshrink_compress(p_gcode, gcode_.length(), 12, 4, compressed_data_);
+	std::vector<unsigned short> parameters(1, bgcode_encoding_none);
+	bool success;
+	if (compressed_data_.size() < gcode_.length())
+	{
+		success = write_block_(bgcode_block_gcode, bgcode_compression_heatshrink_12_4, parameters, &compressed_data_[0], gcode_.length(), compressed_data_.size());
+	}
+	else
+	{
+		success = write_block_(bgcode_block_gcode, bgcode_compression_none, parameters, p_gcode, gcode_.length(), gcode_.length());
+	}
+	gcode_.clear();
+	return success;
+}
+
+bool bgcode_output_encoder::write_block_(unsigned short type, unsigned short compression, const std::vector<unsigned short>& parameters, const unsigned char* data, size_t uncompressed_size, size_t data_size)
+{
+	unsigned int crc = 0;
+	unsigned char header[12];
+	put_uint16(header, type);
+	put_uint16(header + 2, compression);
+	put_uint32(header + 4, static_cast<unsigned int>(uncompressed_size));
+	put_uint32(header + 8, static_cast<unsigned int>(data_size));
+	const size_t header_size = compression == bgcode_compression_none ? 8 : 12;
+	if (!write_bytes_(header, header_size, &crc))
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < parameters.size(); index++)
+	{
+		unsigned char parameter[2];
+		put_uint16(parameter, parameters[index]);
+		if (!write_bytes_(parameter, sizeof(parameter), &crc))
+		{
+			return false;
+		}
+	}
+	if (!write_bytes_(data, data_size, &crc))
+	{
+		return false;
+	}
+	if (checksum_type_ == bgcode_checksum_crc32)
+	{
+		unsigned char checksum[BGCODE_CHECKSUM_SIZE];
+		put_uint32(checksum, crc);
+		return write_bytes_(checksum, sizeof(checksum), NULL);
+	}
+	return true;
+}
+
+bool bgcode_output_encoder::write_bytes_(const void* data, size_t length, unsigned int* p_crc)
+{
+	if (length == 0)
+	{
+		return true;
+	}
+	if (fwrite(data, 1, length, file_) != length)
+	{
+		has_error_ = true;
+		return false;
+	}
+	if (p_crc != NULL)
+	{
+		*p_crc = bgcode::update_crc32(*p_crc, static_cast<const unsigned char*>(data), length);
+	}
+	return true;
+}
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "compressed_stream.h"
+#include "meatpack.h"
+
+// Prusa's binary gcode format.  See https://github.com/prusa3d/libbgcode/blob/main/doc/specifications.md
+// A file header is followed by metadata and thumbnail blocks, and then by the gcode blocks.
+#define BGCODE_MAGIC "GCDE"
+#define BGCODE_VERSION 1
+// The largest amount of gcode stored in one block when writing
+#define BGCODE_MAX_GCODE_BLOCK_SIZE 65536
+
+enum bgcode_checksum_type { bgcode_checksum_none = 0, bgcode_checksum_crc32 = 1 };
+enum bgcode_block_type {
+	bgcode_block_file_metadata = 0,
+	bgcode_block_gcode = 1,
+	bgcode_block_slicer_metadata = 2,
+	bgcode_block_printer_metadata = 3,
+	bgcode_block_print_metadata = 4,
+	bgcode_block_thumbnail = 5
+};
+enum bgcode_compression_type {
+	bgcode_compression_none = 0,
+	bgcode_compression_deflate = 1,
+	bgcode_compression_heatshrink_11_4 = 2,
+	bgcode_compression_heatshrink_12_4 = 3
+};
+enum bgcode_gcode_encoding { bgcode_encoding_none = 0, bgcode_encoding_meatpack = 1, bgcode_encoding_meatpack_comments = 2 };
+
+struct bgcode_block_header
+{
+	bgcode_block_header()
+	{
+		type = 0;
+		compression = 0;
+		uncompressed_size = 0;
+		compressed_size = 0;
+	}
+	unsigned short type;
+	unsigned short compression;
+	unsigned int uncompressed_size;
+	// Only stored if the block is compressed
+	unsigned int compressed_size;
+	size_t get_size() const;
+	size_t get_parameters_size() const;
+	size_t get_data_size() const;
+};
+
+class bgcode
+{
+public:
+	static unsigned int update_crc32(unsigned int crc, const unsigned char* data, size_t length);
+	// Compresses and decompresses the heatshrink (LZSS) streams used by the gcode blocks.
+	static void heatshrink_compress(const unsigned char* data, size_t length, int window_bits, int lookahead_bits, std::vector<unsigned char>& output);
+	static bool heatshrink_decompress(const unsigned char* data, size_t length, int window_bits, int lookahead_bits, size_t uncompressed_size, std::vector<unsigned char>& output);
+};
+
+// Reads the gcode blocks of a bgcode file as text.  Metadata and thumbnails are skipped.
+class bgcode_input_decoder : public input_decoder
+{
+public:
+	bgcode_input_decoder();
+	virtual ~bgcode_input_decoder();
+	virtual bool open(const std::string& file_path, bool binary);
+	virtual void close();
+	virtual bool is_open() const;
+	virtual size_t read(char* buffer, size_t size);
+	virtual long get_source_position() const;
+	virtual bool has_error() const;
+private:
+	bgcode_input_decoder(const bgcode_input_decoder& source);
+	bool read_next_gcode_block_();
+	bool read_bytes_(void* data, size_t length, unsigned int* p_crc);
+	FILE* file_;
+	unsigned short checksum_type_;
+	long position_;
+	bool is_eof_;
+	bool has_error_;
+	std::vector<unsigned char> block_data_;
+	std::vector<unsigned char> decompressed_data_;
+	std::string gcode_;
+	size_t gcode_position_;
+	meatpack_decoder meatpack_;
+};
+
+// Writes gcode into heatshrink compressed bgcode blocks.  The metadata and thumbnail blocks are copied from the source
+// if it is a bgcode file.  Otherwise empty printer, print and slicer metadata blocks are written.
+class bgcode_output_encoder : public output_encoder
+{
+public:
+	bgcode_output_encoder();
+	virtual ~bgcode_output_encoder();
+	virtual void set_source_file_path(const std::string& source_file_path);
+	virtual bool open(const std::string& file_path);
+	virtual bool close();
+	virtual bool is_open() const;
+	virtual bool write(const char* data, size_t length);
+	using output_encoder::write;
+private:
+	bgcode_output_encoder(const bgcode_output_encoder& source);
+	bool copy_source_metadata_();
+	bool write_block_(unsigned short type, unsigned short compression, const std::vector<unsigned short>& parameters, const unsigned char* data, size_t uncompressed_size, size_t data_size);
+	bool write_gcode_block_();
+	bool write_bytes_(const void* data, size_t length, unsigned int* p_crc);
+	FILE* file_;
+	std::string source_file_path_;
+	unsigned short checksum_type_;
+	bool has_error_;
+	std::string gcode_;
+	std::vector<unsigned char> compressed_data_;
+};
@@ -0,0 +1,957 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "compressed_stream.h"
+#include "bgcode.h"
+#include <cstring>
+#include <cstdlib>
+#ifdef ARC_WELDER_ZLIB
+#include <zlib.h>
+#include <thread>
+#include <vector>
+#include <functional>
+#endif
+#ifdef ARC_WELDER_ZSTD
+#include <zstd.h>
+#endif
+
+static bool ends_with(const std::string& value, const char* suffix)
+{
+	const size_t suffix_length = strlen(suffix);
+	if (value.length() < suffix_length)
+	{
+		return false;
+	}
+	for (size_t index = 0; index < suffix_length; index++)
+	{
+		// Compare case insensitively
+		char c = value[value.length() - suffix_length + index];
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = c - 'A' + 'a';
+		}
+		if (c != suffix[index])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Plain files
+
+file_input_decoder::file_input_decoder()
+{
+	file_ = NULL;
+	position_ = 0;
+}
+
+file_input_decoder::file_input_decoder(const file_input_decoder&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+file_input_decoder::~file_input_decoder()
+{
+	close();
+}
+
+bool file_input_decoder::open(const std::string& file_path, bool binary)
+{
+	close();
+	file_ = fopen(file_path.c_str(), binary ? "rb" : "r");
+	return file_ != NULL;
+}
+
+void file_input_decoder::close()
+{
+	if (file_ != NULL)
+	{
+		fclose(file_);
+		file_ = NULL;
+	}
+	position_ = 0;
+}
+
+bool file_input_decoder::is_open() const
+{
+	return file_ != NULL;
+}
+
+size_t file_input_decoder::read(char* buffer, size_t size)
+{
+	size_t bytes_read = fread(buffer, 1, size, file_);
+	position_ += static_cast<long>(bytes_read);
+	return bytes_read;
+}
+
+long file_input_decoder::get_source_position() const
+{
+	return position_;
+}
+
+bool file_input_decoder::seek(long position)
+{
+	if (file_ == NULL || fseek(file_, position, SEEK_SET) != 0)
+	{
+		return false;
+	}
+	position_ = position;
+	return true;
+}
+
+file_output_encoder::file_output_encoder(bool binary)
+{
+	file_ = NULL;
+	binary_ = binary;
+	has_error_ = false;
+}
+
+file_output_encoder::file_output_encoder(const file_output_encoder&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+file_output_encoder::~file_output_encoder()
+{
+	close();
+}
+
+bool file_output_encoder::open(const std::string& file_path)
+{
+	close();
+	file_ = fopen(file_path.c_str(), binary_ ? "wb" : "w");
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	setvbuf(file_, NULL, _IOFBF, COMPRESSED_STREAM_BUFFER_SIZE);
+	return true;
+}
+
+bool file_output_encoder::close()
+{
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	bool success = !has_error_ && fclose(file_) == 0;
+	file_ = NULL;
+	has_error_ = false;
+	return success;
+}
+
+bool file_output_encoder::is_open() const
+{
+	return file_ != NULL;
+}
+
+bool file_output_encoder::write(const char* data, size_t length)
+{
+	if (fwrite(data, 1, length, file_) != length)
+	{
+		has_error_ = true;
+		return false;
+	}
+	return true;
+}
+
+string_output_encoder::string_output_encoder()
+{
+	is_open_ = false;
+}
+
+string_output_encoder::string_output_encoder(const string_output_encoder&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+string_output_encoder::~string_output_encoder()
+{
+}
+
+bool string_output_encoder::open(const std::string&)
+{
+	buffer_.clear();
+	is_open_ = true;
+	return true;
+}
+
+bool string_output_encoder::close()
+{
+	if (!is_open_)
+	{
+		return false;
+	}
+	is_open_ = false;
+	return true;
+}
+
+bool string_output_encoder::is_open() const
+{
+	return is_open_;
+}
+
+bool string_output_encoder::write(const char* data, size_t length)
+{
+	buffer_.append(data, length);
+	return true;
+}
+
+void string_output_encoder::take(std::string& output)
+{
+	if (buffer_.length() == 0)
+	{
+		return;
+	}
+	if (output.length() == 0)
+	{
+		output.swap(buffer_);
+	}
+	else
+	{
+		output.append(buffer_);
+	}
+	buffer_.clear();
+}
+
+meatpack_output_encoder::meatpack_output_encoder(output_encoder* p_output, bool no_spaces) : encoder_(no_spaces)
+{
+	p_output_ = p_output;
+	has_error_ = false;
+}
+
+meatpack_output_encoder::meatpack_output_encoder(const meatpack_output_encoder&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+meatpack_output_encoder::~meatpack_output_encoder()
+{
+	close();
+	delete p_output_;
+}
+
+void meatpack_output_encoder::set_source_file_path(const std::string& source_file_path)
+{
+	p_output_->set_source_file_path(source_file_path);
+}
+
+bool meatpack_output_encoder::open(const std::string& file_path)
+{
+	close();
+	line_.clear();
+	packed_.clear();
+	has_error_ = false;
+	if (!p_output_->open(file_path))
+	{
+		return false;
+	}
+	encoder_.get_enable_commands(packed_);
+	return true;
+}
+
+bool meatpack_output_encoder::close()
+{
+	if (!p_output_->is_open())
+	{
+		return false;
+	}
+	if (line_.length() > 0)
+	{
+		encoder_.encode_line(line_.c_str(), line_.length(), packed_);
+		line_.clear();
+	}
+	encoder_.get_disable_commands(packed_);
+	flush_(0);
+	bool success = !has_error_;
+	has_error_ = false;
+	return p_output_->close() && success;
+}
+
+bool meatpack_output_encoder::is_open() const
+{
+	return p_output_->is_open();
+}
+
+bool meatpack_output_encoder::write(const char* data, size_t length)
+{
+	const char* end = data + length;
+	while (data < end)
+	{
+		const char* p_line_end = static_cast<const char*>(memchr(data, '\n', end - data));
+		if (p_line_end == NULL)
+		{
+			line_.append(data, end - data);
+			break;
+		}
+		if (line_.length() > 0)
+		{
+			line_.append(data, p_line_end - data);
+			encoder_.encode_line(line_.c_str(), line_.length(), packed_);
+			line_.clear();
+		}
+		else
+		{
+			encoder_.encode_line(data, p_line_end - data, packed_);
+		}
+		data = p_line_end + 1;
+	}
+	return flush_(COMPRESSED_STREAM_BUFFER_SIZE);
+}
+
+bool meatpack_output_encoder::flush_(size_t min_size)
+{
+	if (packed_.length() == 0 || packed_.length() < min_size)
+	{
+		return !has_error_;
+	}
+	if (!p_output_->write(packed_))
+	{
+		has_error_ = true;
+	}
+	packed_.clear();
+	return !has_error_;
+}
+
+#ifdef ARC_WELDER_ZLIB
+// gzip files, read and written through zlib's gz* functions
+
+class gzip_input_decoder : public input_decoder
+{
+public:
+	gzip_input_decoder()
+	{
+		file_ = NULL;
+		has_error_ = false;
+	}
+	virtual ~gzip_input_decoder()
+	{
+		close();
+	}
+	virtual bool open(const std::string& file_path, bool)
+	{
+		close();
+		file_ = gzopen(file_path.c_str(), "rb");
+		if (file_ == NULL)
+		{
+			return false;
+		}
+		gzbuffer(file_, COMPRESSED_STREAM_BUFFER_SIZE);
+		return true;
+	}
+	virtual void close()
+	{
+		if (file_ != NULL)
+		{
+			gzclose(file_);
+			file_ = NULL;
+		}
+		has_error_ = false;
+	}
+	virtual bool is_open() const
+	{
+		return file_ != NULL;
+	}
+	virtual size_t read(char* buffer, size_t size)
+	{
+		int bytes_read = gzread(file_, buffer, static_cast<unsigned int>(size));
+		if (bytes_read < 0)
+		{
+			has_error_ = true;
+			return 0;
+		}
+		return static_cast<size_t>(bytes_read);
+	}
+	virtual bool has_error() const
+	{
+		return has_error_;
+	}
+	virtual long get_source_position() const
+	{
+		return static_cast<long>(gzoffset(file_));
+	}
+private:
+	gzFile file_;
+	bool has_error_;
+};
+
+class gzip_output_encoder : public output_encoder
+{
+public:
+	gzip_output_encoder(int num_threads)
+	{
+		file_ = NULL;
+		block_file_ = NULL;
+		num_threads_ = num_threads;
+		has_error_ = false;
+		block_index_ = 0;
+		has_members_ = false;
+	}
+	virtual ~gzip_output_encoder()
+	{
+		close();
+	}
+	virtual bool open(const std::string& file_path)
+	{
+		close();
+		if (num_threads_ > 0)
+		{
+			block_file_ = fopen(file_path.c_str(), "wb");
+			if (block_file_ == NULL)
+			{
+				return false;
+			}
+			blocks_.assign(num_threads_, std::string());
+			compressed_blocks_.assign(num_threads_, std::string());
+			compressing_blocks_.assign(num_threads_, std::string());
+			block_results_.assign(num_threads_, 1);
+			block_index_ = 0;
+			has_members_ = false;
+			return true;
+		}
+		file_ = gzopen(file_path.c_str(), "wb");
+		if (file_ == NULL)
+		{
+			return false;
+		}
+		gzbuffer(file_, COMPRESSED_STREAM_BUFFER_SIZE);
+		return true;
+	}
+	virtual bool close()
+	{
+		if (block_file_ != NULL)
+		{
+			// Compress whatever is left, then wait for every block to be written
+			bool success = compress_blocks_() && write_compressed_blocks_() && !has_error_;
+			if (fclose(block_file_) != 0)
+			{
+				success = false;
+			}
+			block_file_ = NULL;
+			has_error_ = false;
+			return success;
+		}
+		if (file_ == NULL)
+		{
+			return false;
+		}
+		bool success = !has_error_ && gzclose(file_) == Z_OK;
+		file_ = NULL;
+		has_error_ = false;
+		return success;
+	}
+	virtual bool is_open() const
+	{
+		return file_ != NULL || block_file_ != NULL;
+	}
+	virtual bool write(const char* data, size_t length)
+	{
+		if (length == 0)
+		{
+			return true;
+		}
+		if (block_file_ != NULL)
+		{
+			return write_blocks_(data, length);
+		}
+		if (gzwrite(file_, data, static_cast<unsigned int>(length)) == 0)
+		{
+			has_error_ = true;
+			return false;
+		}
+		return true;
+	}
+	using output_encoder::write;
+private:
+	// With more than 0 threads, the data is split into blocks that are compressed at the same time, each into its own
+	// gzip member.  Concatenated members are a valid gzip file.  The blocks are compressed while the next ones are
+	// filled, and written in order.
+	bool write_blocks_(const char* data, size_t length)
+	{
+		if (has_error_)
+		{
+			return false;
+		}
+		while (length > 0)
+		{
+			if (blocks_[block_index_].length() == COMPRESSED_STREAM_BUFFER_SIZE)
+			{
+				block_index_++;
+				if (block_index_ == blocks_.size() && !compress_blocks_())
+				{
+					return false;
+				}
+			}
+			std::string& block = blocks_[block_index_];
+			size_t bytes_to_copy = COMPRESSED_STREAM_BUFFER_SIZE - block.length();
+			if (bytes_to_copy > length)
+			{
+				bytes_to_copy = length;
+			}
+			block.append(data, bytes_to_copy);
+			data += bytes_to_copy;
+			length -= bytes_to_copy;
+		}
+		return true;
+	}
+	// Writes the blocks that are being compressed, then starts compressing the filled blocks.
+	bool compress_blocks_()
+	{
+		if (!write_compressed_blocks_())
+		{
+			return false;
+		}
+		compressing_blocks_.swap(blocks_);
+		for (size_t index = 0; index < compressing_blocks_.size(); index++)
+		{
+			blocks_[index].clear();
+			// An empty file still needs one member to be a valid gzip file
+			if (compressing_blocks_[index].length() > 0 || !has_members_)
+			{
+				has_members_ = true;
+				threads_.push_back(std::thread(compress_block_, std::cref(compressing_blocks_[index]), std::ref(compressed_blocks_[index]), std::ref(block_results_[index])));
+			}
+		}
+		block_index_ = 0;
+		return true;
+	}
+	// Waits for the blocks that are being compressed and writes them in order.
+	bool write_compressed_blocks_()
+	{
+		for (size_t index = 0; index < threads_.size(); index++)
+		{
+			threads_[index].join();
+		}
+		threads_.clear();
+		for (size_t index = 0; index < compressed_blocks_.size(); index++)
+		{
+			std::string& compressed_block = compressed_blocks_[index];
+			if (!block_results_[index] || fwrite(compressed_block.c_str(), 1, compressed_block.length(), block_file_) != compressed_block.length())
+			{
+				has_error_ = true;
+			}
+			compressed_block.clear();
+			block_results_[index] = 1;
+		}
+		return !has_error_;
+	}
+	static void compress_block_(const std::string& block, std::string& compressed_block, char& result)
+	{
+		result = 0;
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		// 16 is added to the window bits to write a gzip header and trailer
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return;
+		}
+		compressed_block.resize(deflateBound(&stream, static_cast<uLong>(block.length())));
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.c_str()));
+		stream.avail_in = static_cast<uInt>(block.length());
+		stream.next_out = reinterpret_cast<Bytef*>(&compressed_block[0]);
+		stream.avail_out = static_cast<uInt>(compressed_block.length());
+		if (deflate(&stream, Z_FINISH) == Z_STREAM_END)
+		{
+			compressed_block.resize(stream.total_out);
+			result = 1;
+		}
+		deflateEnd(&stream);
+	}
+	gzFile file_;
+	FILE* block_file_;
+	int num_threads_;
+	bool has_error_;
+	std::vector<std::string> blocks_;
+	size_t block_index_;
+	bool has_members_;
+	std::vector<std::string> compressing_blocks_;
+	std::vector<std::string> compressed_blocks_;
+	// 1 if the block was compressed.  char rather than bool, since every thread writes its own element.
+	std::vector<char> block_results_;
+	std::vector<std::thread> threads_;
+};
+#endif
+
+#ifdef ARC_WELDER_ZSTD
+// zstandard files, streamed through the ZSTD_*Stream functions
+
+class zstd_input_decoder : public input_decoder
+{
+public:
+	zstd_input_decoder()
+	{
+		file_ = NULL;
+		context_ = NULL;
+		buffer_size_ = ZSTD_DStreamInSize();
+		buffer_ = static_cast<char*>(malloc(buffer_size_));
+		position_ = 0;
+		is_eof_ = false;
+		has_error_ = false;
+		input_.src = buffer_;
+		input_.size = 0;
+		input_.pos = 0;
+	}
+	virtual ~zstd_input_decoder()
+	{
+		close();
+		free(buffer_);
+	}
+	virtual bool open(const std::string& file_path, bool)
+	{
+		close();
+		if (buffer_ == NULL)
+		{
+			return false;
+		}
+		file_ = fopen(file_path.c_str(), "rb");
+		if (file_ == NULL)
+		{
+			return false;
+		}
+		context_ = ZSTD_createDCtx();
+		if (context_ == NULL)
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+	virtual void close()
+	{
+		if (context_ != NULL)
+		{
+			ZSTD_freeDCtx(context_);
+			context_ = NULL;
+		}
+		if (file_ != NULL)
+		{
+			fclose(file_);
+			file_ = NULL;
+		}
+		position_ = 0;
+		is_eof_ = false;
+		has_error_ = false;
+		input_.size = 0;
+		input_.pos = 0;
+	}
+	virtual bool is_open() const
+	{
+		return file_ != NULL;
+	}
+	virtual size_t read(char* buffer, size_t size)
+	{
+		ZSTD_outBuffer output = { buffer, size, 0 };
+		while (output.pos < output.size)
+		{
+			if (input_.pos == input_.size && !is_eof_)
+			{
+				input_.size = fread(buffer_, 1, buffer_size_, file_);
+				input_.pos = 0;
+				position_ += static_cast<long>(input_.size);
+				is_eof_ = input_.size == 0;
+			}
+			const size_t previous_output_position = output.pos;
+			if (ZSTD_isError(ZSTD_decompressStream(context_, &output, &input_)))
+			{
+				has_error_ = true;
+				break;
+			}
+			// Once the file is read, keep going only while the decoder is still flushing data
+			if (is_eof_ && output.pos == previous_output_position)
+			{
+				break;
+			}
+		}
+		return output.pos;
+	}
+	virtual long get_source_position() const
+	{
+		return position_;
+	}
+	virtual bool has_error() const
+	{
+		return has_error_;
+	}
+private:
+	FILE* file_;
+	ZSTD_DCtx* context_;
+	char* buffer_;
+	size_t buffer_size_;
+	ZSTD_inBuffer input_;
+	long position_;
+	bool is_eof_;
+	bool has_error_;
+};
+
+class zstd_output_encoder : public output_encoder
+{
+public:
+	zstd_output_encoder(int num_threads)
+	{
+		file_ = NULL;
+		context_ = NULL;
+		num_threads_ = num_threads;
+		has_error_ = false;
+		input_size_ = 0;
+		// Lines are collected in the input buffer and compressed in blocks
+		input_buffer_ = static_cast<char*>(malloc(COMPRESSED_STREAM_BUFFER_SIZE));
+		output_buffer_size_ = ZSTD_CStreamOutSize();
+		output_buffer_ = static_cast<char*>(malloc(output_buffer_size_));
+	}
+	virtual ~zstd_output_encoder()
+	{
+		close();
+		free(input_buffer_);
+		free(output_buffer_);
+	}
+	virtual bool open(const std::string& file_path)
+	{
+		close();
+		if (input_buffer_ == NULL || output_buffer_ == NULL)
+		{
+			return false;
+		}
+		file_ = fopen(file_path.c_str(), "wb");
+		if (file_ == NULL)
+		{
+			return false;
+		}
+		context_ = ZSTD_createCCtx();
+		if (context_ == NULL)
+		{
+			fclose(file_);
+			file_ = NULL;
+			return false;
+		}
+		ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+		if (num_threads_ > 0)
+		{
+			// This fails if libzstd was built without thread support, in which case compression stays on this thread.
+			ZSTD_CCtx_setParameter(context_, ZSTD_c_nbWorkers, num_threads_);
+		}
+		return true;
+	}
+	virtual bool close()
+	{
+		if (file_ == NULL)
+		{
+			return false;
+		}
+		bool success = compress_(ZSTD_e_end) && !has_error_;
+		ZSTD_freeCCtx(context_);
+		context_ = NULL;
+		if (fclose(file_) != 0)
+		{
+			success = false;
+		}
+		file_ = NULL;
+		has_error_ = false;
+		input_size_ = 0;
+		return success;
+	}
+	virtual bool is_open() const
+	{
+		return file_ != NULL;
+	}
+	virtual bool write(const char* data, size_t length)
+	{
+		while (length > 0)
+		{
+			if (input_size_ == COMPRESSED_STREAM_BUFFER_SIZE && !compress_(ZSTD_e_continue))
+			{
+				return false;
+			}
+			size_t bytes_to_copy = COMPRESSED_STREAM_BUFFER_SIZE - input_size_;
+			if (bytes_to_copy > length)
+			{
+				bytes_to_copy = length;
+			}
+			memcpy(input_buffer_ + input_size_, data, bytes_to_copy);
+			input_size_ += bytes_to_copy;
+			data += bytes_to_copy;
+			length -= bytes_to_copy;
+		}
+		return true;
+	}
+	using output_encoder::write;
+private:
+	// Compresses the input buffer and writes the compressed data.  ZSTD_e_end also finishes the frame.
+	bool compress_(ZSTD_EndDirective directive)
+	{
+		if (has_error_)
+		{
+			return false;
+		}
+		ZSTD_inBuffer input = { input_buffer_, input_size_, 0 };
+		bool is_finished = false;
+		while (!is_finished)
+		{
+			ZSTD_outBuffer output = { output_buffer_, output_buffer_size_, 0 };
+			const size_t remaining = ZSTD_compressStream2(context_, &output, &input, directive);
+			if (ZSTD_isError(remaining) || fwrite(output_buffer_, 1, output.pos, file_) != output.pos)
+			{
+				has_error_ = true;
+				return false;
+			}
+			is_finished = directive == ZSTD_e_end ? remaining == 0 : input.pos == input.size;
+		}
+		input_size_ = 0;
+		return true;
+	}
+	FILE* file_;
+	ZSTD_CCtx* context_;
+	int num_threads_;
+	bool has_error_;
+	char* input_buffer_;
+	size_t input_size_;
+	char* output_buffer_;
+	size_t output_buffer_size_;
+};
+#endif
+
+// Factories
+
+compression_type input_decoder::get_compression_type(const std::string& file_path)
+{
+	unsigned char magic[4];
+	FILE* file = fopen(file_path.c_str(), "rb");
+	if (file == NULL)
+	{
+		return compression_none;
+	}
+	size_t bytes_read = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+	if (bytes_read >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+	{
+		return compression_gzip;
+	}
+	if (bytes_read == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+	{
+		return compression_zstd;
+	}
+	if (bytes_read == 4 && memcmp(magic, BGCODE_MAGIC, 4) == 0)
+	{
+		return compression_bgcode;
+	}
+	return compression_none;
+}
+
+bool input_decoder::is_supported(compression_type type)
+{
+	switch (type)
+	{
+	case compression_none:
+	case compression_bgcode:
+		return true;
+#ifdef ARC_WELDER_ZLIB
+	case compression_gzip:
+		return true;
+#endif
+#ifdef ARC_WELDER_ZSTD
+	case compression_zstd:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+input_decoder* input_decoder::create(compression_type type)
+{
+	switch (type)
+	{
+	case compression_none:
+		return new file_input_decoder();
+	case compression_bgcode:
+		return new bgcode_input_decoder();
+#ifdef ARC_WELDER_ZLIB
+	case compression_gzip:
+		return new gzip_input_decoder();
+#endif
+#ifdef ARC_WELDER_ZSTD
+	case compression_zstd:
+		return new zstd_input_decoder();
+#endif
+	default:
+		return NULL;
+	}
+}
+
+compression_type output_encoder::get_compression_type(const std::string& file_path)
+{
+	if (ends_with(file_path, ".gz"))
+	{
+		return compression_gzip;
+	}
+	if (ends_with(file_path, ".zst"))
+	{
+		return compression_zstd;
+	}
+	if (ends_with(file_path, ".bgcode"))
+	{
+		return compression_bgcode;
+	}
+	return compression_none;
+}
+
+bool output_encoder::is_supported(compression_type type)
+{
+	return input_decoder::is_supported(type);
+}
+
+output_encoder* output_encoder::create(compression_type type, int num_threads, bool meatpack)
+{
+#if !defined(ARC_WELDER_ZLIB) && !defined(ARC_WELDER_ZSTD)
+	// Only gzip and zstd targets are compressed on threads, and neither is supported by this build
+	static_cast<void>(num_threads);
+#endif
+	output_encoder* p_output = NULL;
+	switch (type)
+	{
+	case compression_none:
+		p_output = new file_output_encoder(meatpack);
+		break;
+	case compression_bgcode:
+		if (meatpack)
+		{
+			return NULL;
+		}
+		return new bgcode_output_encoder();
+#ifdef ARC_WELDER_ZLIB
+	case compression_gzip:
+		p_output = new gzip_output_encoder(num_threads);
+		break;
+#endif
+#ifdef ARC_WELDER_ZSTD
+	case compression_zstd:
+		p_output = new zstd_output_encoder(num_threads);
+		break;
+#endif
+	default:
+		return NULL;
+	}
+	if (meatpack)
+	{
+		return new meatpack_output_encoder(p_output);
+	}
+	return p_output;
+}
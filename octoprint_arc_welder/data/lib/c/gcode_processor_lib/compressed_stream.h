@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <cstdio>
+#include "meatpack.h"
+
+// Compressed gcode support is optional, and depends on the libraries found when the extension is built.
+// ARC_WELDER_ZLIB enables gzip (.gz) and ARC_WELDER_ZSTD enables zstandard (.zst).  Binary gcode (.bgcode) is always
+// supported, but reading deflate compressed bgcode blocks requires ARC_WELDER_ZLIB.
+
+// The size of the buffers used to read and write compressed data
+#define COMPRESSED_STREAM_BUFFER_SIZE 262144
+// The default number of compression threads.  0 compresses on the calling thread.  gzip targets are split into blocks
+// that are compressed on that many threads, zstd targets use that many zstd workers.
+#define DEFAULT_COMPRESSION_THREADS 0
+
+enum compression_type { compression_none, compression_gzip, compression_zstd, compression_bgcode };
+
+// Reads a file, decompressing it if necessary.
+class input_decoder
+{
+public:
+	virtual ~input_decoder() {}
+	virtual bool open(const std::string& file_path, bool binary) = 0;
+	virtual void close() = 0;
+	virtual bool is_open() const = 0;
+	// Reads up to size decompressed bytes into the buffer.  Returns the number of bytes read, or 0 at the end of the file.
+	virtual size_t read(char* buffer, size_t size) = 0;
+	// The number of bytes read from the file itself, which is less than the decompressed size for compressed files.
+	virtual long get_source_position() const = 0;
+	// Only uncompressed files can seek.
+	virtual bool seek(long) { return false; }
+	// True if the file is corrupt, which ends the read early.
+	virtual bool has_error() const { return false; }
+	// Detects the compression type from the first bytes of the file.
+	static compression_type get_compression_type(const std::string& file_path);
+	static bool is_supported(compression_type type);
+	// Returns NULL if the compression type is not supported by this build.  The caller must delete the decoder.
+	static input_decoder* create(compression_type type);
+};
+
+// Writes a file, compressing it if necessary.
+class output_encoder
+{
+public:
+	virtual ~output_encoder() {}
+	// Encoders that carry metadata over from the source, like bgcode, read it from this file when opened.
+	virtual void set_source_file_path(const std::string&) {}
+	virtual bool open(const std::string& file_path) = 0;
+	// Flushes any buffered data and closes the file.  Returns false if anything could not be written.
+	virtual bool close() = 0;
+	virtual bool is_open() const = 0;
+	virtual bool write(const char* data, size_t length) = 0;
+	bool write(const std::string& data)
+	{
+		return write(data.c_str(), data.length());
+	}
+	// Gets the compression type from the file extension (.gz, .zst or .bgcode).
+	static compression_type get_compression_type(const std::string& file_path);
+	static bool is_supported(compression_type type);
+	// Returns NULL if the compression type is not supported by this build.  The caller must delete the encoder.
+	// When meatpack is true the gcode is packed before it is compressed.  bgcode can't be packed this way.
+	static output_encoder* create(compression_type type, int num_threads = DEFAULT_COMPRESSION_THREADS, bool meatpack = false);
+};
+
+class file_input_decoder : public input_decoder
+{
+public:
+	file_input_decoder();
+	virtual ~file_input_decoder();
+	virtual bool open(const std::string& file_path, bool binary);
+	virtual void close();
+	virtual bool is_open() const;
+	virtual size_t read(char* buffer, size_t size);
+	virtual long get_source_position() const;
+	virtual bool seek(long position);
+private:
+	file_input_decoder(const file_input_decoder& source);
+	FILE* file_;
+	long position_;
+};
+
+class file_output_encoder : public output_encoder
+{
+public:
+	// Binary mode keeps line endings from being translated, which is needed for packed output on Windows.
+	file_output_encoder(bool binary = false);
+	virtual ~file_output_encoder();
+	virtual bool open(const std::string& file_path);
+	virtual bool close();
+	virtual bool is_open() const;
+	virtual bool write(const char* data, size_t length);
+	using output_encoder::write;
+private:
+	file_output_encoder(const file_output_encoder& source);
+	FILE* file_;
+	bool binary_;
+	bool has_error_;
+};
+
+// Keeps everything written in memory instead of writing a file, so gcode can be welded as it is streamed.
+class string_output_encoder : public output_encoder
+{
+public:
+	string_output_encoder();
+	virtual ~string_output_encoder();
+	// The file path is ignored
+	virtual bool open(const std::string& file_path);
+	virtual bool close();
+	virtual bool is_open() const;
+	virtual bool write(const char* data, size_t length);
+	using output_encoder::write;
+	// Appends everything written since the last call to output.
+	void take(std::string& output);
+private:
+	string_output_encoder(const string_output_encoder& source);
+	std::string buffer_;
+	bool is_open_;
+};
+
+// Packs the gcode with MeatPack before passing it to another encoder, which halves the size of most moves.
+// The packed file is meant to be streamed to the printer as is, so it starts and ends with the commands that
+// switch MeatPack on and off.
+class meatpack_output_encoder : public output_encoder
+{
+public:
+	// Takes ownership of the encoder that writes the packed data.
+	meatpack_output_encoder(output_encoder* p_output, bool no_spaces = true);
+	virtual ~meatpack_output_encoder();
+	virtual void set_source_file_path(const std::string& source_file_path);
+	virtual bool open(const std::string& file_path);
+	virtual bool close();
+	virtual bool is_open() const;
+	virtual bool write(const char* data, size_t length);
+	using output_encoder::write;
+private:
+	meatpack_output_encoder(const meatpack_output_encoder& source);
+	bool flush_(size_t min_size);
+	output_encoder* p_output_;
+	meatpack_encoder encoder_;
+	// The unfinished line, and the packed lines waiting to be written
+	std::string line_;
+	std::string packed_;
+	bool has_error_;
+};
@@ -23,6 +23,7 @@
 #include "gcode_parser.h"
 #include "utilities.h"
 #include <cmath>
+#include <cstring>
 #include <iostream>
 gcode_parser::gcode_parser()
 {
@@ -155,24 +156,30 @@ bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command,
 
 	bool is_text_only_parameter = text_only_functions_.find(command.command) != text_only_functions_.end();
 
-	while (true)
+	if (preserve_format)
 	{
-		char cur_char = *p_gcode;
-		if (cur_char == '\0' || cur_char == ';')
-			break;
-		else if (cur_char > 32 || (cur_char == ' ' && has_seen_character))
-		{
-			if (!preserve_format && !is_text_only_parameter && (cur_char >= 'a' && cur_char <= 'z'))
-				command.gcode.push_back(cur_char - 32);
-			else
-				command.gcode.push_back(cur_char);
-			has_seen_character = true;
-		}
-		else if (preserve_format)
+		// Everything before the comment is copied as is, so find the comment and copy the whole block at once.
+		const size_t length = strcspn(p_gcode, ";");
+		command.gcode.append(p_gcode, length);
+		p_gcode += length;
+	}
+	else
+	{
+		while (true)
 		{
-			command.gcode.push_back(cur_char);
+			char cur_char = *p_gcode;
+			if (cur_char == '\0' || cur_char == ';')
+				break;
+			else if (cur_char > 32 || (cur_char == ' ' && has_seen_character))
+			{
+				if (!is_text_only_parameter && (cur_char >= 'a' && cur_char <= 'z'))
+					command.gcode.push_back(cur_char - 32);
+				else
+					command.gcode.push_back(cur_char);
+				has_seen_character = true;
+			}
+			p_gcode++;
 		}
-		p_gcode++;
 	}
 	if (!preserve_format){
 		command.gcode = utilities::rtrim(command.gcode);
@@ -422,9 +429,21 @@ bool gcode_parser::try_extract_unsigned_long(char ** p_p_gcode, unsigned long *
 	return found_numbers;
 }
 
+// Every power of ten up to 10^22 is exactly representable as a double
+static const double exact_powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_EXACT_POWER_OF_TEN 22
+// Every integer up to 2^53 is exactly representable as a double
+#define MAX_EXACT_MANTISSA 9007199254740992ULL
+
 double gcode_parser::ten_pow(unsigned short n) {
-	double r = 1.0;
+	if (n <= MAX_EXACT_POWER_OF_TEN)
+		return exact_powers_of_ten[n];
 
+	double r = exact_powers_of_ten[MAX_EXACT_POWER_OF_TEN];
+	n -= MAX_EXACT_POWER_OF_TEN;
 	while (n > 0) {
 		r *= 10;
 		--n;
@@ -437,8 +456,12 @@ bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) cons
 {
 	char * p = *p_p_gcode;
 	bool neg = false;
-	double r = 0;
 	bool found_numbers = false;
+	// All of the digits are accumulated into a single integer mantissa, which is then divided by the
+	// number of decimal places.  When both are exact, this is a single correctly rounded division.
+	unsigned long long mantissa = 0;
+	double r = 0;
+	unsigned short n = 0;
 	// skip any leading whitespace
 	while (*p == ' ')
 		++p;
@@ -462,36 +485,44 @@ bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) cons
 		if (*p != ' ')
 		{
 			found_numbers = true;
+			mantissa = (mantissa * 10) + (*p - '0');
 			r = (r*10.0) + (*p - '0');
 		}
 		++p;
 	}
 	if (*p == '.') {
-		double f = 0.0;
-		unsigned short n = 0;
 		++p;
 		while ((*p >= '0' && *p <= '9') || *p == ' ') {
 			if (*p != ' ')
 			{
 				found_numbers = true;
-				f = (f*10.0) + (*p - '0');
+				mantissa = (mantissa * 10) + (*p - '0');
+				r = (r*10.0) + (*p - '0');
 				++n;
 			}
 			++p;
 		}
-		//r += f / pow(10.0, n);
-		r += f / ten_pow(n);
 	}
-	if (neg) {
-		r = -r;
+	if (!found_numbers)
+	{
+		return false;
 	}
-	if (found_numbers)
+	// The mantissa may have overflowed if there are too many digits, use the double in that case.
+	if (r < static_cast<double>(MAX_EXACT_MANTISSA) && n <= MAX_EXACT_POWER_OF_TEN)
 	{
-		*p_double = r;
-		*p_p_gcode = p;
+		r = static_cast<double>(mantissa) / exact_powers_of_ten[n];
+	}
+	else if (n > 0)
+	{
+		r /= ten_pow(n);
+	}
+	if (neg) {
+		r = -r;
 	}
+	*p_double = r;
+	*p_p_gcode = p;
 	
-	return found_numbers;
+	return true;
 }
 
 bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter)
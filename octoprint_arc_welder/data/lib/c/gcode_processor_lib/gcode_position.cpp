@@ -424,7 +424,7 @@ void gcode_position::add_position(position& pos)
 		num_pos_++;
 }
 
-void gcode_position::add_position(parsed_command& cmd)
+void gcode_position::add_position(const parsed_command& cmd)
 {
 	const int prev_pos = cur_pos_;
 	cur_pos_ = (cur_pos_+1) % position_buffer_size_;
@@ -467,7 +467,7 @@ position * gcode_position::get_previous_position_ptr()
 	return get_position_ptr(1);
 }
 
-void gcode_position::update(parsed_command& command, const long file_line_number, const long gcode_number, const long file_position)
+void gcode_position::update(const parsed_command& command, const long file_line_number, const long gcode_number, const long file_position)
 {
 	
 	/*if (command.is_empty)
@@ -877,7 +877,7 @@ void gcode_position::update_position(
 
 }
 
-void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
+void gcode_position::process_g0_g1(position* pos, const parsed_command& cmd)
 {
 	bool update_x = false;
 	bool update_y = false;
@@ -921,14 +921,16 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 	update_position(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, false, true);
 }
 
-void gcode_position::process_g2(position* pos, parsed_command& cmd)
+void gcode_position::process_g2(position* pos, const parsed_command& cmd)
 {
 	bool update_x = false;
 	bool update_y = false;
+	bool update_z = false;
 	bool update_e = false;
 	bool update_f = false;
 	double x = 0;
 	double y = 0;
+	double z = 0;
 	double e = 0;
 	double f = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
@@ -944,6 +946,12 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
+		else if (p_cur_param.name == "Z")
+		{
+			// Helical arcs
+			update_z = true;
+			z = p_cur_param.double_value;
+		}
 		else if (p_cur_param.name == "E")
 		{
 			update_e = true;
@@ -955,15 +963,15 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
 			f = p_cur_param.double_value;
 		}
 	}
-	update_position(pos, x, update_x, y, update_y, 0, false, e, update_e, f, update_f, false, true);
+	update_position(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, false, true);
 }
 
-void gcode_position::process_g3(position* pos, parsed_command& cmd)
+void gcode_position::process_g3(position* pos, const parsed_command& cmd)
 {
 	return process_g2(pos, cmd);
 }
 
-void gcode_position::process_g10(position* pos, parsed_command& cmd)
+void gcode_position::process_g10(position* pos, const parsed_command& cmd)
 {
 	// Take 0 based extruder parameter in account
 	int p = 0;
@@ -1054,22 +1062,22 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 	// Todo: add firmware retract here
 }
 
-void gcode_position::process_g11(position* pos, parsed_command& cmd)
+void gcode_position::process_g11(position* pos, const parsed_command& cmd)
 {
 	// Todo: Fix G11
 }
 
-void gcode_position::process_g20(position* pos, parsed_command& cmd)
+void gcode_position::process_g20(position* pos, const parsed_command& cmd)
 {
 
 }
 
-void gcode_position::process_g21(position* pos, parsed_command& cmd)
+void gcode_position::process_g21(position* pos, const parsed_command& cmd)
 {
 
 }
 
-void gcode_position::process_g28(position* pos, parsed_command& cmd)
+void gcode_position::process_g28(position* pos, const parsed_command& cmd)
 {
 	bool has_x = false;
 	bool has_y = false;
@@ -1133,7 +1141,7 @@ void gcode_position::process_g28(position* pos, parsed_command& cmd)
 	// todo: set error flag on else
 }
 
-void gcode_position::process_g90(position* pos, parsed_command& cmd)
+void gcode_position::process_g90(position* pos, const parsed_command& cmd)
 {
 	// Set xyz to absolute mode
 	if (pos->is_relative_null)
@@ -1152,7 +1160,7 @@ void gcode_position::process_g90(position* pos, parsed_command& cmd)
 
 }
 
-void gcode_position::process_g91(position* pos, parsed_command& cmd)
+void gcode_position::process_g91(position* pos, const parsed_command& cmd)
 {
 	// Set XYZ axis to relative mode
 	if (pos->is_relative_null)
@@ -1170,7 +1178,7 @@ void gcode_position::process_g91(position* pos, parsed_command& cmd)
 	}
 }
 
-void gcode_position::process_g92(position* pos, parsed_command& cmd)
+void gcode_position::process_g92(position* pos, const parsed_command& cmd)
 {
 	// Set position offset
 	bool update_x = false;
@@ -1273,7 +1281,7 @@ void gcode_position::process_g92(position* pos, parsed_command& cmd)
 	}
 }
 
-void gcode_position::process_m82(position* pos, parsed_command& cmd)
+void gcode_position::process_m82(position* pos, const parsed_command& cmd)
 {
 	// Set extrder mode to absolute
 	if (pos->is_extruder_relative_null)
@@ -1282,7 +1290,7 @@ void gcode_position::process_m82(position* pos, parsed_command& cmd)
 	pos->is_extruder_relative = false;
 }
 
-void gcode_position::process_m83(position* pos, parsed_command& cmd)
+void gcode_position::process_m83(position* pos, const parsed_command& cmd)
 {
 	// Set extrder mode to relative
 	if (pos->is_extruder_relative_null)
@@ -1291,17 +1299,17 @@ void gcode_position::process_m83(position* pos, parsed_command& cmd)
 	pos->is_extruder_relative = true;
 }
 
-void gcode_position::process_m207(position* pos, parsed_command& cmd)
+void gcode_position::process_m207(position* pos, const parsed_command& cmd)
 {
 	// Todo: impemente firmware retract
 }
 
-void gcode_position::process_m208(position* pos, parsed_command& cmd)
+void gcode_position::process_m208(position* pos, const parsed_command& cmd)
 {
 	// Todo: implement firmware retract
 }
 
-void gcode_position::process_m218(position* pos, parsed_command& cmd)
+void gcode_position::process_m218(position* pos, const parsed_command& cmd)
 {
 	
 	// Set hotend offsets
@@ -1387,12 +1395,12 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 	}
 }
 
-void gcode_position::process_m563(position* pos, parsed_command& cmd)
+void gcode_position::process_m563(position* pos, const parsed_command& cmd)
 {
 	// Todo:  Work on this command, which defines tools and will affect which tool is selected.
 }
 
-void gcode_position::process_t(position* pos, parsed_command& cmd)
+void gcode_position::process_t(position* pos, const parsed_command& cmd)
 {
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
@@ -129,12 +129,12 @@ struct gcode_position_args {
 class gcode_position
 {
 public:
-	typedef void(gcode_position::*pos_function_type)(position*, parsed_command&);
+	typedef void(gcode_position::*pos_function_type)(position*, const parsed_command&);
 	gcode_position(gcode_position_args args);
 	gcode_position();
 	virtual ~gcode_position();
 
-	void update(parsed_command &command, long file_line_number, long gcode_number, const long file_position);
+	void update(const parsed_command& command, long file_line_number, long gcode_number, const long file_position);
 	void update_position(position *position, double x, bool update_x, double y, bool update_y, double z, bool update_z, double e, bool update_e, double f, bool update_f, bool force, bool is_g1_g0) const;
 	void undo_update();
 	position * undo_update(int num_updates);
@@ -153,7 +153,7 @@ private:
 	position* positions_;
 	int cur_pos_;
 	int num_pos_;
-	void add_position(parsed_command &);
+	void add_position(const parsed_command&);
 	void add_position(position &);
 	bool autodetect_position_;
 	double priming_height_;
@@ -194,24 +194,24 @@ private:
 	
 	std::map<std::string, pos_function_type> get_gcode_functions();
 	/// Process Gcode Command Functions
-	void process_g0_g1(position*, parsed_command&);
-	void process_g2(position*, parsed_command&);
-	void process_g3(position*, parsed_command&);
-	void process_g10(position*, parsed_command&);
-	void process_g11(position*, parsed_command&);
-	void process_g20(position*, parsed_command&);
-	void process_g21(position*, parsed_command&);
-	void process_g28(position*, parsed_command&);
-	void process_g90(position*, parsed_command&);
-	void process_g91(position*, parsed_command&);
-	void process_g92(position*, parsed_command&);
-	void process_m82(position*, parsed_command&);
-	void process_m83(position*, parsed_command&);
-	void process_m207(position*, parsed_command&);
-	void process_m208(position*, parsed_command&);
-	void process_m218(position*, parsed_command&);
-	void process_m563(position*, parsed_command&);
-	void process_t(position*, parsed_command&);
+	void process_g0_g1(position*, const parsed_command&);
+	void process_g2(position*, const parsed_command&);
+	void process_g3(position*, const parsed_command&);
+	void process_g10(position*, const parsed_command&);
+	void process_g11(position*, const parsed_command&);
+	void process_g20(position*, const parsed_command&);
+	void process_g21(position*, const parsed_command&);
+	void process_g28(position*, const parsed_command&);
+	void process_g90(position*, const parsed_command&);
+	void process_g91(position*, const parsed_command&);
+	void process_g92(position*, const parsed_command&);
+	void process_m82(position*, const parsed_command&);
+	void process_m83(position*, const parsed_command&);
+	void process_m207(position*, const parsed_command&);
+	void process_m208(position*, const parsed_command&);
+	void process_m218(position*, const parsed_command&);
+	void process_m563(position*, const parsed_command&);
+	void process_t(position*, const parsed_command&);
 
 	gcode_comment_processor comment_processor_;
 	void delete_retraction_lengths_();
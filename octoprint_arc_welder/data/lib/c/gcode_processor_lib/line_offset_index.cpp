@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "line_offset_index.h"
+#include "line_reader.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+line_offset_index::line_offset_index()
+{
+}
+
+line_offset_index::~line_offset_index()
+{
+}
+
+void line_offset_index::clear()
+{
+	line_offsets_.clear();
+	layer_start_lines_.clear();
+	layers_.clear();
+}
+
+bool line_offset_index::build(const std::string& file_path)
+{
+	clear();
+	line_reader reader;
+	if (!reader.open(file_path, true))
+	{
+		return false;
+	}
+	const char* line;
+	size_t line_length;
+	long offset = 0;
+	while (reader.read_line(&line, &line_length))
+	{
+		line_offsets_.push_back(offset);
+		offset = reader.get_position();
+	}
+	reader.close();
+	return true;
+}
+
+void line_offset_index::add_line(long offset)
+{
+	line_offsets_.push_back(offset);
+}
+
+void line_offset_index::add_layer_change(long line_number, long layer)
+{
+	layer_start_lines_.push_back(line_number);
+	layers_.push_back(layer);
+}
+
+long line_offset_index::get_num_lines() const
+{
+	return static_cast<long>(line_offsets_.size());
+}
+
+long line_offset_index::get_line_offset(long line_number) const
+{
+	if (line_number < 1 || line_number > static_cast<long>(line_offsets_.size()))
+	{
+		return -1;
+	}
+	return line_offsets_[line_number - 1];
+}
+
+long line_offset_index::get_line_number(long offset) const
+{
+	// Find the last line that starts at or before the offset
+	std::vector<long>::const_iterator it = std::upper_bound(line_offsets_.begin(), line_offsets_.end(), offset);
+	if (it == line_offsets_.begin())
+	{
+		return -1;
+	}
+	return static_cast<long>(it - line_offsets_.begin());
+}
+
+long line_offset_index::get_layer(long line_number) const
+{
+	std::vector<long>::const_iterator it = std::upper_bound(layer_start_lines_.begin(), layer_start_lines_.end(), line_number);
+	if (it == layer_start_lines_.begin())
+	{
+		return 0;
+	}
+	return layers_[(it - layer_start_lines_.begin()) - 1];
+}
+
+long line_offset_index::get_layer_start_line(long layer) const
+{
+	for (unsigned int index = 0; index < layers_.size(); index++)
+	{
+		if (layers_[index] == layer)
+		{
+			return layer_start_lines_[index];
+		}
+	}
+	return -1;
+}
+
+// The sidecar is the magic and version, followed by the line offsets and the layer starts as 64 bit integers.
+static bool write_values(FILE* file, const std::vector<long>& values)
+{
+	const long long count = static_cast<long long>(values.size());
+	if (fwrite(&count, sizeof(count), 1, file) != 1)
+		return false;
+	for (unsigned int index = 0; index < values.size(); index++)
+	{
+		const long long value = values[index];
+		if (fwrite(&value, sizeof(value), 1, file) != 1)
+			return false;
+	}
+	return true;
+}
+
+static bool read_values(FILE* file, std::vector<long>& values)
+{
+	long long count;
+	if (fread(&count, sizeof(count), 1, file) != 1 || count < 0)
+		return false;
+	values.resize(static_cast<size_t>(count));
+	for (long long index = 0; index < count; index++)
+	{
+		long long value;
+		if (fread(&value, sizeof(value), 1, file) != 1)
+			return false;
+		values[static_cast<size_t>(index)] = static_cast<long>(value);
+	}
+	return true;
+}
+
+bool line_offset_index::save(const std::string& file_path) const
+{
+	FILE* file = fopen(file_path.c_str(), "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	const unsigned int version = LINE_OFFSET_INDEX_VERSION;
+	bool success = fwrite(LINE_OFFSET_INDEX_MAGIC, 1, 4, file) == 4
+		&& fwrite(&version, sizeof(version), 1, file) == 1
+		&& write_values(file, line_offsets_)
+		&& write_values(file, layer_start_lines_)
+		&& write_values(file, layers_);
+	success = fclose(file) == 0 && success;
+	if (!success)
+	{
+		remove(file_path.c_str());
+	}
+	return success;
+}
+
+bool line_offset_index::load(const std::string& file_path)
+{
+	clear();
+	FILE* file = fopen(file_path.c_str(), "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	char magic[4];
+	unsigned int version;
+	const bool success = fread(magic, 1, 4, file) == 4
+		&& memcmp(magic, LINE_OFFSET_INDEX_MAGIC, 4) == 0
+		&& fread(&version, sizeof(version), 1, file) == 1
+		&& version == LINE_OFFSET_INDEX_VERSION
+		&& read_values(file, line_offsets_)
+		&& read_values(file, layer_start_lines_)
+		&& read_values(file, layers_)
+		&& layer_start_lines_.size() == layers_.size();
+	fclose(file);
+	if (!success)
+	{
+		clear();
+	}
+	return success;
+}
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <vector>
+
+#define LINE_OFFSET_INDEX_MAGIC "AWLI"
+#define LINE_OFFSET_INDEX_VERSION 1
+
+// Maps the (1 based) line numbers of a gcode file to the byte offset of the start of each line, and to the layer
+// each line belongs to.  The index can be built with a single scan of the file, or one line at a time while the file
+// is being processed, and can be saved to a sidecar file so that tools can jump directly to any source line.
+class line_offset_index
+{
+public:
+	line_offset_index();
+	virtual ~line_offset_index();
+	void clear();
+	// Scans the file for line endings and records the offset of every line.  Layers are not detected.
+	bool build(const std::string& file_path);
+	// Adds the next line, which starts at the supplied offset.
+	void add_line(long offset);
+	// Records that a new layer starts at the supplied line.  Layers must be added in order.
+	void add_layer_change(long line_number, long layer);
+	long get_num_lines() const;
+	// Returns -1 if the line number is out of range.
+	long get_line_offset(long line_number) const;
+	// Gets the line containing the supplied byte offset, or -1 if the offset comes before the first line.
+	long get_line_number(long offset) const;
+	// Gets the layer of the supplied line, or 0 if no layer had started yet.
+	long get_layer(long line_number) const;
+	// Gets the first line of the supplied layer, or -1 if the layer was never started.
+	long get_layer_start_line(long layer) const;
+	bool save(const std::string& file_path) const;
+	bool load(const std::string& file_path);
+private:
+	std::vector<long> line_offsets_;
+	std::vector<long> layer_start_lines_;
+	std::vector<long> layers_;
+};
@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "line_reader.h"
+#include <cstring>
+#include <cstdlib>
+
+line_reader::line_reader(size_t buffer_size)
+{
+	p_decoder_ = NULL;
+	is_compressed_ = false;
+	buffer_size_ = buffer_size < 1 ? DEFAULT_LINE_READER_BUFFER_SIZE : buffer_size;
+	// Add an extra byte so that the last line can always be null terminated.
+	buffer_ = static_cast<char*>(malloc(buffer_size_ + 1));
+	start_ = 0;
+	end_ = 0;
+	position_ = 0;
+	is_eof_ = false;
+}
+
+line_reader::line_reader(const line_reader&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+line_reader::~line_reader()
+{
+	close();
+	free(buffer_);
+}
+
+bool line_reader::open(const std::string& file_path, bool binary)
+{
+	close();
+	const compression_type type = input_decoder::get_compression_type(file_path);
+	p_decoder_ = input_decoder::create(type);
+	if (p_decoder_ == NULL)
+	{
+		return false;
+	}
+	if (!p_decoder_->open(file_path, binary))
+	{
+		close();
+		return false;
+	}
+	is_compressed_ = type != compression_none;
+	return true;
+}
+
+void line_reader::close()
+{
+	if (p_decoder_ != NULL)
+	{
+		delete p_decoder_;
+		p_decoder_ = NULL;
+	}
+	is_compressed_ = false;
+	start_ = 0;
+	end_ = 0;
+	position_ = 0;
+	is_eof_ = false;
+}
+
+bool line_reader::is_open() const
+{
+	return p_decoder_ != NULL;
+}
+
+long line_reader::get_position() const
+{
+	return position_;
+}
+
+long line_reader::get_source_position() const
+{
+	if (is_compressed_)
+	{
+		return p_decoder_->get_source_position();
+	}
+	return position_;
+}
+
+bool line_reader::is_compressed() const
+{
+	return is_compressed_;
+}
+
+bool line_reader::has_error() const
+{
+	return p_decoder_ != NULL && p_decoder_->has_error();
+}
+
+bool line_reader::seek(long position)
+{
+	if (p_decoder_ == NULL || !p_decoder_->seek(position))
+	{
+		return false;
+	}
+	start_ = 0;
+	end_ = 0;
+	position_ = position;
+	is_eof_ = false;
+	return true;
+}
+
+bool line_reader::fill_buffer()
+{
+	// Move any partial line to the front of the buffer
+	if (start_ > 0)
+	{
+		memmove(buffer_, buffer_ + start_, end_ - start_);
+		end_ -= start_;
+		start_ = 0;
+	}
+	// The line is longer than the buffer, make room for it.
+	if (end_ == buffer_size_)
+	{
+		char* buffer = static_cast<char*>(realloc(buffer_, buffer_size_ * 2 + 1));
+		if (buffer == NULL)
+		{
+			return false;
+		}
+		buffer_ = buffer;
+		buffer_size_ *= 2;
+	}
+	size_t bytes_read = p_decoder_->read(buffer_ + end_, buffer_size_ - end_);
+	if (bytes_read == 0)
+	{
+		is_eof_ = true;
+		return false;
+	}
+	end_ += bytes_read;
+	return true;
+}
+
+bool line_reader::read_line(const char** p_line, size_t* p_length)
+{
+	if (p_decoder_ == NULL)
+	{
+		return false;
+	}
+	size_t search_start = start_;
+	while (true)
+	{
+		char* p_end = static_cast<char*>(memchr(buffer_ + search_start, '\n', end_ - search_start));
+		if (p_end != NULL)
+		{
+			*p_end = '\0';
+			*p_line = buffer_ + start_;
+			*p_length = p_end - (buffer_ + start_);
+			position_ += static_cast<long>(*p_length) + 1;
+			start_ = (p_end - buffer_) + 1;
+			return true;
+		}
+		// Only search the newly read bytes next time
+		search_start = end_ - start_;
+		if (is_eof_ || !fill_buffer())
+		{
+			break;
+		}
+	}
+	// The last line of the file may not end with a newline
+	if (start_ < end_)
+	{
+		buffer_[end_] = '\0';
+		*p_line = buffer_ + start_;
+		*p_length = end_ - start_;
+		position_ += static_cast<long>(*p_length);
+		start_ = end_;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <cstdio>
+#include "compressed_stream.h"
+
+// Read 1MB at a time.  Lines longer than the buffer grow it as needed.
+#define DEFAULT_LINE_READER_BUFFER_SIZE 1048576
+
+// Reads a file line by line through a large block buffer, finding the line endings with memchr.
+// This avoids the per character overhead of std::getline and the std::string copy for every line.
+// gzip and zstd compressed files are decompressed as they are read.
+class line_reader
+{
+public:
+	line_reader(size_t buffer_size = DEFAULT_LINE_READER_BUFFER_SIZE);
+	virtual ~line_reader();
+	// Open the file in text mode, or in binary mode if the reader needs to seek to arbitrary positions.
+	// Fails if the file is compressed and this build doesn't support the compression type.
+	bool open(const std::string& file_path, bool binary = false);
+	void close();
+	bool is_open() const;
+	// Gets the next line without the line ending.  The line is null terminated and is only valid until the next call.
+	bool read_line(const char** p_line, size_t* p_length);
+	// The number of bytes read from the file, including line endings, up to the end of the last line returned.
+	long get_position() const;
+	// The number of bytes read from the file itself.  Only differs from get_position for compressed files.
+	long get_source_position() const;
+	bool is_compressed() const;
+	// True if the file could not be read or decompressed to the end.
+	bool has_error() const;
+	// Compressed files can't seek.
+	bool seek(long position);
+private:
+	line_reader(const line_reader& source);
+	bool fill_buffer();
+	input_decoder* p_decoder_;
+	bool is_compressed_;
+	char* buffer_;
+	size_t buffer_size_;
+	size_t start_;
+	size_t end_;
+	long position_;
+	bool is_eof_;
+};
@@ -23,6 +23,7 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <sstream>
 #include <cstdarg>
 #include <stdio.h>
 #include <ctime>
@@ -37,6 +38,18 @@ static const int log_level_names_size = 7;
 static const char* log_level_names[] = {"NOSET", "VERBOSE", "DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL"};
 const static int log_level_values[LOG_LEVEL_COUNT] = { 0, 5, 10,  20,  30,  40,  50};
 
+// Logs a message only when the log level is enabled.  The message is streamed rather than concatenated, and none of it
+// is evaluated when the level is disabled, for example:  LOG_LAZY(p_logger, logger_type, DEBUG, "Gcode:" << cmd.gcode);
+#define LOG_LAZY(p_logger, logger_type, log_level, message) \
+	do { \
+		if ((p_logger)->is_log_level_enabled(logger_type, log_level)) \
+		{ \
+			std::stringstream log_lazy_stream; \
+			log_lazy_stream << message; \
+			(p_logger)->log(logger_type, log_level, log_lazy_stream.str()); \
+		} \
+	} while (0)
+
 class logger
 {
 public:
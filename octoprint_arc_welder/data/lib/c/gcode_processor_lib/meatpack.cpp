@@ -0,0 +1,268 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "meatpack.h"
+#include <cctype>
+
+static const char meatpack_characters[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.', ' ', '\n', 'G', 'X', '\0' };
+// In no spaces mode, spaces are removed and 'E' takes their place in the table
+#define MEATPACK_SPACE_INDEX 11
+#define MEATPACK_NO_SPACES_CHARACTER 'E'
+
+meatpack_decoder::meatpack_decoder()
+{
+	reset();
+}
+
+void meatpack_decoder::reset()
+{
+	is_packing_ = false;
+	is_no_spaces_ = false;
+	command_byte_count_ = 0;
+	full_character_count_ = 0;
+	pending_character_ = '\0';
+}
+
+void meatpack_decoder::decode(const char* data, size_t length, std::string& output)
+{
+	for (size_t index = 0; index < length; index++)
+	{
+		const unsigned char c = static_cast<unsigned char>(data[index]);
+		// Two command bytes in a row are followed by a command
+		if (command_byte_count_ == 2)
+		{
+			handle_command_(c);
+			command_byte_count_ = 0;
+		}
+		else if (c == MEATPACK_COMMAND_BYTE)
+		{
+			command_byte_count_++;
+		}
+		else
+		{
+			if (command_byte_count_ == 1)
+			{
+				// A single command byte is data
+				decode_byte_(MEATPACK_COMMAND_BYTE, output);
+			}
+			command_byte_count_ = 0;
+			decode_byte_(c, output);
+		}
+	}
+}
+
+void meatpack_decoder::decode_byte_(unsigned char c, std::string& output)
+{
+	if (!is_packing_)
+	{
+		output.push_back(static_cast<char>(c));
+		return;
+	}
+	if (full_character_count_ > 0)
+	{
+		output.push_back(static_cast<char>(c));
+		if (pending_character_ != '\0')
+		{
+			output.push_back(pending_character_);
+			pending_character_ = '\0';
+		}
+		full_character_count_--;
+		return;
+	}
+	// The first character is in the low nibble
+	const unsigned char first = c & 0x0F;
+	const unsigned char second = (c >> 4) & 0x0F;
+	if (first == MEATPACK_FULL_CHARACTER)
+	{
+		full_character_count_++;
+		if (second == MEATPACK_FULL_CHARACTER)
+		{
+			full_character_count_++;
+		}
+		else
+		{
+			// Written after the full character
+			pending_character_ = get_character_(second);
+		}
+		return;
+	}
+	const char first_character = get_character_(first);
+	output.push_back(first_character);
+	// A line that ends on the low nibble pads the high nibble
+	if (first_character == '\n')
+	{
+		return;
+	}
+	if (second == MEATPACK_FULL_CHARACTER)
+	{
+		full_character_count_++;
+	}
+	else
+	{
+		output.push_back(get_character_(second));
+	}
+}
+
+void meatpack_decoder::handle_command_(unsigned char command)
+{
+	switch (command)
+	{
+	case MEATPACK_ENABLE_PACKING:
+		is_packing_ = true;
+		break;
+	case MEATPACK_DISABLE_PACKING:
+		is_packing_ = false;
+		break;
+	case MEATPACK_RESET_ALL:
+		is_packing_ = false;
+		is_no_spaces_ = false;
+		break;
+	case MEATPACK_ENABLE_NO_SPACES:
+		is_no_spaces_ = true;
+		break;
+	case MEATPACK_DISABLE_NO_SPACES:
+		is_no_spaces_ = false;
+		break;
+	default:
+		break;
+	}
+}
+
+char meatpack_decoder::get_character_(unsigned char nibble) const
+{
+	if (nibble == MEATPACK_SPACE_INDEX && is_no_spaces_)
+	{
+		return MEATPACK_NO_SPACES_CHARACTER;
+	}
+	return meatpack_characters[nibble];
+}
+
+meatpack_encoder::meatpack_encoder(bool no_spaces)
+{
+	is_no_spaces_ = no_spaces;
+}
+
+void meatpack_encoder::get_enable_commands(std::string& output) const
+{
+	output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+	output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+	output.push_back(static_cast<char>(MEATPACK_ENABLE_PACKING));
+	if (is_no_spaces_)
+	{
+		output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+		output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+		output.push_back(static_cast<char>(MEATPACK_ENABLE_NO_SPACES));
+	}
+}
+
+void meatpack_encoder::get_disable_commands(std::string& output) const
+{
+	if (is_no_spaces_)
+	{
+		output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+		output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+		output.push_back(static_cast<char>(MEATPACK_DISABLE_NO_SPACES));
+	}
+	output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+	output.push_back(static_cast<char>(MEATPACK_COMMAND_BYTE));
+	output.push_back(static_cast<char>(MEATPACK_DISABLE_PACKING));
+}
+
+void meatpack_encoder::encode_line(const char* line, size_t length, std::string& output)
+{
+	// Remove the comment and the surrounding whitespace
+	size_t end = 0;
+	while (end < length && line[end] != ';')
+	{
+		end++;
+	}
+	size_t start = 0;
+	while (start < end && isspace(static_cast<unsigned char>(line[start])))
+	{
+		start++;
+	}
+	while (end > start && isspace(static_cast<unsigned char>(line[end - 1])))
+	{
+		end--;
+	}
+	if (start == end)
+	{
+		return;
+	}
+	// Only G commands are stripped of spaces.  Other commands, like M117, may have text parameters.
+	const bool remove_spaces = is_no_spaces_ && (line[start] == 'G' || line[start] == 'g');
+	line_.clear();
+	for (size_t index = start; index < end; index++)
+	{
+		if (remove_spaces && line[index] == ' ')
+		{
+			continue;
+		}
+		line_.push_back(line[index]);
+	}
+	line_.push_back('\n');
+
+	// Two characters per byte, the first in the low nibble.  Characters that can't be packed follow the byte in full.
+	const size_t line_length = line_.length();
+	for (size_t index = 0; index < line_length; index += 2)
+	{
+		const char first = line_[index];
+		const unsigned char first_nibble = get_nibble_(first);
+		// A line with an odd length ends with the line ending in the low nibble, and the decoder ignores the high nibble.
+		const bool has_second = index + 1 < line_length;
+		const char second = has_second ? line_[index + 1] : '\0';
+		const unsigned char second_nibble = has_second ? get_nibble_(second) : MEATPACK_SPACE_INDEX;
+		output.push_back(static_cast<char>(first_nibble | (second_nibble << 4)));
+		if (first_nibble == MEATPACK_FULL_CHARACTER)
+		{
+			output.push_back(first);
+		}
+		if (second_nibble == MEATPACK_FULL_CHARACTER)
+		{
+			output.push_back(second);
+		}
+	}
+}
+
+unsigned char meatpack_encoder::get_nibble_(char c) const
+{
+	if (c >= '0' && c <= '9')
+	{
+		return static_cast<unsigned char>(c - '0');
+	}
+	switch (c)
+	{
+	case '.':
+		return 10;
+	case ' ':
+		return is_no_spaces_ ? MEATPACK_FULL_CHARACTER : MEATPACK_SPACE_INDEX;
+	case MEATPACK_NO_SPACES_CHARACTER:
+		return is_no_spaces_ ? MEATPACK_SPACE_INDEX : MEATPACK_FULL_CHARACTER;
+	case '\n':
+		return 12;
+	case 'G':
+		return 13;
+	case 'X':
+		return 14;
+	default:
+		return MEATPACK_FULL_CHARACTER;
+	}
+}
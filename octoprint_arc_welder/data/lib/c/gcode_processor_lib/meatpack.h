@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+
+// MeatPack packs the most common gcode characters into 4 bits each.  See https://github.com/scottmudge/OctoPrint-MeatPack
+#define MEATPACK_COMMAND_BYTE 0xFF
+#define MEATPACK_ENABLE_PACKING 0xFB
+#define MEATPACK_DISABLE_PACKING 0xFA
+#define MEATPACK_RESET_ALL 0xF9
+#define MEATPACK_QUERY_CONFIG 0xF8
+#define MEATPACK_ENABLE_NO_SPACES 0xF7
+#define MEATPACK_DISABLE_NO_SPACES 0xF6
+// A nibble with this value means the character follows as a full byte
+#define MEATPACK_FULL_CHARACTER 0x0F
+
+// Unpacks a MeatPack stream.  The packing and no spaces modes are switched by the commands embedded in the stream.
+class meatpack_decoder
+{
+public:
+	meatpack_decoder();
+	void reset();
+	// Decodes the data and appends the unpacked characters to output.
+	void decode(const char* data, size_t length, std::string& output);
+private:
+	void decode_byte_(unsigned char c, std::string& output);
+	void handle_command_(unsigned char command);
+	char get_character_(unsigned char nibble) const;
+	bool is_packing_;
+	bool is_no_spaces_;
+	int command_byte_count_;
+	int full_character_count_;
+	char pending_character_;
+};
+
+// Packs gcode lines for MeatPack.  Comments and blank lines are removed, since the firmware ignores them.
+// In no spaces mode the spaces in G commands are removed too, which lets 'E' be packed in their place.
+class meatpack_encoder
+{
+public:
+	meatpack_encoder(bool no_spaces = true);
+	// Appends the commands that switch the firmware into, and back out of, the packing modes used by the encoder.
+	void get_enable_commands(std::string& output) const;
+	void get_disable_commands(std::string& output) const;
+	// Packs a single line, which should not include the line ending, and appends it to output.
+	void encode_line(const char* line, size_t length, std::string& output);
+private:
+	unsigned char get_nibble_(char c) const;
+	bool is_no_spaces_;
+	std::string line_;
+};
@@ -0,0 +1,535 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "parsed_command_file.h"
+#include <cstring>
+#include <cstdio>
+
+// Each column is written as an element count followed by the raw elements.
+template <typename T>
+static bool write_column(FILE* file, const std::vector<T>& column)
+{
+	const unsigned int count = static_cast<unsigned int>(column.size());
+	if (fwrite(&count, sizeof(count), 1, file) != 1)
+		return false;
+	return count == 0 || fwrite(&column[0], sizeof(T), count, file) == count;
+}
+
+static bool write_column(FILE* file, const std::string& column)
+{
+	const unsigned int count = static_cast<unsigned int>(column.size());
+	if (fwrite(&count, sizeof(count), 1, file) != 1)
+		return false;
+	return count == 0 || fwrite(column.data(), 1, count, file) == count;
+}
+
+static bool write_string_table(FILE* file, const std::vector<std::string>& strings)
+{
+	const unsigned int count = static_cast<unsigned int>(strings.size());
+	if (fwrite(&count, sizeof(count), 1, file) != 1)
+		return false;
+	for (unsigned int index = 0; index < count; index++)
+	{
+		if (!write_column(file, strings[index]))
+			return false;
+	}
+	return true;
+}
+
+template <typename T>
+static bool read_column(FILE* file, std::vector<T>& column)
+{
+	unsigned int count;
+	if (fread(&count, sizeof(count), 1, file) != 1)
+		return false;
+	column.resize(count);
+	return count == 0 || fread(&column[0], sizeof(T), count, file) == count;
+}
+
+static bool read_column(FILE* file, std::string& column)
+{
+	unsigned int count;
+	if (fread(&count, sizeof(count), 1, file) != 1)
+		return false;
+	column.resize(count);
+	return count == 0 || fread(&column[0], 1, count, file) == count;
+}
+
+static bool read_string_table(FILE* file, std::vector<std::string>& strings)
+{
+	unsigned int count;
+	if (fread(&count, sizeof(count), 1, file) != 1)
+		return false;
+	strings.resize(count);
+	for (unsigned int index = 0; index < count; index++)
+	{
+		if (!read_column(file, strings[index]))
+			return false;
+	}
+	return true;
+}
+
+static int get_value_column(const parsed_command_parameter& parameter)
+{
+	if (parameter.value_type != 'F' || parameter.name.length() != 1)
+		return PARSED_COMMAND_COLUMN_OTHER;
+	switch (parameter.name[0])
+	{
+	case 'X':
+		return PARSED_COMMAND_COLUMN_X;
+	case 'Y':
+		return PARSED_COMMAND_COLUMN_Y;
+	case 'Z':
+		return PARSED_COMMAND_COLUMN_Z;
+	case 'E':
+		return PARSED_COMMAND_COLUMN_E;
+	case 'F':
+		return PARSED_COMMAND_COLUMN_F;
+	}
+	return PARSED_COMMAND_COLUMN_OTHER;
+}
+
+static const char* value_column_names[PARSED_COMMAND_NUM_VALUE_COLUMNS] = { "X", "Y", "Z", "E", "F" };
+
+#pragma region parsed_command_file_writer
+parsed_command_file_writer::parsed_command_file_writer()
+{
+	file_ = NULL;
+	has_error_ = false;
+	source_position_ = 0;
+	block_lines_ = 0;
+}
+
+parsed_command_file_writer::parsed_command_file_writer(const parsed_command_file_writer&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+parsed_command_file_writer::~parsed_command_file_writer()
+{
+	// An unclosed file is never marked as complete, so it will not be read.
+	if (file_ != NULL)
+	{
+		fclose(file_);
+		file_ = NULL;
+	}
+}
+
+bool parsed_command_file_writer::open(const std::string& file_path, long long source_file_size, long long source_modified_time)
+{
+	discard();
+	file_ = fopen(file_path.c_str(), "wb");
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	file_path_ = file_path;
+	header_ = parsed_command_file_header();
+	header_.source_file_size = source_file_size;
+	header_.source_modified_time = source_modified_time;
+	source_position_ = 0;
+	has_error_ = fwrite(PARSED_COMMAND_FILE_MAGIC, 1, 4, file_) != 4 || fwrite(&header_, sizeof(header_), 1, file_) != 1;
+	clear_block();
+	return !has_error_;
+}
+
+bool parsed_command_file_writer::is_open() const
+{
+	return file_ != NULL;
+}
+
+unsigned int parsed_command_file_writer::get_string_id(std::map<std::string, unsigned int>& ids, std::vector<std::string>& strings, const std::string& value)
+{
+	std::map<std::string, unsigned int>::iterator it = ids.find(value);
+	if (it != ids.end())
+	{
+		return it->second;
+	}
+	const unsigned int id = static_cast<unsigned int>(strings.size());
+	strings.push_back(value);
+	ids[value] = id;
+	return id;
+}
+
+bool parsed_command_file_writer::write_command(const parsed_command& cmd, long source_position)
+{
+	if (file_ == NULL || has_error_)
+	{
+		return false;
+	}
+	line_lengths_.push_back(static_cast<unsigned int>(source_position - source_position_));
+	source_position_ = source_position;
+	unsigned char flags = 0;
+	if (cmd.is_empty)
+		flags |= PARSED_COMMAND_FLAG_IS_EMPTY;
+	if (cmd.is_known_command)
+		flags |= PARSED_COMMAND_FLAG_IS_KNOWN_COMMAND;
+	flags_.push_back(flags);
+	command_ids_.push_back(get_string_id(command_ids_by_name_, commands_, cmd.command));
+	gcode_lengths_.push_back(static_cast<unsigned int>(cmd.gcode.length()));
+	gcode_text_.append(cmd.gcode);
+	comment_ids_.push_back(get_string_id(comment_ids_by_text_, comments_, cmd.comment));
+
+	parameter_counts_.push_back(static_cast<unsigned short>(cmd.parameters.size()));
+	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+	{
+		const parsed_command_parameter& parameter = cmd.parameters[index];
+		const int column = get_value_column(parameter);
+		parameter_columns_.push_back(static_cast<unsigned char>(column));
+		if (column != PARSED_COMMAND_COLUMN_OTHER)
+		{
+			values_[column].push_back(parameter.double_value);
+			continue;
+		}
+		// Other parameters are stored as a name id, the value type, and the value.
+		const unsigned int name_id = get_string_id(parameter_name_ids_, parameter_names_, parameter.name);
+		other_parameters_.append(reinterpret_cast<const char*>(&name_id), sizeof(name_id));
+		other_parameters_.push_back(parameter.value_type);
+		switch (parameter.value_type)
+		{
+		case 'F':
+			other_parameters_.append(reinterpret_cast<const char*>(&parameter.double_value), sizeof(double));
+			break;
+		case 'U':
+		{
+			const unsigned long long value = parameter.unsigned_long_value;
+			other_parameters_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			break;
+		}
+		case 'S':
+		{
+			const unsigned int length = static_cast<unsigned int>(parameter.string_value.length());
+			other_parameters_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+			other_parameters_.append(parameter.string_value);
+			break;
+		}
+		}
+	}
+	header_.num_lines++;
+	if (++block_lines_ == PARSED_COMMAND_FILE_BLOCK_LINES)
+	{
+		has_error_ = !write_block();
+		clear_block();
+	}
+	return !has_error_;
+}
+
+bool parsed_command_file_writer::write_block()
+{
+	if (fwrite(&block_lines_, sizeof(block_lines_), 1, file_) != 1)
+		return false;
+	bool success = write_column(file_, line_lengths_)
+		&& write_column(file_, flags_)
+		&& write_column(file_, command_ids_)
+		&& write_column(file_, gcode_lengths_)
+		&& write_column(file_, gcode_text_)
+		&& write_column(file_, comment_ids_)
+		&& write_column(file_, parameter_counts_)
+		&& write_column(file_, parameter_columns_);
+	for (int column = 0; success && column < PARSED_COMMAND_NUM_VALUE_COLUMNS; column++)
+	{
+		success = write_column(file_, values_[column]);
+	}
+	return success
+		&& write_column(file_, other_parameters_)
+		&& write_string_table(file_, commands_)
+		&& write_string_table(file_, comments_)
+		&& write_string_table(file_, parameter_names_);
+}
+
+void parsed_command_file_writer::clear_block()
+{
+	block_lines_ = 0;
+	line_lengths_.clear();
+	flags_.clear();
+	command_ids_.clear();
+	gcode_lengths_.clear();
+	gcode_text_.clear();
+	comment_ids_.clear();
+	parameter_counts_.clear();
+	parameter_columns_.clear();
+	for (int column = 0; column < PARSED_COMMAND_NUM_VALUE_COLUMNS; column++)
+	{
+		values_[column].clear();
+	}
+	other_parameters_.clear();
+	// The string tables are per block so that every block can be read on its own.
+	commands_.clear();
+	command_ids_by_name_.clear();
+	comments_.clear();
+	comment_ids_by_text_.clear();
+	parameter_names_.clear();
+	parameter_name_ids_.clear();
+}
+
+bool parsed_command_file_writer::close()
+{
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	if (!has_error_ && block_lines_ > 0)
+	{
+		has_error_ = !write_block();
+	}
+	clear_block();
+	if (!has_error_)
+	{
+		// Rewrite the header now that the file is complete
+		header_.is_complete = 1;
+		has_error_ = fseek(file_, 4, SEEK_SET) != 0 || fwrite(&header_, sizeof(header_), 1, file_) != 1;
+	}
+	const bool success = fclose(file_) == 0 && !has_error_;
+	file_ = NULL;
+	if (!success)
+	{
+		remove(file_path_.c_str());
+	}
+	return success;
+}
+
+void parsed_command_file_writer::discard()
+{
+	if (file_ != NULL)
+	{
+		fclose(file_);
+		file_ = NULL;
+		remove(file_path_.c_str());
+	}
+	clear_block();
+	has_error_ = false;
+}
+#pragma endregion
+
+#pragma region parsed_command_file_reader
+parsed_command_file_reader::parsed_command_file_reader()
+{
+	file_ = NULL;
+	position_ = 0;
+	block_lines_ = 0;
+	line_index_ = 0;
+}
+
+parsed_command_file_reader::parsed_command_file_reader(const parsed_command_file_reader&)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+parsed_command_file_reader::~parsed_command_file_reader()
+{
+	close();
+}
+
+bool parsed_command_file_reader::open(const std::string& file_path, long long source_file_size, long long source_modified_time)
+{
+	close();
+	file_ = fopen(file_path.c_str(), "rb");
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	char magic[4];
+	if (
+		fread(magic, 1, 4, file_) != 4
+		|| memcmp(magic, PARSED_COMMAND_FILE_MAGIC, 4) != 0
+		|| fread(&header_, sizeof(header_), 1, file_) != 1
+		|| header_.version != PARSED_COMMAND_FILE_VERSION
+		|| header_.byte_order_mark != PARSED_COMMAND_FILE_BYTE_ORDER_MARK
+		|| header_.is_complete != 1
+		|| header_.source_file_size != source_file_size
+		|| header_.source_modified_time != source_modified_time
+	)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool parsed_command_file_reader::is_open() const
+{
+	return file_ != NULL;
+}
+
+void parsed_command_file_reader::close()
+{
+	if (file_ != NULL)
+	{
+		fclose(file_);
+		file_ = NULL;
+	}
+	header_ = parsed_command_file_header();
+	position_ = 0;
+	block_lines_ = 0;
+	line_index_ = 0;
+}
+
+long parsed_command_file_reader::get_position() const
+{
+	return position_;
+}
+
+long long parsed_command_file_reader::get_num_lines() const
+{
+	return header_.num_lines;
+}
+
+bool parsed_command_file_reader::read_block()
+{
+	if (fread(&block_lines_, sizeof(block_lines_), 1, file_) != 1)
+		return false;
+	bool success = read_column(file_, line_lengths_)
+		&& read_column(file_, flags_)
+		&& read_column(file_, command_ids_)
+		&& read_column(file_, gcode_lengths_)
+		&& read_column(file_, gcode_text_)
+		&& read_column(file_, comment_ids_)
+		&& read_column(file_, parameter_counts_)
+		&& read_column(file_, parameter_columns_);
+	for (int column = 0; success && column < PARSED_COMMAND_NUM_VALUE_COLUMNS; column++)
+	{
+		success = read_column(file_, values_[column]);
+		value_indexes_[column] = 0;
+	}
+	success = success
+		&& read_column(file_, other_parameters_)
+		&& read_string_table(file_, commands_)
+		&& read_string_table(file_, comments_)
+		&& read_string_table(file_, parameter_names_);
+	// Every per line column must have one entry for each line
+	success = success
+		&& line_lengths_.size() == block_lines_
+		&& flags_.size() == block_lines_
+		&& command_ids_.size() == block_lines_
+		&& gcode_lengths_.size() == block_lines_
+		&& comment_ids_.size() == block_lines_
+		&& parameter_counts_.size() == block_lines_;
+	line_index_ = 0;
+	parameter_index_ = 0;
+	gcode_offset_ = 0;
+	other_offset_ = 0;
+	if (!success)
+	{
+		block_lines_ = 0;
+	}
+	return success;
+}
+
+bool parsed_command_file_reader::read_other_parameter(parsed_command_parameter& parameter)
+{
+	unsigned int name_id;
+	if (other_offset_ + sizeof(name_id) + 1 > other_parameters_.size())
+		return false;
+	memcpy(&name_id, other_parameters_.data() + other_offset_, sizeof(name_id));
+	other_offset_ += sizeof(name_id);
+	if (name_id >= parameter_names_.size())
+		return false;
+	parameter.name = parameter_names_[name_id];
+	parameter.value_type = other_parameters_[other_offset_++];
+	switch (parameter.value_type)
+	{
+	case 'F':
+		if (other_offset_ + sizeof(double) > other_parameters_.size())
+			return false;
+		memcpy(&parameter.double_value, other_parameters_.data() + other_offset_, sizeof(double));
+		other_offset_ += sizeof(double);
+		break;
+	case 'U':
+	{
+		unsigned long long value;
+		if (other_offset_ + sizeof(value) > other_parameters_.size())
+			return false;
+		memcpy(&value, other_parameters_.data() + other_offset_, sizeof(value));
+		other_offset_ += sizeof(value);
+		parameter.unsigned_long_value = static_cast<unsigned long>(value);
+		break;
+	}
+	case 'S':
+	{
+		unsigned int length;
+		if (other_offset_ + sizeof(length) > other_parameters_.size())
+			return false;
+		memcpy(&length, other_parameters_.data() + other_offset_, sizeof(length));
+		other_offset_ += sizeof(length);
+		if (other_offset_ + length > other_parameters_.size())
+			return false;
+		parameter.string_value.assign(other_parameters_.data() + other_offset_, length);
+		other_offset_ += length;
+		break;
+	}
+	}
+	return true;
+}
+
+bool parsed_command_file_reader::read_command(parsed_command& cmd)
+{
+	if (file_ == NULL)
+	{
+		return false;
+	}
+	if (line_index_ >= block_lines_ && !read_block())
+	{
+		return false;
+	}
+	const unsigned int index = line_index_++;
+	const unsigned int command_id = command_ids_[index];
+	const unsigned int comment_id = comment_ids_[index];
+	const unsigned int gcode_length = gcode_lengths_[index];
+	if (command_id >= commands_.size() || comment_id >= comments_.size() || gcode_offset_ + gcode_length > gcode_text_.size())
+	{
+		return false;
+	}
+	cmd.is_empty = (flags_[index] & PARSED_COMMAND_FLAG_IS_EMPTY) != 0;
+	cmd.is_known_command = (flags_[index] & PARSED_COMMAND_FLAG_IS_KNOWN_COMMAND) != 0;
+	cmd.command = commands_[command_id];
+	cmd.gcode.assign(gcode_text_.data() + gcode_offset_, gcode_length);
+	gcode_offset_ += gcode_length;
+	cmd.comment = comments_[comment_id];
+
+	const unsigned short num_parameters = parameter_counts_[index];
+	cmd.parameters.resize(num_parameters);
+	for (unsigned short parameter_index = 0; parameter_index < num_parameters; parameter_index++)
+	{
+		if (parameter_index_ >= parameter_columns_.size())
+		{
+			return false;
+		}
+		parsed_command_parameter& parameter = cmd.parameters[parameter_index];
+		const unsigned char column = parameter_columns_[parameter_index_++];
+		if (column < PARSED_COMMAND_NUM_VALUE_COLUMNS)
+		{
+			if (value_indexes_[column] >= values_[column].size())
+			{
+				return false;
+			}
+			parameter.name = value_column_names[column];
+			parameter.value_type = 'F';
+			parameter.double_value = values_[column][value_indexes_[column]++];
+		}
+		else if (!read_other_parameter(parameter))
+		{
+			return false;
+		}
+	}
+	position_ += static_cast<long>(line_lengths_[index]);
+	return true;
+}
+#pragma endregion
@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include "parsed_command.h"
+
+// A compact binary copy of a parsed gcode file, so that repeat analysis of the same source can skip text parsing.
+// Commands are stored in blocks of up to PARSED_COMMAND_FILE_BLOCK_LINES lines.  Each block is stored by column:
+//   source line lengths, flags, command ids, gcode text, comment ids, parameter columns, X/Y/Z/E/F values
+//   and any other parameters, followed by the command, comment and parameter name string tables for the block.
+// The file is only valid on the machine that wrote it, and for the source file size and modification time it was built from.
+#define PARSED_COMMAND_FILE_MAGIC "AWPC"
+#define PARSED_COMMAND_FILE_VERSION 1
+#define PARSED_COMMAND_FILE_BYTE_ORDER_MARK 0x01020304
+#define PARSED_COMMAND_FILE_BLOCK_LINES 65536
+
+// The parameter column codes.  X, Y, Z, E and F double parameters have their own value columns.
+#define PARSED_COMMAND_COLUMN_X 0
+#define PARSED_COMMAND_COLUMN_Y 1
+#define PARSED_COMMAND_COLUMN_Z 2
+#define PARSED_COMMAND_COLUMN_E 3
+#define PARSED_COMMAND_COLUMN_F 4
+#define PARSED_COMMAND_COLUMN_OTHER 5
+#define PARSED_COMMAND_NUM_VALUE_COLUMNS 5
+
+// Line flags
+#define PARSED_COMMAND_FLAG_IS_EMPTY 0x01
+#define PARSED_COMMAND_FLAG_IS_KNOWN_COMMAND 0x02
+
+struct parsed_command_file_header
+{
+	parsed_command_file_header() {
+		version = PARSED_COMMAND_FILE_VERSION;
+		byte_order_mark = PARSED_COMMAND_FILE_BYTE_ORDER_MARK;
+		is_complete = 0;
+		source_file_size = 0;
+		source_modified_time = 0;
+		num_lines = 0;
+	}
+	unsigned int version;
+	unsigned int byte_order_mark;
+	// Set to 1 once every block is written.  Interrupted files are never read.
+	unsigned int is_complete;
+	long long source_file_size;
+	long long source_modified_time;
+	long long num_lines;
+};
+
+class parsed_command_file_writer
+{
+public:
+	parsed_command_file_writer();
+	virtual ~parsed_command_file_writer();
+	bool open(const std::string& file_path, long long source_file_size, long long source_modified_time);
+	bool is_open() const;
+	// Adds a command.  source_position is the source file position after the end of the command's line.
+	bool write_command(const parsed_command& cmd, long source_position);
+	// Writes any remaining commands and marks the file as complete.
+	bool close();
+	// Closes and deletes an incomplete file.
+	void discard();
+private:
+	parsed_command_file_writer(const parsed_command_file_writer& source);
+	bool write_block();
+	void clear_block();
+	static unsigned int get_string_id(std::map<std::string, unsigned int>& ids, std::vector<std::string>& strings, const std::string& value);
+	FILE* file_;
+	std::string file_path_;
+	parsed_command_file_header header_;
+	bool has_error_;
+	long source_position_;
+	unsigned int block_lines_;
+	std::vector<unsigned int> line_lengths_;
+	std::vector<unsigned char> flags_;
+	std::vector<unsigned int> command_ids_;
+	std::vector<unsigned int> gcode_lengths_;
+	std::string gcode_text_;
+	std::vector<unsigned int> comment_ids_;
+	std::vector<unsigned short> parameter_counts_;
+	std::vector<unsigned char> parameter_columns_;
+	std::vector<double> values_[PARSED_COMMAND_NUM_VALUE_COLUMNS];
+	std::string other_parameters_;
+	std::vector<std::string> commands_;
+	std::map<std::string, unsigned int> command_ids_by_name_;
+	std::vector<std::string> comments_;
+	std::map<std::string, unsigned int> comment_ids_by_text_;
+	std::vector<std::string> parameter_names_;
+	std::map<std::string, unsigned int> parameter_name_ids_;
+};
+
+class parsed_command_file_reader
+{
+public:
+	parsed_command_file_reader();
+	virtual ~parsed_command_file_reader();
+	// Fails if the file does not exist, was not completed, was written by another version or on another platform,
+	// or if the source file size or modification time does not match.
+	bool open(const std::string& file_path, long long source_file_size, long long source_modified_time);
+	bool is_open() const;
+	void close();
+	// Reads the next command into cmd.  Returns false at the end of the file, or if the file is corrupt.
+	bool read_command(parsed_command& cmd);
+	// The source file position after the end of the last line returned.
+	long get_position() const;
+	long long get_num_lines() const;
+private:
+	parsed_command_file_reader(const parsed_command_file_reader& source);
+	bool read_block();
+	bool read_other_parameter(parsed_command_parameter& parameter);
+	FILE* file_;
+	parsed_command_file_header header_;
+	long position_;
+	unsigned int block_lines_;
+	unsigned int line_index_;
+	size_t parameter_index_;
+	size_t value_indexes_[PARSED_COMMAND_NUM_VALUE_COLUMNS];
+	size_t gcode_offset_;
+	size_t other_offset_;
+	std::vector<unsigned int> line_lengths_;
+	std::vector<unsigned char> flags_;
+	std::vector<unsigned int> command_ids_;
+	std::vector<unsigned int> gcode_lengths_;
+	std::string gcode_text_;
+	std::vector<unsigned int> comment_ids_;
+	std::vector<unsigned short> parameter_counts_;
+	std::vector<unsigned char> parameter_columns_;
+	std::vector<double> values_[PARSED_COMMAND_NUM_VALUE_COLUMNS];
+	std::string other_parameters_;
+	std::vector<std::string> commands_;
+	std::vector<std::string> comments_;
+	std::vector<std::string> parameter_names_;
+};
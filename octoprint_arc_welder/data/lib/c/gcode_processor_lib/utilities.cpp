@@ -24,6 +24,8 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 // Had to increase the zero tolerance because prusa slicer doesn't always retract enough while wiping.
 const double ZERO_TOLERANCE = 0.000005;
@@ -109,6 +111,13 @@ double utilities::get_cartesian_distance(double x1, double y1, double x2, double
 	return sqrt(dist_squared);
 }
 
+double utilities::get_cartesian_distance_sq(double x1, double y1, double x2, double y2)
+{
+	double xdif = x1 - x2;
+	double ydif = y1 - y2;
+	return xdif * xdif + ydif * ydif;
+}
+
 double utilities::get_cartesian_distance(double x1, double y1, double z1, double x2, double y2, double z2)
 {
 	// Compare the saved points cartesian distance from the current point
@@ -178,6 +187,22 @@ char * utilities::to_string(double value, unsigned short precision, char * str)
 		}
 	}
 	str[char_count] = 0; //String terminator
+	if (is_negative)
+	{
+		// Don't write a negative zero (-0.000) when every written digit is 0
+		int index = 1;
+		while (str[index] == '0' || str[index] == '.')
+		{
+			index++;
+		}
+		if (str[index] == 0)
+		{
+			for (index = 0; index < char_count; index++)
+			{
+				str[index] = str[index + 1];
+			}
+		}
+	}
 	return str;
 }
 
@@ -350,3 +375,15 @@ bool utilities::get_temp_file_path_for_file(const std::string& file_path, std::s
 	temp_file_path += ".tmp";
 	return true;
 }
+
+bool utilities::get_file_info(const std::string& file_path, long long& file_size, long long& modified_time)
+{
+	struct stat file_stat;
+	if (stat(file_path.c_str(), &file_stat) != 0)
+	{
+		return false;
+	}
+	file_size = static_cast<long long>(file_stat.st_size);
+	modified_time = static_cast<long long>(file_stat.st_mtime);
+	return true;
+}
@@ -45,6 +45,8 @@ public:
 
 	static double get_cartesian_distance(double x1, double y1, double x2, double y2);
 	static double get_cartesian_distance(double x1, double y1, double z1, double x2, double y2, double z2);
+	// The squared distance, for comparisons that don't need the square root.
+	static double get_cartesian_distance_sq(double x1, double y1, double x2, double y2);
 	static std::string to_string(double value);
 	static std::string to_string(int value);
 	static char* to_string(double value, unsigned short precision, char* str);
@@ -61,6 +63,8 @@ public:
 	static std::vector<std::string> splitpath(const std::string& str);
 	static bool get_file_path(const std::string& file_path, std::string& path);
 	static bool get_temp_file_path_for_file(const std::string& file_path, std::string& temp_file_path);
+	// Gets the size and last modification time (in seconds) of a file.  Returns false if the file does not exist.
+	static bool get_file_info(const std::string& file_path, long long& file_size, long long& modified_time);
 	static std::string create_uuid();
 
 	
@@ -28,7 +28,7 @@ PyObject* py_arc_welder::build_py_progress(const arc_welder_progress& progress)
 	PyObject* pyMessage = gcode_arc_converter::PyUnicode_SafeFromString(segment_statistics);
 	if (pyMessage == NULL)
 		return NULL;
-	PyObject* py_progress = Py_BuildValue("{s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:f,s:f,s:f,s:f,s:i,s:i}",
+	PyObject* py_progress = Py_BuildValue("{s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:f,s:f,s:f,s:f,s:i,s:i}",
 		"percent_complete",
 		progress.percent_complete,												//1
 		"seconds_elapsed",
@@ -43,6 +43,8 @@ PyObject* py_arc_welder::build_py_progress(const arc_welder_progress& progress)
 		progress.points_compressed,												//6
 		"arcs_created",
 		progress.arcs_created,														//7
+		"splines_created",
+		progress.splines_created,													//7b
 		"source_file_position",
 		progress.source_file_position,										//8
 		"source_file_size",
@@ -71,11 +73,128 @@ PyObject* py_arc_welder::build_py_progress(const arc_welder_progress& progress)
 	// else it crashes in python 2.7.  Looking forward to retiring this backwards 
 	// compatible code...
 	PyDict_SetItemString(py_progress, "segment_statistics_text", pyMessage);
+
+	std::string command_rate_statistics = "Source: " + progress.source_command_rates.str() + "\nTarget: " + progress.target_command_rates.str();
+	PyObject* py_command_rate_statistics = gcode_arc_converter::PyUnicode_SafeFromString(command_rate_statistics);
+	if (py_command_rate_statistics == NULL)
+		return NULL;
+	PyDict_SetItemString(py_progress, "command_rate_statistics_text", py_command_rate_statistics);
+	Py_DECREF(py_command_rate_statistics);
+
+	PyObject* py_source_command_rates = build_py_command_rates(progress.source_command_rates);
+	if (py_source_command_rates == NULL)
+		return NULL;
+	PyDict_SetItemString(py_progress, "source_command_rates", py_source_command_rates);
+	Py_DECREF(py_source_command_rates);
+
+	PyObject* py_target_command_rates = build_py_command_rates(progress.target_command_rates);
+	if (py_target_command_rates == NULL)
+		return NULL;
+	PyDict_SetItemString(py_progress, "target_command_rates", py_target_command_rates);
+	Py_DECREF(py_target_command_rates);
 	return py_progress;
 }
 
+PyObject* py_arc_welder::build_py_command_rates(const command_rate_summary& command_rates)
+{
+	PyObject* py_regions = PyList_New(0);
+	if (py_regions == NULL)
+		return NULL;
+	for (unsigned int index = 0; index < command_rates.regions_over_limit.size(); index++)
+	{
+		const command_rate_region& region = command_rates.regions_over_limit[index];
+		PyObject* py_region = Py_BuildValue("{s:d,s:d,s:i,s:i,s:d}",
+			"start_seconds",
+			region.start_seconds,
+			"end_seconds",
+			region.end_seconds,
+			"start_line",
+			region.start_line,
+			"end_line",
+			region.end_line,
+			"max_rate",
+			region.max_rate
+		);
+		if (py_region == NULL)
+		{
+			Py_DECREF(py_regions);
+			return NULL;
+		}
+		PyList_Append(py_regions, py_region);
+		Py_DECREF(py_region);
+	}
+
+	PyObject* py_command_rates = Py_BuildValue("{s:d,s:d,s:d,s:i,s:d,s:d,s:d,s:i,s:N}",
+		"window_seconds",
+		command_rates.window_seconds,
+		"rate_limit",
+		command_rates.rate_limit,
+		"total_seconds",
+		command_rates.total_seconds,
+		"total_commands",
+		command_rates.total_commands,
+		"percentile_50",
+		command_rates.percentile_50,
+		"percentile_99",
+		command_rates.percentile_99,
+		"max_rate",
+		command_rates.max_rate,
+		"num_regions_over_limit",
+		command_rates.num_regions_over_limit,
+		"regions_over_limit",
+		py_regions // N steals the reference
+	);
+	return py_command_rates;
+}
+
+PyObject* py_arc_welder::build_py_analysis(const arc_welder_analysis& analysis)
+{
+	PyObject* py_filament_length_mm = PyList_New(0);
+	if (py_filament_length_mm == NULL)
+		return NULL;
+	for (unsigned int index = 0; index < analysis.filament_length_mm.size(); index++)
+	{
+		PyObject* py_length = PyFloat_FromDouble(analysis.filament_length_mm[index]);
+		if (py_length == NULL)
+		{
+			Py_DECREF(py_filament_length_mm);
+			return NULL;
+		}
+		PyList_Append(py_filament_length_mm, py_length);
+		Py_DECREF(py_length);
+	}
+
+	PyObject* py_analysis = Py_BuildValue("{s:i,s:d,s:d,s:d,s:d,s:d,s:d,s:N,s:i,s:d}",
+		"has_printing_area",
+		analysis.has_printing_area,
+		"min_x",
+		analysis.min_x,
+		"max_x",
+		analysis.max_x,
+		"min_y",
+		analysis.min_y,
+		"max_y",
+		analysis.max_y,
+		"min_z",
+		analysis.min_z,
+		"max_z",
+		analysis.max_z,
+		"filament_length_mm",
+		py_filament_length_mm, // N steals the reference
+		"layer_count",
+		analysis.layer_count,
+		"estimated_print_time_seconds",
+		analysis.estimated_print_time_seconds
+	);
+	return py_analysis;
+}
+
 bool py_arc_welder::on_progress_(const arc_welder_progress& progress)
 {
+	if (py_progress_callback_ == NULL)
+	{
+		return arc_welder::on_progress_(progress);
+	}
 	PyObject* py_dict = py_arc_welder::build_py_progress(progress);
 	if (py_dict == NULL)
 	{
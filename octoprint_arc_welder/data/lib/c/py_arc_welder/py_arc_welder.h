@@ -34,7 +34,7 @@
 class py_arc_welder : public arc_welder
 {
 public:
-	py_arc_welder(std::string source_path, std::string target_path, py_logger* logger, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, PyObject* py_progress_callback):arc_welder(source_path, target_path, logger, resolution_mm, max_radius, g90_g91_influences_extruder, buffer_size)
+	py_arc_welder(std::string source_path, std::string target_path, py_logger* logger, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, bool allow_g5_splines, bool allow_3d_arcs, double feedrate_tolerance_percent, double command_rate_limit, bool dry_run, PyObject* py_progress_callback):arc_welder(source_path, target_path, logger, resolution_mm, max_radius, g90_g91_influences_extruder, buffer_size, allow_g5_splines, allow_3d_arcs, feedrate_tolerance_percent, command_rate_limit, dry_run)
 	{
 		py_progress_callback_ = py_progress_callback;
 	}
@@ -42,6 +42,8 @@ public:
 		
 	}
 	static PyObject* build_py_progress(const arc_welder_progress& progress);
+	static PyObject* build_py_command_rates(const command_rate_summary& command_rates);
+	static PyObject* build_py_analysis(const arc_welder_analysis& analysis);
 protected:
 	virtual bool on_progress_(const arc_welder_progress& progress);
 private:
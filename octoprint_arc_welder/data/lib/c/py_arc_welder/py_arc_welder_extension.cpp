@@ -88,6 +88,11 @@ static struct module_state _state;
 // Python 2 module method definition
 static PyMethodDef PyArcWelderMethods[] = {
 	{ "ConvertFile", (PyCFunction)ConvertFile,  METH_VARARGS  ,"Converts segmented curve approximations to actual G2/G3 arcs within the supplied resolution." },
+	{ "EstimateFile", (PyCFunction)EstimateFile,  METH_VARARGS  ,"Estimates the results of ConvertFile by welding evenly spaced samples of the source file without writing a target." },
+	{ "StreamBegin", (PyCFunction)StreamBegin,  METH_VARARGS  ,"Creates a stream that welds gcode one line at a time, for gcode that is being sent to the printer." },
+	{ "StreamLine", (PyCFunction)StreamLine,  METH_VARARGS  ,"Welds a line of a stream, and returns a tuple of the lines that are ready to be sent." },
+	{ "StreamFlush", (PyCFunction)StreamFlush,  METH_VARARGS  ,"Returns a tuple of the lines held back by a stream, including the shape being fit.  The stream continues." },
+	{ "StreamEnd", (PyCFunction)StreamEnd,  METH_VARARGS  ,"Ends a stream, and returns a tuple of the lines that were still held back." },
 	{ NULL, NULL, 0, NULL }
 };
 
@@ -190,7 +195,27 @@ extern "C"
 		std::string message = "py_gcode_arc_converter.ConvertFile - Beginning Arc Conversion.";
 		p_py_logger->log(GCODE_CONVERSION, INFO, message);
 
-		py_arc_welder arc_welder_obj(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.max_radius_mm, args.g90_g91_influences_extruder, 50, py_progress_callback);
+		py_arc_welder arc_welder_obj(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.max_radius_mm, args.g90_g91_influences_extruder, 50, args.allow_g5_splines, args.allow_3d_arcs, args.feedrate_tolerance_percent, args.command_rate_limit, args.dry_run, py_progress_callback);
+		for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+		{
+			if (args.feature_resolution_mm[index] > 0)
+				arc_welder_obj.set_feature_resolution_mm(index, args.feature_resolution_mm[index]);
+			if (args.feature_max_radius_mm[index] > 0)
+				arc_welder_obj.set_feature_max_radius_mm(index, args.feature_max_radius_mm[index]);
+		}
+		if (args.parsed_command_file_path.length() > 0)
+			arc_welder_obj.set_parsed_command_file_path(args.parsed_command_file_path);
+		if (args.line_offset_index_path.length() > 0)
+			arc_welder_obj.set_line_offset_index_path(args.line_offset_index_path);
+		if (args.source_line_map_path.length() > 0)
+			arc_welder_obj.set_source_line_map_path(args.source_line_map_path);
+		if (args.telemetry_path.length() > 0)
+			arc_welder_obj.set_telemetry_path(args.telemetry_path);
+		arc_welder_obj.set_target_compression_threads(args.target_compression_threads);
+		arc_welder_obj.set_target_meatpack(args.target_meatpack);
+		arc_welder_obj.set_max_coalesced_sweep_degrees(args.max_coalesced_sweep_degrees);
+		arc_welder_obj.set_segmentation_lookahead(args.segmentation_lookahead);
+		arc_welder_obj.set_float_fitting(args.float_fitting);
 		arc_welder_results results = arc_welder_obj.process();
 		message = "py_gcode_arc_converter.ConvertFile - Arc Conversion Complete.";
 		p_py_logger->log(GCODE_CONVERSION, INFO, message);
@@ -199,9 +224,15 @@ extern "C"
 		PyObject* p_progress = py_arc_welder::build_py_progress(results.progress);
 		if (p_progress == NULL)
 			p_progress = Py_None;
+		PyObject* p_analysis = py_arc_welder::build_py_analysis(results.analysis);
+		if (p_analysis == NULL)
+		{
+			p_analysis = Py_None;
+			Py_INCREF(p_analysis);
+		}
 
 		PyObject* p_results = Py_BuildValue(
-			"{s:i,s:i,s:s,s:O}",
+			"{s:i,s:i,s:s,s:O,s:N}",
 			"success",
 			results.success,
 			"cancelled",
@@ -209,10 +240,270 @@ extern "C"
 			"message",
 			results.message.c_str(),
 			"progress",
-			p_progress
+			p_progress,
+			"analysis",
+			p_analysis // N steals the reference
+		);
+		return p_results;
+	}
+
+	static PyObject* EstimateFile(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_estimate_file_args;
+		if (!PyArg_ParseTuple(
+			py_args,
+			"O",
+			&py_estimate_file_args
+			))
+		{
+			std::string message = "py_gcode_arc_converter.EstimateFile - Cound not extract the parameters dictionary.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return NULL;
+		}
+
+		// Nothing is written by an estimate, so the target file and progress callback are not required.
+		py_gcode_arc_args args;
+		args.dry_run = true;
+		PyObject* py_progress_callback = NULL;
+		if (!ParseArgs(py_estimate_file_args, args, &py_progress_callback))
+		{
+			return NULL;
+		}
+		p_py_logger->set_log_level_by_value(args.log_level);
+
+		// Extract num_samples.  This is optional, and defaults to DEFAULT_ESTIMATE_NUM_SAMPLES
+		PyObject* py_num_samples = PyDict_GetItemString(py_estimate_file_args, "num_samples");
+		if (py_num_samples != NULL)
+		{
+			args.num_samples = static_cast<int>(PyLong_AsLong(py_num_samples));
+		}
+		// Extract sample_size_bytes.  This is optional, and defaults to DEFAULT_ESTIMATE_SAMPLE_SIZE_BYTES
+		PyObject* py_sample_size_bytes = PyDict_GetItemString(py_estimate_file_args, "sample_size_bytes");
+		if (py_sample_size_bytes != NULL)
+		{
+			args.sample_size_bytes = PyLong_AsLong(py_sample_size_bytes);
+		}
+
+		std::string message = "py_gcode_arc_converter.EstimateFile - Beginning Estimate.";
+		p_py_logger->log(GCODE_CONVERSION, INFO, message);
+
+		py_arc_welder arc_welder_obj(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.max_radius_mm, args.g90_g91_influences_extruder, 50, args.allow_g5_splines, args.allow_3d_arcs, args.feedrate_tolerance_percent, args.command_rate_limit, true, NULL);
+		for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+		{
+			if (args.feature_resolution_mm[index] > 0)
+				arc_welder_obj.set_feature_resolution_mm(index, args.feature_resolution_mm[index]);
+			if (args.feature_max_radius_mm[index] > 0)
+				arc_welder_obj.set_feature_max_radius_mm(index, args.feature_max_radius_mm[index]);
+		}
+		arc_welder_obj.set_max_coalesced_sweep_degrees(args.max_coalesced_sweep_degrees);
+		arc_welder_obj.set_segmentation_lookahead(args.segmentation_lookahead);
+		arc_welder_obj.set_float_fitting(args.float_fitting);
+		arc_welder_estimate estimate = arc_welder_obj.estimate(args.num_samples, args.sample_size_bytes);
+		message = "py_gcode_arc_converter.EstimateFile - Estimate Complete.";
+		p_py_logger->log(GCODE_CONVERSION, INFO, message);
+		Py_XDECREF(py_progress_callback);
+
+		PyObject* p_results = Py_BuildValue(
+			"{s:i,s:s,s:i,s:l,s:l,s:l,s:i,s:i,s:d,s:l,s:i,s:i,s:d,s:d,s:d}",
+			"success",
+			estimate.success,
+			"message",
+			estimate.message.c_str(),
+			"num_samples",
+			estimate.num_samples,
+			"source_file_size",
+			estimate.source_file_size,
+			"sampled_source_bytes",
+			estimate.sampled_source_bytes,
+			"sampled_target_bytes",
+			estimate.sampled_target_bytes,
+			"sampled_arcs_created",
+			estimate.sampled_arcs_created,
+			"sampled_splines_created",
+			estimate.sampled_splines_created,
+			"seconds_elapsed",
+			estimate.seconds_elapsed,
+			"estimated_target_file_size",
+			estimate.estimated_target_file_size,
+			"estimated_arcs_created",
+			estimate.estimated_arcs_created,
+			"estimated_splines_created",
+			estimate.estimated_splines_created,
+			"estimated_seconds",
+			estimate.estimated_seconds,
+			"compression_ratio",
+			estimate.compression_ratio,
+			"compression_percent",
+			estimate.compression_percent
 		);
 		return p_results;
 	}
+
+	static void DeleteStream(PyObject* py_stream)
+	{
+		arc_welder* p_stream = static_cast<arc_welder*>(PyCapsule_GetPointer(py_stream, ARC_WELDER_STREAM_CAPSULE_NAME));
+		delete p_stream;
+	}
+
+	static PyObject* StreamBegin(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_stream_args;
+		if (!PyArg_ParseTuple(
+			py_args,
+			"O",
+			&py_stream_args
+			))
+		{
+			std::string message = "py_gcode_arc_converter.StreamBegin - Cound not extract the parameters dictionary.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return NULL;
+		}
+
+		// The welded lines are returned instead of written, so the target file and progress callback are not required.
+		py_gcode_arc_args args;
+		args.dry_run = true;
+		PyObject* py_progress_callback = NULL;
+		if (!ParseArgs(py_stream_args, args, &py_progress_callback))
+		{
+			return NULL;
+		}
+		Py_XDECREF(py_progress_callback);
+		p_py_logger->set_log_level_by_value(args.log_level);
+
+		// Extract max_segments.  This is optional, and defaults to DEFAULT_STREAM_MAX_SEGMENTS
+		PyObject* py_max_segments = PyDict_GetItemString(py_stream_args, "max_segments");
+		if (py_max_segments != NULL)
+		{
+			args.max_segments = static_cast<int>(PyLong_AsLong(py_max_segments));
+			if (args.max_segments < DEFAULT_MIN_SEGMENTS)
+			{
+				args.max_segments = DEFAULT_STREAM_MAX_SEGMENTS;
+			}
+		}
+
+		arc_welder* p_stream = new arc_welder(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.max_radius_mm, args.g90_g91_influences_extruder, args.max_segments + 5, args.allow_g5_splines, args.allow_3d_arcs, args.feedrate_tolerance_percent, args.command_rate_limit, false, NULL);
+		for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+		{
+			if (args.feature_resolution_mm[index] > 0)
+				p_stream->set_feature_resolution_mm(index, args.feature_resolution_mm[index]);
+			if (args.feature_max_radius_mm[index] > 0)
+				p_stream->set_feature_max_radius_mm(index, args.feature_max_radius_mm[index]);
+		}
+		p_stream->set_max_coalesced_sweep_degrees(args.max_coalesced_sweep_degrees);
+		p_stream->set_segmentation_lookahead(args.segmentation_lookahead);
+		p_stream->set_float_fitting(args.float_fitting);
+		p_stream->begin_stream();
+		PyObject* py_stream = PyCapsule_New(p_stream, ARC_WELDER_STREAM_CAPSULE_NAME, DeleteStream);
+		if (py_stream == NULL)
+		{
+			delete p_stream;
+		}
+		return py_stream;
+	}
+
+	static PyObject* StreamLine(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_stream;
+		const char* line;
+		if (!PyArg_ParseTuple(py_args, "Os", &py_stream, &line))
+		{
+			return NULL;
+		}
+		arc_welder* p_stream = static_cast<arc_welder*>(PyCapsule_GetPointer(py_stream, ARC_WELDER_STREAM_CAPSULE_NAME));
+		if (p_stream == NULL)
+		{
+			return NULL;
+		}
+		if (!p_stream->is_streaming())
+		{
+			PyErr_SetString(PyExc_ValueError, "The arc welder stream has ended.");
+			return NULL;
+		}
+		std::string output;
+		p_stream->stream_line(line, output);
+		return BuildStreamLines(output);
+	}
+
+	static PyObject* StreamFlush(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_stream;
+		if (!PyArg_ParseTuple(py_args, "O", &py_stream))
+		{
+			return NULL;
+		}
+		arc_welder* p_stream = static_cast<arc_welder*>(PyCapsule_GetPointer(py_stream, ARC_WELDER_STREAM_CAPSULE_NAME));
+		if (p_stream == NULL)
+		{
+			return NULL;
+		}
+		std::string output;
+		if (p_stream->is_streaming())
+		{
+			p_stream->flush_stream(output);
+		}
+		return BuildStreamLines(output);
+	}
+
+	static PyObject* StreamEnd(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_stream;
+		if (!PyArg_ParseTuple(py_args, "O", &py_stream))
+		{
+			return NULL;
+		}
+		arc_welder* p_stream = static_cast<arc_welder*>(PyCapsule_GetPointer(py_stream, ARC_WELDER_STREAM_CAPSULE_NAME));
+		if (p_stream == NULL)
+		{
+			return NULL;
+		}
+		std::string output;
+		if (p_stream->is_streaming())
+		{
+			p_stream->end_stream(output);
+		}
+		return BuildStreamLines(output);
+	}
+}
+
+static PyObject* BuildStreamLines(const std::string& output)
+{
+	// Most lines are held back or passed through unchanged, so count the lines first and fill a tuple of the right size.
+	// Blank lines are not sent to the printer, so they are skipped.
+	Py_ssize_t num_lines = 0;
+	size_t start = 0;
+	size_t end;
+	while ((end = output.find('\n', start)) != std::string::npos)
+	{
+		if (end > start)
+		{
+			num_lines++;
+		}
+		start = end + 1;
+	}
+	PyObject* py_lines = PyTuple_New(num_lines);
+	if (py_lines == NULL)
+	{
+		return NULL;
+	}
+	start = 0;
+	for (Py_ssize_t index = 0; index < num_lines; start = end + 1)
+	{
+		end = output.find('\n', start);
+		if (end == start)
+		{
+			continue;
+		}
+		PyObject* py_line = gcode_arc_converter::PyString_SafeFromStringAndSize(output.c_str() + start, static_cast<Py_ssize_t>(end - start));
+		if (py_line == NULL)
+		{
+			Py_DECREF(py_lines);
+			return NULL;
+		}
+		// Steals the reference
+		PyTuple_SET_ITEM(py_lines, index, py_line);
+		index++;
+	}
+	return py_lines;
 }
 
 static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_progress_callback)
@@ -232,15 +523,88 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	}
 	args.source_file_path = gcode_arc_converter::PyUnicode_SafeAsString(py_source_file_path);
 
-	// Extract the target file path
+	// Extract dry_run.  This is optional, and defaults to DEFAULT_DRY_RUN
+	PyObject* py_dry_run = PyDict_GetItemString(py_args, "dry_run");
+	if (py_dry_run != NULL)
+	{
+		args.dry_run = PyLong_AsLong(py_dry_run) > 0;
+	}
+
+	// Extract the target file path.  This is not required for a dry run since nothing is written.
 	PyObject* py_target_file_path = PyDict_GetItemString(py_args, "target_file_path");
-	if (py_target_file_path == NULL)
+	if (py_target_file_path != NULL)
+	{
+		args.target_file_path = gcode_arc_converter::PyUnicode_SafeAsString(py_target_file_path);
+	}
+	else if (!args.dry_run)
 	{
 		std::string message = "ParseArgs - Unable to retrieve the target_file_path parameter from the args.";
 		p_py_logger->log_exception(GCODE_CONVERSION, message);
 		return false;
 	}
-	args.target_file_path = gcode_arc_converter::PyUnicode_SafeAsString(py_target_file_path);
+
+	// Extract parsed_command_file_path.  This is optional.  When supplied, repeat conversions of the same source skip parsing.
+	PyObject* py_parsed_command_file_path = PyDict_GetItemString(py_args, "parsed_command_file_path");
+	if (py_parsed_command_file_path != NULL)
+	{
+		args.parsed_command_file_path = gcode_arc_converter::PyUnicode_SafeAsString(py_parsed_command_file_path);
+	}
+
+	// Extract line_offset_index_path.  This is optional.  When supplied, a source line offset and layer index is saved here.
+	PyObject* py_line_offset_index_path = PyDict_GetItemString(py_args, "line_offset_index_path");
+	if (py_line_offset_index_path != NULL)
+	{
+		args.line_offset_index_path = gcode_arc_converter::PyUnicode_SafeAsString(py_line_offset_index_path);
+	}
+
+	// Extract source_line_map_path.  This is optional.  When supplied, a target to source line map is saved here.
+	PyObject* py_source_line_map_path = PyDict_GetItemString(py_args, "source_line_map_path");
+	if (py_source_line_map_path != NULL)
+	{
+		args.source_line_map_path = gcode_arc_converter::PyUnicode_SafeAsString(py_source_line_map_path);
+	}
+
+	// Extract telemetry_path.  This is optional.  When supplied, a binary record of every arc decision is saved here.
+	PyObject* py_telemetry_path = PyDict_GetItemString(py_args, "telemetry_path");
+	if (py_telemetry_path != NULL)
+	{
+		args.telemetry_path = gcode_arc_converter::PyUnicode_SafeAsString(py_telemetry_path);
+	}
+
+	// Extract target_compression_threads.  This is optional.  Only used when the target path ends with .gz or .zst.
+	PyObject* py_target_compression_threads = PyDict_GetItemString(py_args, "target_compression_threads");
+	if (py_target_compression_threads != NULL)
+	{
+		args.target_compression_threads = static_cast<int>(PyLong_AsLong(py_target_compression_threads));
+	}
+
+	// Extract target_meatpack.  This is optional.  When true, the target is packed with MeatPack for serial streaming.
+	PyObject* py_target_meatpack = PyDict_GetItemString(py_args, "target_meatpack");
+	if (py_target_meatpack != NULL)
+	{
+		args.target_meatpack = PyLong_AsLong(py_target_meatpack) > 0;
+	}
+
+	// Extract max_coalesced_sweep_degrees.  This is optional.  When greater than 0, consecutive arcs on the same circle are joined.
+	PyObject* py_max_coalesced_sweep_degrees = PyDict_GetItemString(py_args, "max_coalesced_sweep_degrees");
+	if (py_max_coalesced_sweep_degrees != NULL)
+	{
+		args.max_coalesced_sweep_degrees = gcode_arc_converter::PyFloatOrInt_AsDouble(py_max_coalesced_sweep_degrees);
+	}
+
+	// Extract segmentation_lookahead.  This is optional.  When greater than 0, paths are split with a lookahead optimizer.
+	PyObject* py_segmentation_lookahead = PyDict_GetItemString(py_args, "segmentation_lookahead");
+	if (py_segmentation_lookahead != NULL)
+	{
+		args.segmentation_lookahead = static_cast<int>(PyLong_AsLong(py_segmentation_lookahead));
+	}
+
+	// Extract float_fitting.  This is optional.  When true, arcs are fit in float precision relative to their first point.
+	PyObject* py_float_fitting = PyDict_GetItemString(py_args, "float_fitting");
+	if (py_float_fitting != NULL)
+	{
+		args.float_fitting = PyLong_AsLong(py_float_fitting) > 0;
+	}
 
 	// Extract the resolution in millimeters
 	PyObject* py_resolution_mm = PyDict_GetItemString(py_args, "resolution_mm");
@@ -281,9 +645,57 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	}
 	args.g90_g91_influences_extruder = PyLong_AsLong(py_g90_g91_influences_extruder) > 0;
 
-	// on_progress_received
+	// Extract allow_g5_splines.  This is optional, and defaults to DEFAULT_ALLOW_G5_SPLINES
+	PyObject* py_allow_g5_splines = PyDict_GetItemString(py_args, "allow_g5_splines");
+	if (py_allow_g5_splines != NULL)
+	{
+		args.allow_g5_splines = PyLong_AsLong(py_allow_g5_splines) > 0;
+	}
+
+	// Extract allow_3d_arcs.  This is optional, and defaults to DEFAULT_ALLOW_3D_ARCS
+	PyObject* py_allow_3d_arcs = PyDict_GetItemString(py_args, "allow_3d_arcs");
+	if (py_allow_3d_arcs != NULL)
+	{
+		args.allow_3d_arcs = PyLong_AsLong(py_allow_3d_arcs) > 0;
+	}
+
+	// Extract feedrate_tolerance_percent.  This is optional, and defaults to DEFAULT_FEEDRATE_TOLERANCE_PERCENT
+	PyObject* py_feedrate_tolerance_percent = PyDict_GetItemString(py_args, "feedrate_tolerance_percent");
+	if (py_feedrate_tolerance_percent != NULL)
+	{
+		args.feedrate_tolerance_percent = gcode_arc_converter::PyFloatOrInt_AsDouble(py_feedrate_tolerance_percent);
+		if (args.feedrate_tolerance_percent < 0)
+		{
+			args.feedrate_tolerance_percent = DEFAULT_FEEDRATE_TOLERANCE_PERCENT;
+		}
+	}
+
+	// Extract command_rate_limit.  This is optional, and defaults to DEFAULT_COMMAND_RATE_LIMIT (no limit)
+	PyObject* py_command_rate_limit = PyDict_GetItemString(py_args, "command_rate_limit");
+	if (py_command_rate_limit != NULL)
+	{
+		args.command_rate_limit = gcode_arc_converter::PyFloatOrInt_AsDouble(py_command_rate_limit);
+		if (args.command_rate_limit < 0)
+		{
+			args.command_rate_limit = DEFAULT_COMMAND_RATE_LIMIT;
+		}
+	}
+
+	// Extract the per feature resolution and max radius.  These are optional dicts keyed by feature type name
+	PyObject* py_feature_resolution_mm = PyDict_GetItemString(py_args, "feature_resolution_mm");
+	if (py_feature_resolution_mm != NULL && !ParseFeatureSettings(py_feature_resolution_mm, "feature_resolution_mm", args.feature_resolution_mm))
+	{
+		return false;
+	}
+	PyObject* py_feature_max_radius_mm = PyDict_GetItemString(py_args, "feature_max_radius_mm");
+	if (py_feature_max_radius_mm != NULL && !ParseFeatureSettings(py_feature_max_radius_mm, "feature_max_radius_mm", args.feature_max_radius_mm))
+	{
+		return false;
+	}
+
+	// on_progress_received.  This is optional for dry runs.
 	PyObject* py_on_progress_received = PyDict_GetItemString(py_args, "on_progress_received");
-	if (py_on_progress_received == NULL)
+	if (py_on_progress_received == NULL && !args.dry_run)
 	{
 		std::string message = "ParseArgs - Unable to retrieve on_progress_received from the stabilization args.";
 		p_py_logger->log_exception(GCODE_CONVERSION, message);
@@ -309,3 +721,45 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	return true;
 }
 
+static bool ParseFeatureSettings(PyObject* py_feature_settings, const std::string setting_name, double values[])
+{
+	if (!PyDict_Check(py_feature_settings))
+	{
+		std::string message = "ParseArgs - The " + setting_name + " parameter must be a dict.";
+		p_py_logger->log_exception(GCODE_CONVERSION, message);
+		return false;
+	}
+	PyObject* py_key;
+	PyObject* py_value;
+	Py_ssize_t pos = 0;
+	while (PyDict_Next(py_feature_settings, &pos, &py_key, &py_value))
+	{
+		// Ignore features that are not set
+		if (py_value == Py_None)
+			continue;
+		const char* key = gcode_arc_converter::PyUnicode_SafeAsString(py_key);
+		if (key == NULL)
+		{
+			std::string message = "ParseArgs - Unable to read a feature type name from the " + setting_name + " parameter.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return false;
+		}
+		std::string feature_name(key);
+		bool found = false;
+		for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+		{
+			if (feature_type_name[index] == feature_name)
+			{
+				values[index] = gcode_arc_converter::PyFloatOrInt_AsDouble(py_value);
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+		{
+			std::string message = "ParseArgs - Unknown feature type '" + feature_name + "' in the " + setting_name + " parameter, ignoring.";
+			p_py_logger->log(GCODE_CONVERSION, WARNING, message);
+		}
+	}
+	return true;
+}
@@ -39,8 +39,16 @@ extern "C"
 	extern "C" void initPyArcWelder(void);
 #endif
 	static PyObject* ConvertFile(PyObject* self, PyObject* args);
+	static PyObject* EstimateFile(PyObject* self, PyObject* args);
+	static PyObject* StreamBegin(PyObject* self, PyObject* args);
+	static PyObject* StreamLine(PyObject* self, PyObject* args);
+	static PyObject* StreamFlush(PyObject* self, PyObject* args);
+	static PyObject* StreamEnd(PyObject* self, PyObject* args);
 }
 
+// The name of the capsules returned by StreamBegin, which hold the arc_welder for the stream
+#define ARC_WELDER_STREAM_CAPSULE_NAME "PyArcWelder.Stream"
+
 struct py_gcode_arc_args {
 	py_gcode_arc_args() {
 		source_file_path = "";
@@ -48,25 +56,94 @@ struct py_gcode_arc_args {
 		resolution_mm = DEFAULT_RESOLUTION_MM;
 		max_radius_mm = DEFAULT_MAX_RADIUS_MM;
 		g90_g91_influences_extruder = DEFAULT_G90_G91_INFLUENCES_EXTREUDER;
+		allow_g5_splines = DEFAULT_ALLOW_G5_SPLINES;
+		allow_3d_arcs = DEFAULT_ALLOW_3D_ARCS;
+		feedrate_tolerance_percent = DEFAULT_FEEDRATE_TOLERANCE_PERCENT;
+		command_rate_limit = DEFAULT_COMMAND_RATE_LIMIT;
+		dry_run = DEFAULT_DRY_RUN;
+		parsed_command_file_path = "";
+		line_offset_index_path = "";
+		source_line_map_path = "";
+		telemetry_path = "";
+		target_compression_threads = DEFAULT_COMPRESSION_THREADS;
+		target_meatpack = false;
+		max_coalesced_sweep_degrees = DEFAULT_MAX_COALESCED_SWEEP_DEGREES;
+		segmentation_lookahead = DEFAULT_SEGMENTATION_LOOKAHEAD;
+		float_fitting = DEFAULT_FLOAT_FITTING;
+		num_samples = DEFAULT_ESTIMATE_NUM_SAMPLES;
+		sample_size_bytes = DEFAULT_ESTIMATE_SAMPLE_SIZE_BYTES;
+		max_segments = DEFAULT_STREAM_MAX_SEGMENTS;
 		log_level = 0;
+		clear_feature_settings();
 	}
-	py_gcode_arc_args(std::string source_file_path_, std::string target_file_path_, double resolution_mm_, double max_radius_mm_, bool g90_g91_influences_extruder_, int log_level_) {
+	py_gcode_arc_args(std::string source_file_path_, std::string target_file_path_, double resolution_mm_, double max_radius_mm_, bool g90_g91_influences_extruder_, bool allow_g5_splines_, bool allow_3d_arcs_, double feedrate_tolerance_percent_, double command_rate_limit_, bool dry_run_, int log_level_) {
 		source_file_path = source_file_path_;
 		target_file_path = target_file_path_;
 		resolution_mm = resolution_mm_;
 		max_radius_mm = max_radius_mm_;
 		g90_g91_influences_extruder = g90_g91_influences_extruder_;
+		allow_g5_splines = allow_g5_splines_;
+		allow_3d_arcs = allow_3d_arcs_;
+		feedrate_tolerance_percent = feedrate_tolerance_percent_;
+		command_rate_limit = command_rate_limit_;
+		dry_run = dry_run_;
+		parsed_command_file_path = "";
+		line_offset_index_path = "";
+		source_line_map_path = "";
+		telemetry_path = "";
+		target_compression_threads = DEFAULT_COMPRESSION_THREADS;
+		target_meatpack = false;
+		max_coalesced_sweep_degrees = DEFAULT_MAX_COALESCED_SWEEP_DEGREES;
+		segmentation_lookahead = DEFAULT_SEGMENTATION_LOOKAHEAD;
+		float_fitting = DEFAULT_FLOAT_FITTING;
+		num_samples = DEFAULT_ESTIMATE_NUM_SAMPLES;
+		sample_size_bytes = DEFAULT_ESTIMATE_SAMPLE_SIZE_BYTES;
+		max_segments = DEFAULT_STREAM_MAX_SEGMENTS;
 		log_level = log_level_;
+		clear_feature_settings();
+	}
+	void clear_feature_settings() {
+		// A value of 0 means the default resolution/max radius is used for the feature type
+		for (int index = 0; index < NUM_FEATURE_TYPES; index++)
+		{
+			feature_resolution_mm[index] = 0;
+			feature_max_radius_mm[index] = 0;
+		}
 	}
 	std::string source_file_path;
 	std::string target_file_path;
 	double resolution_mm;
 	bool g90_g91_influences_extruder;
 	double max_radius_mm;
+	bool allow_g5_splines;
+	bool allow_3d_arcs;
+	double feedrate_tolerance_percent;
+	double command_rate_limit;
+	bool dry_run;
+	double max_coalesced_sweep_degrees;
+	int segmentation_lookahead;
+	bool float_fitting;
+	// Only used by ConvertFile
+	std::string parsed_command_file_path;
+	std::string line_offset_index_path;
+	std::string source_line_map_path;
+	std::string telemetry_path;
+	int target_compression_threads;
+	bool target_meatpack;
+	// Only used by EstimateFile
+	int num_samples;
+	long sample_size_bytes;
+	// Only used by StreamBegin
+	int max_segments;
+	double feature_resolution_mm[NUM_FEATURE_TYPES];
+	double feature_max_radius_mm[NUM_FEATURE_TYPES];
 	int log_level;
 };
 
 static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** p_py_progress_callback);
+static bool ParseFeatureSettings(PyObject* py_feature_settings, const std::string setting_name, double values[]);
+// Splits the welded lines of a stream into a tuple of strings without line endings
+static PyObject* BuildStreamLines(const std::string& output);
 
 // global logger
 py_logger* p_py_logger = NULL;
@@ -50,6 +50,15 @@ namespace gcode_arc_converter {
 #endif
 	}
 
+	PyObject* PyString_SafeFromStringAndSize(const char* str, Py_ssize_t size)
+	{
+#if PY_MAJOR_VERSION >= 3
+		return PyUnicode_FromStringAndSize(str, size);
+#else
+		return PyString_FromStringAndSize(str, size);
+#endif
+	}
+
 	PyObject* PyUnicode_SafeFromString(std::string str)
 	{
 #if PY_MAJOR_VERSION >= 3
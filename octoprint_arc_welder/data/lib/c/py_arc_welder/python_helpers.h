@@ -33,6 +33,7 @@ namespace gcode_arc_converter {
 	int PyUnicode_SafeCheck(PyObject* py);
 	const char* PyUnicode_SafeAsString(PyObject* py);
 	PyObject* PyString_SafeFromString(const char* str);
+	PyObject* PyString_SafeFromStringAndSize(const char* str, Py_ssize_t size);
 	PyObject* PyUnicode_SafeFromString(std::string str);
 	double PyFloatOrInt_AsDouble(PyObject* py_double_or_int);
 	long PyIntOrLong_AsLong(PyObject* value);
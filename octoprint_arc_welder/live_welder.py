@@ -0,0 +1,146 @@
+# coding=utf-8
+# #################################################################################
+# Arc Welder: Anti-Stutter
+#
+# A plugin for OctoPrint that converts G0/G1 commands into G2/G3 commands where possible and ensures that the tool
+# paths don't deviate by more than a predefined resolution.  This compresses the gcode file sice, and reduces reduces
+# the number of gcodes per second sent to a 3D printer that supports arc commands (G2 G3)
+#
+# Copyright (C) 2020  Brad Hochgesang
+# #################################################################################
+# This program is free software:
+# you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/ArcWelderPlugin/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+from __future__ import absolute_import
+from __future__ import unicode_literals
+import os
+import threading
+import octoprint_arc_welder.log as log
+import PyArcWelder as converter # must import AFTER log, else this will fail to log and may crasy
+
+logging_configurator = log.LoggingConfigurator("arc_welder", "arc_welder.", "octoprint_arc_welder.")
+root_logger = logging_configurator.get_root_logger()
+# so that we can
+logger = logging_configurator.get_logger(__name__)
+
+# The size of the blocks read from the end of the file while searching for the last command
+LAST_COMMAND_SEARCH_BLOCK_SIZE = 4096
+
+
+def get_last_command_end_position(file_path):
+    """Returns the position where the line that holds the last gcode command of the file ends, not counting its line
+       ending, or None if it has no commands.  The filepos tag OctoPrint gives that line is at least this large."""
+    with open(file_path, "rb") as gcode_file:
+        gcode_file.seek(0, os.SEEK_END)
+        end_position = gcode_file.tell()
+        block_start = end_position
+        tail = b""
+        while block_start > 0:
+            block_size = min(LAST_COMMAND_SEARCH_BLOCK_SIZE, block_start)
+            block_start -= block_size
+            gcode_file.seek(block_start)
+            tail = gcode_file.read(block_size) + tail
+            lines = tail.split(b"\n")
+            # The first line may be partial, so only search it once the start of the file has been read.
+            first_index = 0 if block_start == 0 else 1
+            line_end = block_start + len(tail)
+            for index in range(len(lines) - 1, first_index - 1, -1):
+                line = lines[index]
+                if line.split(b";")[0].strip():
+                    return line_end
+                line_end -= len(line) + 1
+            tail = lines[0]
+    return None
+
+
+class LiveWelder(object):
+    """Welds the lines of a file as OctoPrint queues them to be sent to the printer, so files that were never
+       preprocessed are still sent as arcs.  At most max_segments lines are held back while an arc is being fit."""
+
+    def __init__(self):
+        self._stream = None
+        self._path = None
+        self._last_command_end_position = None
+        self._lock = threading.Lock()
+
+    @property
+    def is_welding(self):
+        return self._stream is not None
+
+    def begin(self, path, stream_args, file_path):
+        with self._lock:
+            if self._stream is not None:
+                converter.StreamEnd(self._stream)
+            logger.info("Live welding %s.", path)
+            # The held lines are flushed after the last command is queued, so nothing is left when the job is done.
+            try:
+                self._last_command_end_position = get_last_command_end_position(file_path)
+            except (IOError, OSError):
+                logger.exception("Unable to find the last command of %s.", file_path)
+                self._last_command_end_position = None
+            self._stream = converter.StreamBegin(stream_args)
+            self._path = path
+
+    def end(self):
+        """Ends the stream, and returns the lines that were still held back."""
+        with self._lock:
+            if self._stream is None:
+                return []
+            lines = list(converter.StreamEnd(self._stream))
+            self._stream = None
+            logger.info("Live welding of %s has ended.", self._path)
+            self._path = None
+            self._last_command_end_position = None
+            return lines
+
+    def _is_last_command(self, tags):
+        if self._last_command_end_position is None:
+            return False
+        for tag in tags:
+            if tag.startswith("filepos:"):
+                try:
+                    return int(tag[len("filepos:"):]) >= self._last_command_end_position
+                except ValueError:
+                    return False
+        return False
+
+    def on_gcode_queuing(self, cmd, cmd_type, gcode, tags):
+        """Returns the result of OctoPrint's gcode queuing hook for the command."""
+        if self._stream is None:
+            return None
+        if tags is not None and "source:file" in tags:
+            with self._lock:
+                if self._stream is None:
+                    return None
+                lines = list(converter.StreamLine(self._stream, cmd))
+                if self._is_last_command(tags):
+                    lines.extend(converter.StreamFlush(self._stream))
+            if not lines:
+                # Held back while an arc is being fit
+                return None,
+            if len(lines) == 1 and lines[0] == cmd:
+                return None
+            return lines
+        # Scripts, like the pause script, and the end of an SD upload (M29) must not be sent ahead of the lines
+        # that are held back.
+        if (tags is not None and "source:script" in tags) or gcode == "M29":
+            with self._lock:
+                if self._stream is None:
+                    return None
+                lines = converter.StreamFlush(self._stream)
+            if lines:
+                return list(lines) + [(cmd, cmd_type, tags)]
+        return None
@@ -30,7 +30,6 @@ import threading
 import octoprint_arc_welder.utilities as utilities
 import octoprint_arc_welder.log as log
 import time
-import shutil
 import os
 import PyArcWelder as converter # must import AFTER log, else this will fail to log and may crasy
 try:
@@ -55,6 +54,7 @@ class PreProcessorWorker(threading.Thread):
         progress_callback,
         cancel_callback,
         failed_callback,
+        skipped_callback,
         success_callback,
         completed_callback
     ):
@@ -68,6 +68,7 @@ class PreProcessorWorker(threading.Thread):
         self._progress_callback = progress_callback
         self._cancel_callback = cancel_callback
         self._failed_callback = failed_callback
+        self._skipped_callback = skipped_callback
         self._success_callback = success_callback
         self._completed_callback = completed_callback
         self._is_processing = False
@@ -115,26 +116,38 @@ class PreProcessorWorker(threading.Thread):
             
     def _process(self, path, processor_args, additional_metadata, is_manual_request):
         self._start_callback(path, processor_args)
-        logger.info(
-            "Copying source gcode file at %s to %s for processing.", processor_args["path"], self._source_file_path
-        )
         if not os.path.exists(processor_args["path"]):
             message = "The source file path at '{0}' does not exist.  It may have been moved or deleted". \
                 format(processor_args["path"])
             self._failed_callback(message)
             return
-        shutil.copy(processor_args["path"], self._source_file_path)
+        if not is_manual_request and not self._is_worth_processing(processor_args):
+            return
+        # Record the size and modification time so that changes made to the source while it is being read are detected.
+        source_signature = utilities.get_file_signature(processor_args["path"])
+        source_file_path = self._get_source_snapshot(processor_args["path"])
         source_filename = utilities.get_filename_from_path(processor_args["path"])
         # Add arguments to the processor_args dict
         processor_args["on_progress_received"] = self._progress_received
-        processor_args["source_file_path"] = self._source_file_path
+        processor_args["source_file_path"] = source_file_path
         processor_args["target_file_path"] = self._target_file_path
         # Convert the file via the C++ extension
         logger.info(
-            "Calling conversion routine on copied source gcode file to target at %s.", self._source_file_path
+            "Calling conversion routine on source gcode file at %s.", source_file_path
         )
         try:
             results = converter.ConvertFile(processor_args)
+            if (
+                results["success"] and
+                utilities.get_file_signature(source_file_path) != source_signature
+            ):
+                logger.warning("The source file at %s changed while it was being processed.", source_file_path)
+                results = {
+                    "cancelled": False,
+                    "success": False,
+                    "message": "The gcode file at {0} was modified while it was being preprocessed.  Please try "
+                               "again.".format(processor_args["path"])
+                }
         except Exception as e:
             # It would be better to catch only specific errors here, but we will log them.  Any
             # unhandled errors that occur would shut down the worker thread until reboot.
@@ -175,6 +188,52 @@ class PreProcessorWorker(threading.Thread):
             os.unlink(self._target_file_path)
 
 
+    def _get_source_snapshot(self, source_path):
+        # Avoid copying the source file, which can take a long time for large files on slow storage.  A hard link
+        # keeps the original contents readable even if the upload is replaced or deleted during processing.  If a hard
+        # link can't be created (unsupported filesystem, different device, etc), read the original file in place.  In
+        # either case, in place modification is detected by comparing the file signature after processing.
+        if os.path.isfile(self._source_file_path):
+            os.unlink(self._source_file_path)
+        try:
+            os.link(source_path, self._source_file_path)
+            logger.info("Linked source gcode file at %s to %s for processing.", source_path, self._source_file_path)
+            return self._source_file_path
+        except (AttributeError, OSError) as e:
+            # os.link is not available on all platforms for python 2
+            logger.info("Unable to link the source gcode file at %s, reading it in place: %s", source_path, e)
+            return source_path
+
+    def _is_worth_processing(self, processor_args):
+        # Estimate the size reduction from a few samples of the source file, and skip the conversion if it is too small.
+        min_estimated_compression_percent = processor_args.get("min_estimated_compression_percent", 0)
+        if not min_estimated_compression_percent or min_estimated_compression_percent <= 0:
+            return True
+        estimate_args = dict(processor_args)
+        estimate_args["source_file_path"] = processor_args["path"]
+        logger.info("Estimating the size reduction of %s.", processor_args["path"])
+        try:
+            estimate = utilities.dict_encode(converter.EstimateFile(estimate_args))
+        except Exception as e:
+            # Never skip a file because the estimate failed, just convert it.
+            logger.exception("An unexpected exception occurred while estimating %s.", processor_args["path"])
+            return True
+        if not estimate["success"]:
+            logger.warning("Unable to estimate %s: %s", processor_args["path"], estimate["message"])
+            return True
+        logger.info(
+            "Estimated a %.1f%% size reduction and %d arcs for %s.",
+            estimate["compression_percent"], estimate["estimated_arcs_created"], processor_args["path"]
+        )
+        if estimate["compression_percent"] < min_estimated_compression_percent:
+            message = "Skipped '{0}', the estimated size reduction of {1:.1f}% is below the minimum of {2:.1f}%.".format(
+                processor_args["path"], estimate["compression_percent"], min_estimated_compression_percent
+            )
+            logger.info(message)
+            self._skipped_callback(message)
+            return False
+        return True
+
     def _progress_received(self, progress):
         # the progress payload will all be in bytes (str for python 2) format.
         # Make sure everything is in unicode (str for python3) because mixed encoding
@@ -183,6 +183,7 @@ $(function () {
         self.statistics.target_filename = ko.observable();
 
         self.statistics.segment_statistics_text = ko.observable();
+        self.statistics.command_rate_statistics_text = ko.observable();
         self.current_files = null;
 
         self.statistics_shown.subscribe(
@@ -377,6 +378,7 @@ $(function () {
                 self.statistics.source_filename(statistics.source_filename);
                 self.statistics.target_filename(statistics.target_filename);
                 self.statistics.segment_statistics_text(statistics.segment_statistics_text);
+                self.statistics.command_rate_statistics_text(statistics.command_rate_statistics_text);
             }
             if (is_welded)
             {
@@ -454,6 +456,20 @@ $(function () {
                     PNotifyExtensions.displayPopupForKey(options, ArcWelder.PopupKey("preprocessing-cancelled"), []);
                     self.closePreprocessingPopup();
                     break;
+                case "preprocessing-skipped":
+                    var options = {
+                        title: "Arc Welder - Skipped",
+                        text: data.message,
+                        type: "info",
+                        hide: true,
+                        addclass: "arc-welder",
+                        desktop: {
+                            desktop: true
+                        }
+                    };
+                    PNotifyExtensions.displayPopupForKey(options, ArcWelder.PopupKey("preprocessing-skipped"), []);
+                    self.closePreprocessingPopup();
+                    break;
                 case "preprocessing-success":
                     self.closePreprocessingPopup();
                     //  Load all stats for the newly processed file
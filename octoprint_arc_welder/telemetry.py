@@ -0,0 +1,168 @@
+# coding=utf-8
+# #################################################################################
+# Arc Welder: Anti-Stutter
+#
+# A plugin for OctoPrint that converts G0/G1 commands into G2/G3 commands where possible and ensures that the tool
+# paths don't deviate by more than a predefined resolution.  This compresses the gcode file sice, and reduces reduces
+# the number of gcodes per second sent to a 3D printer that supports arc commands (G2 G3)
+#
+# Copyright (C) 2020  Brad Hochgesang
+# #################################################################################
+# This program is free software:
+# you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/ArcWelderPlugin/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+from __future__ import absolute_import
+from __future__ import unicode_literals
+from __future__ import print_function
+import struct
+import sys
+
+# Decodes the arc decision telemetry written by the converter when a telemetry_path is supplied to ConvertFile.
+# The names below must match the arc_telemetry_decision enum in arc_telemetry.h, and the feature_type enum in
+# gcode_comment_processor.h.
+
+TELEMETRY_MAGIC = b"AWTM"
+TELEMETRY_VERSION = 1
+# magic, version, record size
+HEADER_FORMAT = "<4sii"
+# line_number, layer, decision, feature_type, num_segments, radius
+RECORD_FORMAT = "<iiBBHf"
+
+DECISION_NAMES = [
+    "arc_emitted",
+    "spline_emitted",
+    "too_few_segments",
+    "not_g0_g1",
+    "z_changed",
+    "xyz_mode_changed",
+    "extrusion_changed",
+    "extruder_mode_changed",
+    "feedrate_changed",
+    "feature_changed",
+    "offset_changed",
+    "max_segments",
+    "no_distance",
+    "radius_exceeded",
+    "no_fit",
+    "unknown",
+]
+
+FEATURE_NAMES = [
+    "unknown_feature",
+    "bridge_feature",
+    "outer_perimeter_feature",
+    "unknown_perimeter_feature",
+    "inner_perimeter_feature",
+    "skirt_feature",
+    "gap_fill_feature",
+    "solid_infill_feature",
+    "ooze_shield_feature",
+    "infill_feature",
+    "prime_pillar_feature",
+]
+
+
+class TelemetryRecord(object):
+    def __init__(self, line_number, layer, decision, feature_type, num_segments, radius):
+        self.line_number = line_number
+        self.layer = layer
+        self.decision = decision
+        self.feature_type = feature_type
+        self.num_segments = num_segments
+        self.radius = radius
+
+    @property
+    def decision_name(self):
+        return _get_name(DECISION_NAMES, self.decision)
+
+    @property
+    def feature_name(self):
+        return _get_name(FEATURE_NAMES, self.feature_type)
+
+    def is_emitted(self):
+        return self.decision <= 1
+
+
+def _get_name(names, index):
+    if 0 <= index < len(names):
+        return names[index]
+    return "unknown ({0})".format(index)
+
+
+def read_records(file_path):
+    """Yields a TelemetryRecord for every record in the telemetry file."""
+    header_size = struct.calcsize(HEADER_FORMAT)
+    with open(file_path, "rb") as telemetry_file:
+        header = telemetry_file.read(header_size)
+        if len(header) != header_size:
+            raise ValueError("The telemetry file is too short to contain a header.")
+        magic, version, record_size = struct.unpack(HEADER_FORMAT, header)
+        if magic != TELEMETRY_MAGIC or version != TELEMETRY_VERSION:
+            raise ValueError("The file is not a supported telemetry file.")
+        expected_record_size = struct.calcsize(RECORD_FORMAT)
+        if record_size < expected_record_size:
+            raise ValueError("The telemetry record size is invalid.")
+        while True:
+            data = telemetry_file.read(record_size)
+            if len(data) < record_size:
+                break
+            yield TelemetryRecord(*struct.unpack(RECORD_FORMAT, data[:expected_record_size]))
+
+
+def summarize(file_path):
+    """
+    Returns a dict containing the count of each decision, and the count of each decision broken down by layer and by
+    feature type.
+    """
+    totals = {}
+    by_layer = {}
+    by_feature = {}
+    for record in read_records(file_path):
+        name = record.decision_name
+        totals[name] = totals.get(name, 0) + 1
+        layer = by_layer.setdefault(record.layer, {})
+        layer[name] = layer.get(name, 0) + 1
+        feature = by_feature.setdefault(record.feature_name, {})
+        feature[name] = feature.get(name, 0) + 1
+    return {
+        "totals": totals,
+        "by_layer": by_layer,
+        "by_feature": by_feature,
+    }
+
+
+def _format_counts(counts):
+    return ", ".join(
+        "{0}: {1}".format(name, count) for name, count in sorted(counts.items(), key=lambda item: -item[1])
+    )
+
+
+def print_summary(file_path):
+    summary = summarize(file_path)
+    print("Decisions: {0}".format(_format_counts(summary["totals"])))
+    print("By feature:")
+    for feature_name in sorted(summary["by_feature"]):
+        print("  {0}: {1}".format(feature_name, _format_counts(summary["by_feature"][feature_name])))
+    print("By layer:")
+    for layer in sorted(summary["by_layer"]):
+        print("  {0}: {1}".format(layer, _format_counts(summary["by_layer"][layer])))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print("Usage: python -m octoprint_arc_welder.telemetry <telemetry_file_path>")
+        sys.exit(1)
+    print_summary(sys.argv[1])
@@ -64,4 +64,9 @@ def dict_encode(d):
             if isinstance(s, bytes):
                 return str(s, errors='ignore', encoding='utf-8')
         return s
-    return {dict_key_value_encode(k): dict_key_value_encode(v) for k, v in six.iteritems(d)}
\ No newline at end of file
+    return {dict_key_value_encode(k): dict_key_value_encode(v) for k, v in six.iteritems(d)}
+
+def get_file_signature(filepath):
+    # The size and modification time of a file, used to detect changes made while the file is being read.
+    stat = os.stat(filepath)
+    return stat.st_size, stat.st_mtime
@@ -34,8 +34,12 @@ from distutils.bcppcompiler import BCPPCompiler
 from distutils.cygwinccompiler import CygwinCCompiler
 from distutils.version import LooseVersion
 from distutils.sysconfig import customize_compiler
+from distutils.errors import CompileError, LinkError
 from octoprint_arc_welder_setuptools import NumberedVersion
 import sys
+import os
+import shutil
+import tempfile
 import platform
 import versioneer
 
@@ -122,8 +126,8 @@ compiler_opts = {
         "define_macros": [],
     },
     UnixCCompiler.compiler_type: {
-        "extra_compile_args": ["-O3", "-std=c++11", "-Wno-unknown-pragmas", '-v'],
-        "extra_link_args": [],
+        "extra_compile_args": ["-O3", "-std=c++11", "-Wno-unknown-pragmas", '-v', "-pthread"],
+        "extra_link_args": ["-pthread"],
         "define_macros": [],
     },
     BCPPCompiler.compiler_type: {
@@ -132,8 +136,8 @@ compiler_opts = {
         "define_macros": [],
     },
     CygwinCCompiler.compiler_type: {
-        "extra_compile_args": ["-O3", "-std=c++11"],
-        "extra_link_args": [],
+        "extra_compile_args": ["-O3", "-std=c++11", "-pthread"],
+        "extra_link_args": ["-pthread"],
         "define_macros": [],
     },
 }
@@ -151,8 +155,8 @@ if DEBUG:
             "define_macros": [],
         },
         UnixCCompiler.compiler_type: {
-            "extra_compile_args": ["-g"],
-            "extra_link_args": ["-g"],
+            "extra_compile_args": ["-g", "-pthread"],
+            "extra_link_args": ["-g", "-pthread"],
             "define_macros": [],
         },
         BCPPCompiler.compiler_type: {
@@ -176,6 +180,32 @@ os_compiler_opts = {
     }
 }
 
+# Optional libraries used to read and write compressed gcode.  Each one is enabled only if it can be found when the
+# extension is built.  (library, header, function, macro)
+optional_libraries = [
+    ("z", "zlib.h", "gzopen", "ARC_WELDER_ZLIB"),
+    ("zstd", "zstd.h", "ZSTD_createDStream", "ARC_WELDER_ZSTD"),
+]
+
+
+def has_library(compiler, library, header, function):
+    # Try to compile and link a small program that uses the library
+    temp_dir = tempfile.mkdtemp()
+    try:
+        source_path = os.path.join(temp_dir, "check_{0}.c".format(library))
+        with open(source_path, "w") as source_file:
+            source_file.write(
+                "#include <{0}>\nint main(void) {{ void* p = (void*)&{1}; return p == 0; }}\n".format(header, function)
+            )
+        objects = compiler.compile([source_path], output_dir=temp_dir)
+        compiler.link_executable(objects, os.path.join(temp_dir, "check_" + library), libraries=[library])
+        return True
+    except (CompileError, LinkError):
+        return False
+    finally:
+        shutil.rmtree(temp_dir, ignore_errors=True)
+
+
 class build_ext_subclass(build_ext):
     def build_extensions(self):
         print("Compiling PyGcodeArcConverter Extension with {0}.".format(self.compiler))
@@ -204,6 +234,15 @@ class build_ext_subclass(build_ext):
                 for attrib, value in o.items():
                     getattr(e, attrib).extend(value)
 
+        for library, header, function, macro in optional_libraries:
+            if has_library(c, library, header, function):
+                print("Found {0}, enabling {1}.".format(header, macro))
+                for e in self.extensions:
+                    e.libraries.append(library)
+                    e.define_macros.append((macro, "1"))
+            else:
+                print("Unable to find {0}, {1} will not be enabled.".format(header, macro))
+
         for extension in self.extensions:
             print(
                 "Building Extensions for {0} - extra_compile_args:{1} - extra_link_args:{2}".format(
@@ -220,19 +259,31 @@ class build_ext_subclass(build_ext):
 plugin_ext_sources = [
 
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/array_list.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/bgcode.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/circular_buffer.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/compressed_stream.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/extruder.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/gcode_comment_processor.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/gcode_parser.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/gcode_position.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/line_offset_index.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/line_reader.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/meatpack.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/parsed_command.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/parsed_command_file.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/parsed_command_parameter.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/position.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/utilities.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/logger.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/arc_welder.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/command_rate_statistics.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/arc_telemetry.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/arc_coalescer.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/segmentation_optimizer.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/segmented_arc.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/segmented_bezier.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/segmented_shape.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/source_line_map.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_logger.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_arc_welder.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_arc_welder_extension.cpp",
@@ -0,0 +1,113 @@
+# coding=utf-8
+# #################################################################################
+# Arc Welder: Anti-Stutter
+#
+# A plugin for OctoPrint that converts G0/G1 commands into G2/G3 commands where possible and ensures that the tool
+# paths don't deviate by more than a predefined resolution.  This compresses the gcode file sice, and reduces reduces
+# the number of gcodes per second sent to a 3D printer that supports arc commands (G2 G3)
+#
+# Copyright (C) 2020  Brad Hochgesang
+# #################################################################################
+# This program is free software:
+# you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/ArcWelderPlugin/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+from __future__ import absolute_import
+from __future__ import unicode_literals
+import math
+import re
+import unittest
+from decimal import Decimal
+
+
+try:
+    import PyArcWelder
+except (ImportError, SystemError):
+    # The extension is not built, or OctoPrint is not installed
+    PyArcWelder = None
+
+FEEDRATE_REGEX = re.compile(r"\bF(-?[0-9]*\.?[0-9]+)")
+
+
+def create_arc(center_x, center_y, radius, start_angle, sweep, num_segments, feedrates):
+    # Extruding moves along an arc, each with the next of the feedrates
+    lines = []
+    for segment_index in range(1, num_segments + 1):
+        angle = start_angle + sweep * segment_index / num_segments
+        lines.append("G1 X{0:.3f} Y{1:.3f} E0.05000 F{2}".format(
+            center_x + radius * math.cos(angle),
+            center_y + radius * math.sin(angle),
+            feedrates[segment_index % len(feedrates)]
+        ))
+    return lines
+
+
+def get_arc_feedrates(lines):
+    # The feedrate the printer is at for every arc, since F is modal
+    feedrate = None
+    arc_feedrates = []
+    for line in lines:
+        command = line.split(";")[0].strip().upper()
+        match = FEEDRATE_REGEX.search(command)
+        if match:
+            feedrate = Decimal(match.group(1))
+        if re.match(r"G[23]\b", command):
+            arc_feedrates.append(feedrate)
+    return arc_feedrates
+
+
+@unittest.skipIf(PyArcWelder is None, "The PyArcWelder extension is not built.")
+class TestFeedrateWelding(unittest.TestCase):
+    def weld(self, lines, **kwargs):
+        args = {
+            "source_file_path": "",
+            "resolution_mm": 0.05,
+            "max_radius_mm": 1000000,
+            "g90_g91_influences_extruder": False,
+            "feedrate_tolerance_percent": 1,
+            "log_level": 40,
+        }
+        args.update(kwargs)
+        stream = PyArcWelder.StreamBegin(args)
+        welded_lines = []
+        for line in lines:
+            welded_lines.extend(PyArcWelder.StreamLine(stream, line))
+        welded_lines.extend(PyArcWelder.StreamEnd(stream))
+        return welded_lines
+
+    def create_repeated_feedrate_arcs(self):
+        # The first arc alternates between two feedrates within the tolerance, so it is written with their average.
+        # The second arc curves the other way and repeats the last feedrate of the first arc on every move, as some
+        # slicers do, so the feedrate isn't restored between the arcs.
+        lines = ["G21", "G90", "M83", "G1 X120.000 Y100.000 Z0.200 F1800"]
+        lines.extend(create_arc(100, 100, 20, 0, math.pi / 2, 20, [1810, 1800]))
+        lines.extend(create_arc(100, 140, 20, -math.pi / 2, -math.pi / 2, 20, [1810]))
+        return lines
+
+    def assert_arc_feedrates(self, welded_lines):
+        arc_feedrates = get_arc_feedrates(welded_lines)
+        self.assertEqual(2, len(arc_feedrates), "Expected two arcs:\n{0}".format("\n".join(welded_lines)))
+        self.assertTrue(Decimal(1800) < arc_feedrates[0] < Decimal(1810), "The first arc wasn't averaged.")
+        self.assertEqual(Decimal(1810), arc_feedrates[1], "The second arc runs at the first arc's feedrate.")
+
+    def test_repeated_feedrate_after_averaged_arc(self):
+        self.assert_arc_feedrates(self.weld(self.create_repeated_feedrate_arcs()))
+
+    def test_repeated_feedrate_after_averaged_arc_with_lookahead(self):
+        self.assert_arc_feedrates(self.weld(self.create_repeated_feedrate_arcs(), segmentation_lookahead=60))
+
+
+if __name__ == "__main__":
+    unittest.main()
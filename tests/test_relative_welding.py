@@ -0,0 +1,148 @@
+# coding=utf-8
+# #################################################################################
+# Arc Welder: Anti-Stutter
+#
+# A plugin for OctoPrint that converts G0/G1 commands into G2/G3 commands where possible and ensures that the tool
+# paths don't deviate by more than a predefined resolution.  This compresses the gcode file sice, and reduces reduces
+# the number of gcodes per second sent to a 3D printer that supports arc commands (G2 G3)
+#
+# Copyright (C) 2020  Brad Hochgesang
+# #################################################################################
+# This program is free software:
+# you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/ArcWelderPlugin/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+from __future__ import absolute_import
+from __future__ import unicode_literals
+import math
+import random
+import re
+import unittest
+from decimal import Decimal
+
+try:
+    import PyArcWelder
+except (ImportError, SystemError):
+    # The extension is not built, or OctoPrint is not installed
+    PyArcWelder = None
+
+PARAMETER_REGEX = re.compile(r"([XYZ])(-?[0-9]*\.?[0-9]+)")
+
+
+def create_relative_arcs(num_arcs, z_per_arc, seed):
+    # Relative (G91) moves along arcs of varying radius, sweep and direction, rounded to 3 decimals the way a slicer
+    # writes them.  Every offset is computed from the previous rounded position so the source itself does not drift.
+    random_generator = random.Random(seed)
+    lines = ["G21", "G90", "M83", "G1 X100.000 Y100.000 Z0.200 F1800", "G91"]
+    x, y, z = 100000, 100000, 200
+    for arc_index in range(num_arcs):
+        radius = random_generator.uniform(3, 40)
+        num_segments = random_generator.randint(30, 120)
+        start_angle = random_generator.uniform(0, 2.0 * math.pi)
+        sweep = random_generator.uniform(1, 6) * (1 if arc_index % 2 else -1)
+        center_x = x / 1000.0 - radius * math.cos(start_angle)
+        center_y = y / 1000.0 - radius * math.sin(start_angle)
+        start_z = z
+        for segment_index in range(1, num_segments + 1):
+            angle = start_angle + sweep * segment_index / num_segments
+            next_x = int(round((center_x + radius * math.cos(angle)) * 1000))
+            next_y = int(round((center_y + radius * math.sin(angle)) * 1000))
+            next_z = start_z + int(round(z_per_arc * 1000 * segment_index / num_segments))
+            if next_x == x and next_y == y:
+                continue
+            lines.append("G1 X{0:.3f} Y{1:.3f} Z{2:.3f} E0.01000".format(
+                (next_x - x) / 1000.0, (next_y - y) / 1000.0, (next_z - z) / 1000.0
+            ))
+            x, y, z = next_x, next_y, next_z
+        # A travel to the next arc
+        travel_x = random_generator.randint(-3000, 3000)
+        travel_y = random_generator.randint(-3000, 3000)
+        lines.append("G0 X{0:.3f} Y{1:.3f} F6000".format(travel_x / 1000.0, travel_y / 1000.0))
+        x += travel_x
+        y += travel_y
+    return lines
+
+
+def get_final_position(lines):
+    position = {"X": Decimal(0), "Y": Decimal(0), "Z": Decimal(0)}
+    is_relative = False
+    for line in lines:
+        command = line.split(";")[0].strip().upper()
+        if command.startswith("G90"):
+            is_relative = False
+        elif command.startswith("G91"):
+            is_relative = True
+        elif re.match(r"G[0-35]\b", command):
+            for axis, value in PARAMETER_REGEX.findall(command):
+                if is_relative:
+                    position[axis] += Decimal(value)
+                else:
+                    position[axis] = Decimal(value)
+    return position
+
+
+@unittest.skipIf(PyArcWelder is None, "The PyArcWelder extension is not built.")
+class TestRelativeWelding(unittest.TestCase):
+    def weld(self, lines, **kwargs):
+        args = {
+            "source_file_path": "",
+            "resolution_mm": 0.05,
+            "max_radius_mm": 1000000,
+            "g90_g91_influences_extruder": False,
+            "log_level": 40,
+        }
+        args.update(kwargs)
+        stream = PyArcWelder.StreamBegin(args)
+        welded_lines = []
+        for line in lines:
+            welded_lines.extend(PyArcWelder.StreamLine(stream, line))
+        welded_lines.extend(PyArcWelder.StreamEnd(stream))
+        return welded_lines
+
+    def assert_same_final_position(self, source_lines, welded_lines, shape_regex=r"G[23] "):
+        self.assertTrue(any(re.match(shape_regex, line) for line in welded_lines), "No shapes were welded.")
+        source_position = get_final_position(source_lines)
+        welded_position = get_final_position(welded_lines)
+        for axis in ("X", "Y", "Z"):
+            self.assertEqual(
+                source_position[axis], welded_position[axis],
+                "The final {0} position drifted from {1} to {2}.".format(
+                    axis, source_position[axis], welded_position[axis]
+                )
+            )
+
+    def test_relative_arcs_do_not_drift(self):
+        source_lines = create_relative_arcs(300, 0, 1)
+        self.assert_same_final_position(source_lines, self.weld(source_lines))
+
+    def test_relative_3d_arcs_do_not_drift(self):
+        source_lines = create_relative_arcs(300, 0.2, 2)
+        self.assert_same_final_position(source_lines, self.weld(source_lines, allow_3d_arcs=True))
+
+    def test_relative_coalesced_arcs_do_not_drift(self):
+        source_lines = create_relative_arcs(300, 0, 1)
+        self.assert_same_final_position(
+            source_lines, self.weld(source_lines, max_coalesced_sweep_degrees=360, segmentation_lookahead=100)
+        )
+
+    def test_relative_splines_do_not_drift(self):
+        source_lines = create_relative_arcs(300, 0, 1)
+        self.assert_same_final_position(
+            source_lines, self.weld(source_lines, allow_g5_splines=True), shape_regex=r"G5 "
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()